@@ -224,6 +224,7 @@ bool VehicleCargoReroute::operator()(CargoPacket *cp)
 	}
 	if (this->source != this->destination) {
 		this->source->RemoveFromMeta(cp_new, VehicleCargoList::MTA_TRANSFER, cp_new->Count());
+		this->destination->TakeOverAging(cp_new);
 		this->destination->AddToMeta(cp_new, VehicleCargoList::MTA_TRANSFER);
 	}
 
@@ -28,6 +28,7 @@ CargoPacket::CargoPacket()
 {
 	this->source_type = SourceType::Industry;
 	this->source_id   = INVALID_SOURCE;
+	this->aging_cycle = 0;
 }
 
 /**
@@ -42,13 +43,14 @@ CargoPacket::CargoPacket()
  * that, in contrary to all other pools, does not memset to 0.
  */
 CargoPacket::CargoPacket(StationID source, TileIndex source_xy, uint16 count, SourceType source_type, SourceID source_id) :
-	feeder_share(0),
 	count(count),
 	days_in_transit(0),
-	source_id(source_id),
-	source(source),
+	loaded_at_xy(0),
 	source_xy(source_xy),
-	loaded_at_xy(0)
+	source(source),
+	source_id(source_id),
+	aging_cycle(0),
+	feeder_share(0)
 {
 	assert(count != 0);
 	this->source_type  = source_type;
@@ -69,13 +71,14 @@ CargoPacket::CargoPacket(StationID source, TileIndex source_xy, uint16 count, So
  * that, in contrary to all other pools, does not memset to 0.
  */
 CargoPacket::CargoPacket(uint16 count, uint16 days_in_transit, StationID source, TileIndex source_xy, TileIndex loaded_at_xy, Money feeder_share, SourceType source_type, SourceID source_id) :
-		feeder_share(feeder_share),
 		count(count),
 		days_in_transit(days_in_transit),
-		source_id(source_id),
-		source(source),
+		loaded_at_xy(loaded_at_xy.value),
 		source_xy(source_xy),
-		loaded_at_xy(loaded_at_xy.value)
+		source(source),
+		source_id(source_id),
+		aging_cycle(0),
+		feeder_share(feeder_share)
 {
 	assert(count != 0);
 	this->source_type = source_type;
@@ -92,6 +95,7 @@ CargoPacket *CargoPacket::Split(uint new_size)
 
 	Money fs = this->FeederShare(new_size);
 	CargoPacket *cp_new = new CargoPacket(new_size, this->days_in_transit, this->source, this->source_xy, this->loaded_at_xy, fs, this->source_type, this->source_id);
+	cp_new->aging_cycle = this->aging_cycle;
 	this->feeder_share -= fs;
 	this->count -= new_size;
 	return cp_new;
@@ -252,6 +256,7 @@ void VehicleCargoList::Append(CargoPacket *cp, MoveToAction action)
 	assert(cp != nullptr);
 	assert(action == MTA_LOAD ||
 			(action == MTA_KEEP && this->action_counts[MTA_LOAD] == 0));
+	cp->aging_cycle = this->aging_cycle;
 	this->AddToMeta(cp, action);
 
 	if (this->count == cp->count) {
@@ -262,6 +267,7 @@ void VehicleCargoList::Append(CargoPacket *cp, MoveToAction action)
 	uint sum = cp->count;
 	for (ReverseIterator it(this->packets.rbegin()); it != this->packets.rend(); it++) {
 		CargoPacket *icp = *it;
+		this->UpdateDaysInTransit(icp);
 		if (VehicleCargoList::TryMerge(icp, cp)) return;
 		sum += icp->count;
 		if (sum >= this->action_counts[action]) {
@@ -287,6 +293,7 @@ void VehicleCargoList::ShiftCargo(Taction action)
 	Iterator it(this->packets.begin());
 	while (it != this->packets.end() && action.MaxMove() > 0) {
 		CargoPacket *cp = *it;
+		this->UpdateDaysInTransit(cp);
 		if (action(cp)) {
 			it = this->packets.erase(it);
 		} else {
@@ -311,6 +318,7 @@ void VehicleCargoList::PopCargo(Taction action)
 	Iterator begin(this->packets.begin());
 	while (action.MaxMove() > 0) {
 		CargoPacket *cp = *it;
+		this->UpdateDaysInTransit(cp);
 		if (action(cp)) {
 			if (it != begin) {
 				this->packets.erase(it--);
@@ -332,8 +340,12 @@ void VehicleCargoList::PopCargo(Taction action)
  */
 void VehicleCargoList::RemoveFromCache(const CargoPacket *cp, uint count)
 {
+	assert(count <= cp->count);
+	uint16 days_in_transit = this->GetDaysInTransit(cp);
 	this->feeder_share -= cp->FeederShare(count);
-	this->Parent::RemoveFromCache(cp, count);
+	this->count -= count;
+	this->cargo_days_in_transit -= days_in_transit * count;
+	if (days_in_transit != UINT16_MAX) this->aging_count -= count;
 }
 
 /**
@@ -343,8 +355,16 @@ void VehicleCargoList::RemoveFromCache(const CargoPacket *cp, uint count)
  */
 void VehicleCargoList::AddToCache(const CargoPacket *cp)
 {
+	uint16 days_in_transit = this->GetDaysInTransit(cp);
 	this->feeder_share += cp->feeder_share;
-	this->Parent::AddToCache(cp);
+	this->count += cp->count;
+	this->cargo_days_in_transit += days_in_transit * cp->count;
+	if (days_in_transit != UINT16_MAX) {
+		this->aging_count += cp->count;
+		/* Make sure the packet is brought up to date before it reaches the maximum. */
+		uint cycles = UINT16_MAX - days_in_transit;
+		if (cycles < this->CyclesUntil(this->next_capped_cycle)) this->next_capped_cycle = this->aging_cycle + cycles;
+	}
 }
 
 /**
@@ -376,17 +396,32 @@ void VehicleCargoList::AddToMeta(const CargoPacket *cp, MoveToAction action)
 }
 
 /**
- * Ages the all cargo in this list.
+ * Ages the all cargo in this list. The packets themselves are only brought
+ * up to date when they are needed, or when one of them reaches the maximum
+ * days in transit and stops aging.
  */
 void VehicleCargoList::AgeCargo()
 {
-	for (ConstIterator it(this->packets.begin()); it != this->packets.end(); it++) {
-		CargoPacket *cp = *it;
-		/* If we're at the maximum, then we can't increase no more. */
+	this->aging_cycle++;
+	this->cargo_days_in_transit += this->aging_count;
+	if (this->aging_cycle == this->next_capped_cycle) this->UpdateAllDaysInTransit();
+}
+
+/**
+ * Bring the days in transit of all packets up to date and find the next
+ * cycle at which one of them reaches the maximum days in transit.
+ */
+void VehicleCargoList::UpdateAllDaysInTransit()
+{
+	this->aging_count = 0;
+	this->next_capped_cycle = this->aging_cycle;
+	for (CargoPacket *cp : this->packets) {
+		this->UpdateDaysInTransit(cp);
 		if (cp->days_in_transit == UINT16_MAX) continue;
 
-		cp->days_in_transit++;
-		this->cargo_days_in_transit += cp->count;
+		this->aging_count += cp->count;
+		uint cycles = UINT16_MAX - cp->days_in_transit;
+		if (cycles < this->CyclesUntil(this->next_capped_cycle)) this->next_capped_cycle = this->aging_cycle + cycles;
 	}
 }
 
@@ -538,6 +573,9 @@ bool VehicleCargoList::Stage(bool accepted, StationID current_station, StationID
 void VehicleCargoList::InvalidateCache()
 {
 	this->feeder_share = 0;
+	this->aging_count = 0;
+	/* next_capped_cycle is kept: it may be earlier than needed, which only
+	 * brings the packets up to date a bit sooner. */
 	this->Parent::InvalidateCache();
 }
 
@@ -42,17 +42,20 @@ typedef uint32 TileOrStationID;
  */
 struct CargoPacket : CargoPacketPool::PoolItem<&_cargopacket_pool> {
 private:
-	Money feeder_share;     ///< Value of feeder pickup to be paid for on delivery of cargo.
+	/* The fields used when moving, merging and aging packets come first and
+	 * the members are ordered by size, so a packet takes 32 bytes. */
 	uint16 count;           ///< The amount of cargo in this packet.
 	uint16 days_in_transit; ///< Amount of days this packet has been in transit.
-	SourceType source_type; ///< Type of \c source_id.
-	SourceID source_id;     ///< Index of source, INVALID_SOURCE if unknown/invalid.
-	StationID source;       ///< The station where the cargo came from first.
-	TileIndex source_xy;    ///< The origin of the cargo (first station in feeder chain).
 	union {
 		TileOrStationID loaded_at_xy; ///< Location where this cargo has been loaded into the vehicle.
 		TileOrStationID next_station; ///< Station where the cargo wants to go next.
 	};
+	TileIndex source_xy;    ///< The origin of the cargo (first station in feeder chain).
+	StationID source;       ///< The station where the cargo came from first.
+	SourceID source_id;     ///< Index of source, INVALID_SOURCE if unknown/invalid.
+	SourceType source_type; ///< Type of \c source_id.
+	uint16 aging_cycle;     ///< Aging cycle of the vehicle cargo list #days_in_transit was last brought up to date in.
+	Money feeder_share;     ///< Value of feeder pickup to be paid for on delivery of cargo.
 
 	/** The CargoList caches, thus needs to know about it. */
 	template <class Tinst, class Tcont> friend class CargoList;
@@ -127,6 +130,8 @@ public:
 	 * Gets the number of days this cargo has been in transit.
 	 * This number isn't really in days, but in 2.5 days (CARGO_AGING_TICKS = 185 ticks) and
 	 * it is capped at UINT16_MAX.
+	 * @note Packets in a vehicle are aged lazily; the vehicle's cargo list brings
+	 *       this value up to date before it hands a packet to a cargo action.
 	 * @return Length this cargo has been in transit.
 	 */
 	inline uint16 DaysInTransit() const
@@ -273,6 +278,9 @@ protected:
 
 	Money feeder_share;                     ///< Cache for the feeder share.
 	uint action_counts[NUM_MOVE_TO_ACTION]; ///< Counts of cargo to be transferred, delivered, kept and loaded.
+	uint aging_count = 0;                   ///< Cache for the amount of cargo that has not reached the maximum days in transit yet.
+	uint16 aging_cycle = 0;                 ///< Number of times the cargo was aged, modulo 2^16.
+	uint16 next_capped_cycle = 0;           ///< Cache for the aging cycle at which the next packet may reach the maximum days in transit.
 
 	template<class Taction>
 	void ShiftCargo(Taction action);
@@ -297,6 +305,49 @@ protected:
 	void AddToMeta(const CargoPacket *cp, MoveToAction action);
 	void RemoveFromMeta(const CargoPacket *cp, MoveToAction action, uint count);
 
+	/**
+	 * Get the number of aging cycles until the given cycle is reached.
+	 * @param cycle The cycle.
+	 * @return Number of cycles, between 1 and 2^16.
+	 */
+	inline uint CyclesUntil(uint16 cycle) const
+	{
+		return static_cast<uint16>(cycle - this->aging_cycle - 1) + 1;
+	}
+
+	/**
+	 * Get the current days in transit of a packet in this list. The days
+	 * in transit of the packet are those of the aging cycle it was last
+	 * brought up to date in.
+	 * @param cp Packet in this list.
+	 * @return Days in transit of the packet.
+	 */
+	inline uint16 GetDaysInTransit(const CargoPacket *cp) const
+	{
+		return std::min<uint>(cp->days_in_transit + static_cast<uint16>(this->aging_cycle - cp->aging_cycle), UINT16_MAX);
+	}
+
+	/**
+	 * Bring the days in transit of a packet in this list up to date.
+	 * @param cp Packet in this list.
+	 */
+	inline void UpdateDaysInTransit(CargoPacket *cp) const
+	{
+		cp->days_in_transit = this->GetDaysInTransit(cp);
+		cp->aging_cycle = this->aging_cycle;
+	}
+
+	/**
+	 * Take over a packet that is up to date in another list, so it is up to date in this list.
+	 * @param cp Packet that is up to date in its previous list.
+	 */
+	inline void TakeOverAging(CargoPacket *cp) const
+	{
+		cp->aging_cycle = this->aging_cycle;
+	}
+
+	void UpdateAllDaysInTransit();
+
 	static MoveToAction ChooseAction(const CargoPacket *cp, StationID cargo_next,
 			StationID current_station, bool accepted, StationIDStack next_station);
 
@@ -300,6 +300,61 @@ static void TileLoop_Clear(TileIndex tile)
 	MarkTileDirtyByTile(tile);
 }
 
+/** Actions of a planned tile loop of a clear tile. */
+enum ClearTileLoopAction {
+	CTLA_NONE,    ///< Nothing changes.
+	CTLA_COUNTER, ///< Increase the update counter.
+	CTLA_GROW,    ///< Reset the update counter and let the grass grow.
+};
+
+/**
+ * Get the state of a clear tile the outcome of its tile loop depends on.
+ * @param tile The tile.
+ * @return The ground type, density and update counter.
+ */
+static uint32 GetClearTileLoopState(TileIndex tile)
+{
+	return GetClearGround(tile) << 8 | GetClearDensity(tile) << 4 | GetClearCounter(tile);
+}
+
+static bool PlanTileLoop_Clear(TileIndex tile, TileLoopPlan *plan)
+{
+	/* Snow and desert depend on the climate zones, the editor draws random numbers and fields look at their neighbours. */
+	if (_settings_game.game_creation.landscape == LT_ARCTIC || _settings_game.game_creation.landscape == LT_TROPIC) return false;
+	if (_game_mode == GM_EDITOR || IsClearGround(tile, CLEAR_FIELDS)) return false;
+
+	plan->state = GetClearTileLoopState(tile);
+	if (!IsClearGround(tile, CLEAR_GRASS) || GetClearDensity(tile) == 3) {
+		plan->action = CTLA_NONE;
+	} else {
+		plan->action = GetClearCounter(tile) < 7 ? CTLA_COUNTER : CTLA_GROW;
+	}
+	return true;
+}
+
+static bool CommitTileLoop_Clear(TileIndex tile, const TileLoopPlan &plan)
+{
+	if (GetClearTileLoopState(tile) != plan.state) return false;
+
+	AmbientSoundEffect(tile);
+
+	switch (plan.action) {
+		case CTLA_COUNTER:
+			AddClearCounter(tile, 1);
+			break;
+
+		case CTLA_GROW:
+			SetClearCounter(tile, 0);
+			AddClearDensity(tile, 1);
+			MarkTileDirtyByTile(tile);
+			break;
+
+		default:
+			break;
+	}
+	return true;
+}
+
 void GenerateClearTile()
 {
 	uint i, gi;
@@ -390,4 +445,6 @@ extern const TileTypeProcs _tile_type_clear_procs = {
 	nullptr,                     ///< vehicle_enter_tile_proc
 	GetFoundation_Clear,      ///< get_foundation_proc
 	TerraformTile_Clear,      ///< terraform_tile_proc
+	PlanTileLoop_Clear,       ///< plan_tile_loop_proc
+	CommitTileLoop_Clear,     ///< commit_tile_loop_proc
 };
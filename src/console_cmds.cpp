@@ -46,7 +46,10 @@
 #include "walltime_func.h"
 #include "company_cmd.h"
 #include "misc_cmd.h"
+#include "pathfinder/yapf/yapf_benchmark.h"
+#include "station_base.h"
 
+#include <chrono>
 #include <sstream>
 
 #include "safeguards.h"
@@ -2366,6 +2369,125 @@ DEF_CONSOLE_CMD(ConFramerateWindow)
 	return true;
 }
 
+DEF_CONSOLE_CMD(ConBenchmarkPathfinder)
+{
+	if (argc == 0) {
+		IConsolePrint(CC_HELP, "Replay pathfinder queries recorded with '-d pfquery=1' against the current game. Usage: 'benchmark_pathfinder <file> [<rounds>]'.");
+		return true;
+	}
+
+	if (argc < 2 || argc > 3) return false;
+
+	if (_game_mode != GM_NORMAL) {
+		IConsolePrint(CC_ERROR, "This command is only available in-game.");
+		return true;
+	}
+
+	/* Replaying takes a while, during which a client would not keep up with the server. */
+	if (_networking && !_network_server) {
+		IConsolePrint(CC_ERROR, "Only the server can replay pathfinder queries.");
+		return true;
+	}
+
+	FILE *f = FioFOpenFile(argv[1], "r", BASE_DIR);
+	if (f == nullptr) {
+		IConsolePrint(CC_ERROR, "Query file '{}' not found.", argv[1]);
+		return true;
+	}
+
+	std::vector<YapfQuery> queries;
+	uint invalid = 0;
+	char line[256];
+	while (fgets(line, sizeof(line), f) != nullptr) {
+		YapfQuery query;
+		if (ParseYapfQuery(line, &query)) {
+			queries.push_back(query);
+		} else {
+			invalid++;
+		}
+	}
+	FioFCloseFile(f);
+	if (invalid != 0) IConsolePrint(CC_WARNING, "Ignored {} invalid lines.", invalid);
+
+	uint rounds = argc == 3 ? std::max(atoi(argv[2]), 1) : 1;
+	YapfQueryStats stats[YQT_END] = {};
+	for (uint i = 0; i < rounds; i++) ReplayYapfQueries(queries, stats);
+
+	static const char * const names[] = { "Trains", "Road vehicles", "Ships" };
+	static_assert(lengthof(names) == YQT_END);
+	for (uint type = 0; type < YQT_END; type++) {
+		const YapfQueryStats &s = stats[type];
+		if (s.queries == 0 && s.skipped == 0) continue;
+		uint queries = std::max(s.queries, 1U);
+		uint64 segments = std::max<uint64>(s.cache_hits + s.cache_misses, 1);
+		IConsolePrint(CC_DEFAULT, "{}: {} queries, {} skipped, {:.1f} nodes/query, {:.1f}% segment cache hits, {:.1f} us/query, {:.1f} ms total",
+				names[type], s.queries, s.skipped, (double)s.nodes / queries, 100.0 * s.cache_hits / segments, s.time_ns / 1000.0 / queries, s.time_ns / 1000000.0);
+	}
+	return true;
+}
+
+DEF_CONSOLE_CMD(ConBenchmarkFlows)
+{
+	if (argc == 0) {
+		IConsolePrint(CC_HELP, "Time the lookups of the planned cargo flows of all stations in the current game. Usage: 'benchmark_flows [<rounds>]'.");
+		return true;
+	}
+
+	if (argc > 2) return false;
+
+	if (_game_mode != GM_NORMAL) {
+		IConsolePrint(CC_ERROR, "This command is only available in-game.");
+		return true;
+	}
+
+	uint rounds = argc == 2 ? std::max(atoi(argv[1]), 1) : 1;
+
+	/* Picking a next hop draws random numbers; don't let that change the game. */
+	SavedRandomSeeds saved_seeds;
+	SaveRandomSeeds(&saved_seeds);
+
+	uint64 lookups = 0;
+	uint64 changes = 0;
+	uint64 lookup_ns = 0;
+	uint64 change_ns = 0;
+	uint checksum = 0;
+	for (uint round = 0; round < rounds; round++) {
+		/* Routing a cargo packet: find the flows of its origin and draw a next hop. */
+		auto start = std::chrono::steady_clock::now();
+		for (const Station *st : Station::Iterate()) {
+			for (CargoID c = 0; c < NUM_CARGO; c++) {
+				const GoodsEntry &ge = st->goods[c];
+				for (const auto &flow : ge.flows) {
+					checksum += ge.GetVia(flow.first);
+					lookups++;
+				}
+			}
+		}
+		lookup_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+
+		/* Rerouting cargo: remove the share of the station itself from a copy of the flows. */
+		start = std::chrono::steady_clock::now();
+		for (const Station *st : Station::Iterate()) {
+			for (CargoID c = 0; c < NUM_CARGO; c++) {
+				for (const auto &flow : st->goods[c].flows) {
+					FlowStat shares = flow.second;
+					shares.ChangeShare(st->index, INT_MIN);
+					checksum += (uint)shares.GetShares()->size();
+					changes++;
+				}
+			}
+		}
+		change_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	RestoreRandomSeeds(saved_seeds);
+
+	IConsolePrint(CC_DEFAULT, "Next hop lookups: {}, {:.1f} ns/lookup, {:.1f} ms total", lookups, (double)lookup_ns / std::max<uint64>(lookups, 1), lookup_ns / 1000000.0);
+	IConsolePrint(CC_DEFAULT, "Share changes: {}, {:.1f} ns/change, {:.1f} ms total", changes, (double)change_ns / std::max<uint64>(changes, 1), change_ns / 1000000.0);
+	IConsolePrint(CC_DEFAULT, "Checksum: {}", checksum);
+	return true;
+}
+
 static void ConDumpRoadTypes()
 {
 	IConsolePrint(CC_DEFAULT, "  Flags:");
@@ -2653,6 +2775,8 @@ void IConsoleStdLibRegister()
 #endif
 	IConsole::CmdRegister("fps",                     ConFramerate);
 	IConsole::CmdRegister("fps_wnd",                 ConFramerateWindow);
+	IConsole::CmdRegister("benchmark_pathfinder",    ConBenchmarkPathfinder);
+	IConsole::CmdRegister("benchmark_flows",         ConBenchmarkFlows);
 
 	/* NewGRF development stuff */
 	IConsole::CmdRegister("reload_newgrfs",          ConNewGRFReload,     ConHookNewGRFDeveloperTool);
@@ -0,0 +1,195 @@
+/*
+ * This file is part of OpenTTD.
+ * OpenTTD is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, version 2.
+ * OpenTTD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file flatmap_type.hpp Map stored as a sorted vector, for small maps that are looked up much more often than changed. */
+
+#ifndef FLATMAP_TYPE_HPP
+#define FLATMAP_TYPE_HPP
+
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+/**
+ * Map with the interface and iteration order of std::map, but with its
+ * items stored in a sorted vector. Lookups are binary searches over
+ * contiguous memory, and adding items in ascending order of their keys
+ * only appends them. Unlike with std::map, inserting or erasing items
+ * invalidates all iterators and pointers to items.
+ * @tparam Tkey Key type.
+ * @tparam Tvalue Value type.
+ * @tparam Tcompare Comparator for the keys.
+ */
+template <typename Tkey, typename Tvalue, typename Tcompare = std::less<Tkey>>
+class FlatMap {
+public:
+	typedef Tkey key_type;
+	typedef Tvalue mapped_type;
+	typedef std::pair<Tkey, Tvalue> value_type;
+	typedef typename std::vector<value_type>::size_type size_type;
+	typedef typename std::vector<value_type>::iterator iterator;
+	typedef typename std::vector<value_type>::const_iterator const_iterator;
+	typedef typename std::vector<value_type>::reverse_iterator reverse_iterator;
+	typedef typename std::vector<value_type>::const_reverse_iterator const_reverse_iterator;
+
+private:
+	std::vector<value_type> items; ///< The items, in ascending order of their keys.
+
+	/** Compare the key of an item with a key. */
+	static bool KeyLess(const value_type &item, const Tkey &key) { return Tcompare()(item.first, key); }
+	/** Compare a key with the key of an item. */
+	static bool LessKey(const Tkey &key, const value_type &item) { return Tcompare()(key, item.first); }
+
+public:
+	inline iterator begin() { return this->items.begin(); }
+	inline iterator end() { return this->items.end(); }
+	inline const_iterator begin() const { return this->items.begin(); }
+	inline const_iterator end() const { return this->items.end(); }
+	inline reverse_iterator rbegin() { return this->items.rbegin(); }
+	inline reverse_iterator rend() { return this->items.rend(); }
+	inline const_reverse_iterator rbegin() const { return this->items.rbegin(); }
+	inline const_reverse_iterator rend() const { return this->items.rend(); }
+
+	inline size_type size() const { return this->items.size(); }
+	inline bool empty() const { return this->items.empty(); }
+	inline void clear() { this->items.clear(); }
+	inline void reserve(size_type count) { this->items.reserve(count); }
+	inline void swap(FlatMap &other) { this->items.swap(other.items); }
+
+	inline bool operator==(const FlatMap &other) const { return this->items == other.items; }
+	inline bool operator!=(const FlatMap &other) const { return this->items != other.items; }
+
+	inline iterator lower_bound(const Tkey &key) { return std::lower_bound(this->items.begin(), this->items.end(), key, &KeyLess); }
+	inline const_iterator lower_bound(const Tkey &key) const { return std::lower_bound(this->items.begin(), this->items.end(), key, &KeyLess); }
+	inline iterator upper_bound(const Tkey &key) { return std::upper_bound(this->items.begin(), this->items.end(), key, &LessKey); }
+	inline const_iterator upper_bound(const Tkey &key) const { return std::upper_bound(this->items.begin(), this->items.end(), key, &LessKey); }
+
+	/**
+	 * Find the item with the given key.
+	 * @param key Key to look for.
+	 * @return Iterator to the item, or end() if there is none.
+	 */
+	inline iterator find(const Tkey &key)
+	{
+		iterator it = this->lower_bound(key);
+		return (it == this->end() || Tcompare()(key, it->first)) ? this->end() : it;
+	}
+
+	/**
+	 * Find the item with the given key.
+	 * @param key Key to look for.
+	 * @return Iterator to the item, or end() if there is none.
+	 */
+	inline const_iterator find(const Tkey &key) const
+	{
+		const_iterator it = this->lower_bound(key);
+		return (it == this->end() || Tcompare()(key, it->first)) ? this->end() : it;
+	}
+
+	inline size_type count(const Tkey &key) const { return this->find(key) != this->end() ? 1 : 0; }
+
+	/**
+	 * Insert an item, unless there already is an item with its key.
+	 * @param item Item to insert.
+	 * @return Iterator to the item with the key, and whether the item was inserted.
+	 */
+	std::pair<iterator, bool> insert(value_type item)
+	{
+		/* Items are often added in ascending order; don't search for those. */
+		if (this->items.empty() || Tcompare()(this->items.back().first, item.first)) {
+			this->items.push_back(std::move(item));
+			return { this->items.end() - 1, true };
+		}
+
+		iterator it = this->lower_bound(item.first);
+		if (it != this->end() && !Tcompare()(item.first, it->first)) return { it, false };
+		return { this->items.insert(it, std::move(item)), true };
+	}
+
+	/**
+	 * Insert a range of items, skipping the ones whose keys are already in the map.
+	 * @param first First item to insert.
+	 * @param last End of the items to insert.
+	 */
+	template <typename Titer>
+	void insert(Titer first, Titer last)
+	{
+		for (; first != last; ++first) this->insert(value_type(*first));
+	}
+
+	/**
+	 * Get the value for a key, inserting a default constructed one if there is none.
+	 * @param key Key to look for.
+	 * @return Reference to the value.
+	 */
+	Tvalue &operator[](const Tkey &key)
+	{
+		if (this->items.empty() || Tcompare()(this->items.back().first, key)) {
+			this->items.emplace_back(key, Tvalue());
+			return this->items.back().second;
+		}
+
+		iterator it = this->lower_bound(key);
+		if (it == this->end() || Tcompare()(key, it->first)) it = this->items.insert(it, value_type(key, Tvalue()));
+		return it->second;
+	}
+
+	/**
+	 * Erase an item.
+	 * @param it Iterator to the item.
+	 * @return Iterator to the item after the erased one.
+	 */
+	inline iterator erase(const_iterator it) { return this->items.erase(it); }
+
+	/**
+	 * Merge the items of another map into this one in a single pass over
+	 * both, as both are sorted. Items only in the other map are added.
+	 * @param other Map to merge; its items are moved out of it.
+	 * @param merge Called with the key, the value in this map and the value in the other map of the items in both maps.
+	 *              The item is kept with the value in this map if it returns true.
+	 * @param keep Called with the key and the value of the items only in this map. The item is kept if it returns true.
+	 */
+	template <typename Tmerge, typename Tkeep>
+	void Merge(FlatMap &&other, Tmerge merge, Tkeep keep)
+	{
+		std::vector<value_type> merged;
+		merged.reserve(this->items.size() + other.items.size());
+
+		auto other_it = other.items.begin();
+		for (value_type &item : this->items) {
+			for (; other_it != other.items.end() && Tcompare()(other_it->first, item.first); ++other_it) merged.push_back(std::move(*other_it));
+
+			if (other_it != other.items.end() && !Tcompare()(item.first, other_it->first)) {
+				if (merge(item.first, item.second, other_it->second)) merged.push_back(std::move(item));
+				++other_it;
+			} else if (keep(item.first, item.second)) {
+				merged.push_back(std::move(item));
+			}
+		}
+		std::move(other_it, other.items.end(), std::back_inserter(merged));
+
+		other.items.clear();
+		this->items.swap(merged);
+	}
+
+	/**
+	 * Erase the item with the given key, if there is one.
+	 * @param key Key of the item.
+	 * @return Number of erased items.
+	 */
+	size_type erase(const Tkey &key)
+	{
+		iterator it = this->find(key);
+		if (it == this->end()) return 0;
+		this->items.erase(it);
+		return 1;
+	}
+};
+
+#endif /* FLATMAP_TYPE_HPP */
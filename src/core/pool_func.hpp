@@ -92,6 +92,24 @@ DEFINE_POOL_METHOD(inline size_t)::FindFirstFree()
 	return NO_FREE_ITEM;
 }
 
+/**
+ * Allocates memory for Tgrowth_step items at once and puts it into the alloc
+ * cache. Items allocated after each other then lie next to each other in
+ * memory, without the overhead of a separate allocation for every item.
+ */
+DEFINE_POOL_METHOD(inline void)::AllocateCacheBlock()
+{
+	byte *block = MallocT<byte>(sizeof(Titem) * Tgrowth_step);
+	this->alloc_blocks.push_back(block);
+
+	/* Link the items back to front, so they are handed out in order of address. */
+	for (size_t i = Tgrowth_step; i-- > 0;) {
+		AllocCache *ac = (AllocCache *)(block + i * sizeof(Titem));
+		ac->next = this->alloc_cache;
+		this->alloc_cache = ac;
+	}
+}
+
 /**
  * Makes given index valid
  * @param size size of item
@@ -107,8 +125,9 @@ DEFINE_POOL_METHOD(inline void *)::AllocateItem(size_t size, size_t index)
 	this->items++;
 
 	Titem *item;
-	if (Tcache && this->alloc_cache != nullptr) {
+	if (Tcache) {
 		assert(sizeof(Titem) == size);
+		if (this->alloc_cache == nullptr) this->AllocateCacheBlock();
 		item = (Titem *)this->alloc_cache;
 		this->alloc_cache = this->alloc_cache->next;
 		if (Tzero) {
@@ -207,11 +226,10 @@ DEFINE_POOL_METHOD(void)::CleanPool()
 	this->cleaning = false;
 
 	if (Tcache) {
-		while (this->alloc_cache != nullptr) {
-			AllocCache *ac = this->alloc_cache;
-			this->alloc_cache = ac->next;
-			free(ac);
-		}
+		/* The cached items are part of the blocks. */
+		this->alloc_cache = nullptr;
+		for (void *block : this->alloc_blocks) free(block);
+		this->alloc_blocks.clear();
 	}
 }
 
@@ -73,7 +73,7 @@ private:
  * @tparam Tgrowth_step Size of growths; if the pool is full increase the size by this amount
  * @tparam Tmax_size    Maximum size of the pool
  * @tparam Tpool_type   Type of this pool
- * @tparam Tcache       Whether to perform 'alloc' caching, i.e. don't actually free/malloc just reuse the memory
+ * @tparam Tcache       Whether to perform 'alloc' caching, i.e. don't actually free/malloc just reuse the memory, and allocate the items in blocks
  * @tparam Tzero        Whether to zero the memory
  * @warning when Tcache is enabled *all* instances of this pool's item must be of the same size.
  */
@@ -400,8 +400,11 @@ private:
 
 	/** Cache of freed pointers */
 	AllocCache *alloc_cache;
+	/** Blocks of memory the cached items are allocated in */
+	std::vector<void *> alloc_blocks;
 
 	void *AllocateItem(size_t size, size_t index);
+	void AllocateCacheBlock();
 	void ResizeFor(size_t index);
 	size_t FindFirstFree();
 
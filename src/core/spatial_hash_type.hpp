@@ -0,0 +1,118 @@
+/*
+ * This file is part of OpenTTD.
+ * OpenTTD is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, version 2.
+ * OpenTTD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file spatial_hash_type.hpp Hash of items by their position on a grid. */
+
+#ifndef SPATIAL_HASH_TYPE_HPP
+#define SPATIAL_HASH_TYPE_HPP
+
+#include <vector>
+
+/**
+ * Hash of items by their position on a grid. The coordinates are folded into a
+ * square table of (1 << bits) by (1 << bits) buckets, so items on positions that
+ * are a multiple of (1 << bits) apart share a bucket. The number of bits can be
+ * chosen when (re)initialising the hash, so it can grow with the number of items.
+ * Each bucket stores its items in a contiguous array, so walking a bucket does not
+ * have to chase pointers from item to item.
+ * @tparam T Type of the items.
+ */
+template <class T>
+class SpatialHash {
+public:
+	static const uint INVALID_BUCKET = UINT_MAX; ///< Bucket of items that are not in the hash.
+
+	typedef std::vector<T *> Bucket; ///< Items in a bucket.
+
+	/** Create a hash with a single bucket. */
+	SpatialHash()
+	{
+		this->Reset(0);
+	}
+
+	/**
+	 * Remove all items and change the size of the hash.
+	 * @param bits Number of bits of each coordinate used for the hash.
+	 */
+	void Reset(uint bits)
+	{
+		this->bits = bits;
+		this->mask = (1U << bits) - 1;
+		this->buckets.clear();
+		this->buckets.resize(1U << (2 * bits));
+	}
+
+	/**
+	 * Get the number of bits of each coordinate used for the hash.
+	 * @return The number of bits.
+	 */
+	inline uint GetBits() const
+	{
+		return this->bits;
+	}
+
+	/**
+	 * Get the mask to apply to a coordinate to get its position in the table.
+	 * @return The mask.
+	 */
+	inline uint GetMask() const
+	{
+		return this->mask;
+	}
+
+	/**
+	 * Get the bucket for a position.
+	 * @param x X coordinate of the position.
+	 * @param y Y coordinate of the position.
+	 * @return The bucket.
+	 */
+	inline uint GetBucket(uint x, uint y) const
+	{
+		return (x & this->mask) | (y & this->mask) << this->bits;
+	}
+
+	/**
+	 * Get the items in a bucket.
+	 * @param bucket The bucket.
+	 * @return The items, in order of insertion.
+	 */
+	inline const Bucket &GetItems(uint bucket) const
+	{
+		return this->buckets[bucket];
+	}
+
+	/**
+	 * Add an item to a bucket.
+	 * @param bucket The bucket.
+	 * @param item   The item to add.
+	 */
+	inline void Insert(uint bucket, T *item)
+	{
+		this->buckets[bucket].push_back(item);
+	}
+
+	/**
+	 * Remove an item from a bucket, keeping the order of the other items.
+	 * @param bucket The bucket.
+	 * @param item   The item to remove.
+	 * @pre The item is in the bucket.
+	 */
+	inline void Remove(uint bucket, T *item)
+	{
+		Bucket &items = this->buckets[bucket];
+		auto it = std::find(items.begin(), items.end(), item);
+		assert(it != items.end());
+		items.erase(it);
+	}
+
+private:
+	uint bits = 0;                ///< Number of bits of each coordinate used for the hash.
+	uint mask = 0;                ///< Mask of the used bits of each coordinate.
+	std::vector<Bucket> buckets;  ///< The buckets of the hash.
+};
+
+#endif /* SPATIAL_HASH_TYPE_HPP */
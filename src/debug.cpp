@@ -46,6 +46,7 @@ int _debug_sprite_level;
 int _debug_oldloader_level;
 int _debug_npf_level;
 int _debug_yapf_level;
+int _debug_pfquery_level;
 int _debug_fontcache_level;
 int _debug_script_level;
 int _debug_sl_level;
@@ -72,6 +73,7 @@ struct DebugLevel {
 	DEBUG_LEVEL(oldloader),
 	DEBUG_LEVEL(npf),
 	DEBUG_LEVEL(yapf),
+	DEBUG_LEVEL(pfquery),
 	DEBUG_LEVEL(fontcache),
 	DEBUG_LEVEL(script),
 	DEBUG_LEVEL(sl),
@@ -134,6 +136,12 @@ void DebugPrint(const char *level, const std::string &message)
 
 		fprintf(f, "%s%s\n", GetLogPrefix(), message.c_str());
 		fflush(f);
+	} else if (strcmp(level, "pfquery") == 0) {
+		static FILE *f = FioFOpenFile("pathfinder-queries.log", "wb", AUTOSAVE_DIR);
+		if (f == nullptr) return;
+
+		fprintf(f, "%s\n", message.c_str());
+		fflush(f);
 #ifdef RANDOM_DEBUG
 	} else if (strcmp(level, "random") == 0) {
 		static FILE *f = FioFOpenFile("random-out.log", "wb", AUTOSAVE_DIR);
@@ -46,6 +46,7 @@ extern int _debug_sprite_level;
 extern int _debug_oldloader_level;
 extern int _debug_npf_level;
 extern int _debug_yapf_level;
+extern int _debug_pfquery_level;
 extern int _debug_fontcache_level;
 extern int _debug_script_level;
 extern int _debug_sl_level;
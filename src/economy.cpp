@@ -48,6 +48,7 @@
 #include "goal_base.h"
 #include "story_base.h"
 #include "linkgraph/refresh.h"
+#include "pathfinder/yapf/yapf_cache.h"
 #include "company_cmd.h"
 #include "economy_cmd.h"
 #include "vehicle_cmd.h"
@@ -495,6 +496,11 @@ void ChangeOwnershipOfCompanyItems(Owner old_owner, Owner new_owner)
 			ChangeTileOwner(tile, old_owner, new_owner);
 		} while (++tile != Map::Size());
 
+		/* Cached rail segments end at track of other owners, which may be followed now.
+		 * Cached road segments know the owners of the depots and road stops they end at. */
+		YapfNotifyTrackLayoutChange(INVALID_TILE, INVALID_TRACK);
+		YapfNotifyRoadLayoutChange(INVALID_TILE);
+
 		if (new_owner != INVALID_OWNER) {
 			/* Update all signals because there can be new segment that was owned by two companies
 			 * and signals were not propagated
@@ -515,6 +521,9 @@ void ChangeOwnershipOfCompanyItems(Owner old_owner, Owner new_owner)
 			} while (++tile != Map::Size());
 		}
 
+		/* tiles without signals changed owner as well, so signal blocks may be larger now */
+		InvalidateSignalBlocks();
+
 		/* update signals in buffer */
 		UpdateSignalsInBuffer();
 	}
@@ -1271,7 +1280,7 @@ Money CargoPayment::PayTransfer(const CargoPacket *cp, uint count)
 void PrepareUnload(Vehicle *front_v)
 {
 	Station *curr_station = Station::Get(front_v->last_station_visited);
-	curr_station->loading_vehicles.push_back(front_v);
+	curr_station->AddLoadingVehicle(front_v);
 
 	/* At this moment loading cannot be finished */
 	ClrBit(front_v->vehicle_flags, VF_LOADING_FINISHED);
@@ -1968,6 +1977,10 @@ void LoadUnloadStation(Station *st)
 	 */
 	if (last_loading == nullptr) return;
 
+	/* Each vehicle reserves its cargo while it is loaded, in the order the
+	 * vehicles entered. Cargo unloaded by a vehicle can be reserved by the
+	 * ones after it, and every vehicle reserves for its own next hops, so the
+	 * reservations can't be combined into a single pass over the cargo. */
 	for (iter = st->loading_vehicles.begin(); iter != st->loading_vehicles.end(); ++iter) {
 		Vehicle *v = *iter;
 		if (!(v->vehstatus & (VS_STOPPED | VS_CRASHED))) LoadUnloadVehicle(v);
@@ -24,6 +24,7 @@
 #include "game/game_instance.hpp"
 #include "timer/timer.h"
 #include "timer/timer_window.h"
+#include "pathfinder/yapf/yapf_cache.h"
 
 #include "widgets/framerate_widget.h"
 
@@ -385,6 +386,7 @@ static const NWidgetPart _framerate_window_widgets[] = {
 			NWidget(WWT_TEXT, COLOUR_GREY, WID_FRW_RATE_GAMELOOP), SetDataTip(STR_FRAMERATE_RATE_GAMELOOP, STR_FRAMERATE_RATE_GAMELOOP_TOOLTIP), SetFill(1, 0), SetResize(1, 0),
 			NWidget(WWT_TEXT, COLOUR_GREY, WID_FRW_RATE_DRAWING),  SetDataTip(STR_FRAMERATE_RATE_BLITTER,  STR_FRAMERATE_RATE_BLITTER_TOOLTIP), SetFill(1, 0), SetResize(1, 0),
 			NWidget(WWT_TEXT, COLOUR_GREY, WID_FRW_RATE_FACTOR),   SetDataTip(STR_FRAMERATE_SPEED_FACTOR,  STR_FRAMERATE_SPEED_FACTOR_TOOLTIP), SetFill(1, 0), SetResize(1, 0),
+			NWidget(WWT_TEXT, COLOUR_GREY, WID_FRW_RATE_PF_CACHE), SetDataTip(STR_FRAMERATE_PF_CACHE,      STR_FRAMERATE_PF_CACHE_TOOLTIP), SetFill(1, 0), SetResize(1, 0),
 		EndContainer(),
 	EndContainer(),
 	NWidget(NWID_HORIZONTAL),
@@ -446,6 +448,8 @@ struct FramerateWindow : Window {
 	CachedDecimal speed_gameloop;           ///< cached game loop speed factor
 	CachedDecimal times_shortterm[PFE_MAX]; ///< cached short term average times
 	CachedDecimal times_longterm[PFE_MAX];  ///< cached long term average times
+	uint64 pf_cache_hits = 0;               ///< cached number of rail segment cache hits
+	uint64 pf_cache_misses = 0;             ///< cached number of rail segment cache misses
 
 	static constexpr int MIN_ELEMENTS = 5;      ///< smallest number of elements to display
 
@@ -487,6 +491,7 @@ struct FramerateWindow : Window {
 		if (this->small) return; // in small mode, this is everything needed
 
 		this->rate_drawing.SetRate(_pf_data[PFE_DRAWING].GetRate(), _settings_client.gui.refresh_rate);
+		YapfGetSegmentCacheStats(&this->pf_cache_hits, &this->pf_cache_misses);
 
 		int new_active = 0;
 		for (PerformanceElement e = PFE_FIRST; e < PFE_MAX; e++) {
@@ -535,6 +540,10 @@ struct FramerateWindow : Window {
 			case WID_FRW_RATE_FACTOR:
 				this->speed_gameloop.InsertDParams(0);
 				break;
+			case WID_FRW_RATE_PF_CACHE:
+				SetDParam(0, this->pf_cache_hits);
+				SetDParam(1, this->pf_cache_misses);
+				break;
 			case WID_FRW_INFO_DATA_POINTS:
 				SetDParam(0, NUM_FRAMERATE_POINTS);
 				break;
@@ -561,6 +570,11 @@ struct FramerateWindow : Window {
 				SetDParam(1, 2);
 				*size = GetStringBoundingBox(STR_FRAMERATE_SPEED_FACTOR);
 				break;
+			case WID_FRW_RATE_PF_CACHE:
+				SetDParamMaxValue(0, 999999999);
+				SetDParamMaxValue(1, 999999999);
+				*size = GetStringBoundingBox(STR_FRAMERATE_PF_CACHE);
+				break;
 
 			case WID_FRW_TIMES_NAMES: {
 				size->width = 0;
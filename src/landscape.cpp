@@ -37,6 +37,9 @@
 #include "landscape_cmd.h"
 #include "terraform_cmd.h"
 #include "station_func.h"
+#include "pathfinder/water_regions.h"
+#include "pathfinder/yapf/yapf_cache.h"
+#include "task_pool.h"
 #include <array>
 #include <list>
 #include <set>
@@ -542,6 +545,8 @@ void DoClearSquare(TileIndex tile)
 	MakeClear(tile, CLEAR_GRASS, _generating_world ? 3 : 0);
 	MarkTileDirtyByTile(tile);
 	if (remove) RemoveDockingTile(tile);
+	InvalidateWaterRegion(tile);
+	YapfNotifyRoadLayoutChange(tile);
 }
 
 /**
@@ -754,6 +759,56 @@ std::tuple<CommandCost, Money> CmdClearArea(DoCommandFlag flags, TileIndex tile,
 
 
 TileIndex _cur_tileloop_tile;
+bool _parallel_tile_loop; ///< Evaluate the tile loop of tiles that only affect themselves on the task threads.
+
+static const uint TILE_LOOP_SHARD_SIZE = 1024; ///< Number of consecutive tiles of the tile loop sequence planned at once by a worker.
+
+/**
+ * Run the tile loop for a part of the tile sequence in two passes. First the sequence is
+ * split into shards that are planned in parallel by the tile types that support it,
+ * then all tiles are processed in sequence order, performing the planned outcome and
+ * its side effects if the tile did not change in the meantime, or the normal tile loop
+ * otherwise. The result is identical to running the normal tile loop for all tiles.
+ *
+ * Only the decisions that read the tile state are planned; the commit merely compares
+ * the state the plan depends on and applies the outcome. Tiles whose tile loop draws
+ * random numbers or calls NewGRF callbacks before it knows the outcome, like houses
+ * and industries, or that depends on neighbours changed earlier in the same pass, like
+ * coasts and flooding next to land, always run the normal tile loop in sequence.
+ * @param tile     First tile of the sequence.
+ * @param count    Number of tiles to process.
+ * @param feedback Feedback term of the LFSR generating the sequence.
+ * @return The tile following the processed part of the sequence.
+ */
+static TileIndex RunTileLoopPlanned(TileIndex tile, uint count, uint32 feedback)
+{
+	static std::vector<TileIndex> tiles;
+	static std::vector<TileLoopPlan> plans;
+	tiles.resize(count);
+	plans.resize(count);
+
+	for (uint i = 0; i < count; i++) {
+		tiles[i] = tile;
+		tile = (tile >> 1) ^ (-(int32)(tile & 1) & feedback);
+	}
+
+	RunTasks(count, TILE_LOOP_SHARD_SIZE, [](size_t first, size_t last) {
+		for (size_t i = first; i < last; i++) {
+			TileType type = GetTileType(tiles[i]);
+			PlanTileLoopProc *proc = _tile_type_procs[type]->plan_tile_loop_proc;
+			plans[i].type = (proc != nullptr && proc(tiles[i], &plans[i])) ? type : MP_VOID;
+		}
+	});
+
+	for (uint i = 0; i < count; i++) {
+		TileType type = GetTileType(tiles[i]);
+		/* Only types with a plan_tile_loop_proc get planned, and those have a commit_tile_loop_proc as well. */
+		if (plans[i].type == type && _tile_type_procs[type]->commit_tile_loop_proc(tiles[i], plans[i])) continue;
+		_tile_type_procs[type]->tile_loop_proc(tiles[i]);
+	}
+
+	return tile;
+}
 
 /**
  * Gradually iterate over all tiles on the map, calling their TileLoopProcs once every 256 ticks.
@@ -787,11 +842,15 @@ void RunTileLoop()
 		count--;
 	}
 
-	while (count--) {
-		_tile_type_procs[GetTileType(tile)]->tile_loop_proc(tile);
+	if (_parallel_tile_loop && count > TILE_LOOP_SHARD_SIZE) {
+		tile = RunTileLoopPlanned(tile, count, feedback);
+	} else {
+		while (count--) {
+			_tile_type_procs[GetTileType(tile)]->tile_loop_proc(tile);
 
-		/* Get the next tile in sequence using a Galois LFSR. */
-		tile = (tile >> 1) ^ (-(int32)(tile & 1) & feedback);
+			/* Get the next tile in sequence using a Galois LFSR. */
+			tile = (tile >> 1) ^ (-(int32)(tile & 1) & feedback);
+		}
 	}
 
 	_cur_tileloop_tile = tile;
@@ -26,6 +26,8 @@ struct SnowLine {
 	byte lowest_value;  ///< Lowest snow line of the year
 };
 
+extern bool _parallel_tile_loop;
+
 bool IsSnowLineSet();
 void SetSnowLine(byte table[SNOW_LINE_MONTHS][SNOW_LINE_DAYS]);
 byte GetSnowLine();
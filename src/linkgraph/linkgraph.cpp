@@ -30,6 +30,9 @@ LinkGraph::BaseNode::BaseNode(TileIndex xy, StationID st, uint demand)
 	this->demand = demand;
 	this->station = st;
 	this->last_update = INVALID_DATE;
+	this->recalc_supply = 0;
+	this->recalc_demand = 0;
+	this->recalc_edges = 0;
 }
 
 /**
@@ -43,6 +46,9 @@ LinkGraph::BaseEdge::BaseEdge(NodeID dest_node)
 	this->last_unrestricted_update = INVALID_DATE;
 	this->last_restricted_update = INVALID_DATE;
 	this->dest_node = dest_node;
+	this->recalc_capacity = 0;
+	this->recalc_travel_time = 0;
+	this->recalc_restriction = 0;
 }
 
 /**
@@ -83,6 +89,64 @@ void LinkGraph::Compress()
 	}
 }
 
+/**
+ * Check whether a value differs from a reference value by more than the given percentage.
+ * @param value Current value.
+ * @param reference Reference value.
+ * @param threshold Allowed difference, in percent of the reference value.
+ * @return True iff the difference is too large.
+ */
+static bool ChangedBeyond(uint value, uint reference, uint threshold)
+{
+	uint64 diff = value > reference ? value - reference : reference - value;
+	return diff * 100 > static_cast<uint64>(reference) * threshold;
+}
+
+/**
+ * Check whether the component changed enough since it was last recalculated
+ * to warrant a new calculation. Nodes or edges that were added or removed,
+ * changes in acceptance or link restrictions always count. Supply, capacity
+ * and travel time count if they changed by more than the given percentage.
+ * Supply and capacity are compared as monthly values, as they accumulate
+ * between compressions.
+ * @param threshold Allowed change in percent, or 0 to always recalculate.
+ * @return True iff the component has to be recalculated.
+ */
+bool LinkGraph::NeedsRecalculation(uint threshold) const
+{
+	if (threshold == 0 || this->recalc_size != this->Size()) return true;
+
+	for (const BaseNode &node : this->nodes) {
+		if (node.demand != node.recalc_demand || node.edges.size() != node.recalc_edges) return true;
+		if (ChangedBeyond(this->Monthly(node.supply), node.recalc_supply, threshold)) return true;
+		for (const BaseEdge &edge : node.edges) {
+			if (edge.RestrictionState() != edge.recalc_restriction) return true;
+			if (ChangedBeyond(this->Monthly(edge.capacity), edge.recalc_capacity, threshold)) return true;
+			if (ChangedBeyond(edge.TravelTime(), edge.recalc_travel_time, threshold)) return true;
+		}
+	}
+	return false;
+}
+
+/**
+ * Remember the current state of the component as the one it was last
+ * recalculated with, for #NeedsRecalculation.
+ */
+void LinkGraph::MarkRecalculated()
+{
+	this->recalc_size = this->Size();
+	for (BaseNode &node : this->nodes) {
+		node.recalc_supply = this->Monthly(node.supply);
+		node.recalc_demand = node.demand;
+		node.recalc_edges = (uint16)node.edges.size();
+		for (BaseEdge &edge : node.edges) {
+			edge.recalc_capacity = this->Monthly(edge.capacity);
+			edge.recalc_travel_time = edge.TravelTime();
+			edge.recalc_restriction = edge.RestrictionState();
+		}
+	}
+}
+
 /**
  * Merge a link graph with another one.
  * @param other LinkGraph to be merged into this one.
@@ -49,6 +49,10 @@ public:
 		TimerGameCalendar::Date last_restricted_update;   ///< When the restricted part of the link was last updated.
 		NodeID dest_node;              ///< Destination of the edge.
 
+		uint recalc_capacity;          ///< Monthly capacity of the link when its component was last recalculated.
+		uint32 recalc_travel_time;     ///< Travel time of the link when its component was last recalculated.
+		uint8 recalc_restriction;      ///< Restriction state of the link when its component was last recalculated.
+
 		BaseEdge(NodeID dest_node = INVALID_NODE);
 
 		/**
@@ -63,6 +67,15 @@ public:
 		 */
 		TimerGameCalendar::Date LastUpdate() const { return std::max(this->last_unrestricted_update, this->last_restricted_update); }
 
+		/**
+		 * Get the restriction state of the edge.
+		 * @return Bit 0 set if the link has no unrestricted part, bit 1 set if it has no restricted part.
+		 */
+		uint8 RestrictionState() const
+		{
+			return (this->last_unrestricted_update == INVALID_DATE ? 1 : 0) | (this->last_restricted_update == INVALID_DATE ? 2 : 0);
+		}
+
 		void Update(uint capacity, uint usage, uint32 time, EdgeUpdateMode mode);
 		void Restrict() { this->last_unrestricted_update = INVALID_DATE; }
 		void Release() { this->last_restricted_update = INVALID_DATE; }
@@ -96,6 +109,10 @@ public:
 		TileIndex xy;            ///< Location of the station referred to by the node.
 		TimerGameCalendar::Date last_update;        ///< When the supply was last updated.
 
+		uint recalc_supply;      ///< Monthly supply at the station when the component was last recalculated.
+		uint recalc_demand;      ///< Acceptance at the station when the component was last recalculated.
+		uint16 recalc_edges;     ///< Number of outgoing edges when the component was last recalculated.
+
 		std::vector<BaseEdge> edges; ///< Sorted list of outgoing edges from this node.
 
 		BaseNode(TileIndex xy = INVALID_TILE, StationID st = INVALID_STATION, uint demand = 0);
@@ -191,18 +208,26 @@ public:
 	}
 
 	/** Bare constructor, only for save/load. */
-	LinkGraph() : cargo(INVALID_CARGO), last_compression(0) {}
+	LinkGraph() : cargo(INVALID_CARGO), last_compression(0), recalc_size(0) {}
 	/**
 	 * Real constructor.
 	 * @param cargo Cargo the link graph is about.
 	 */
-	LinkGraph(CargoID cargo) : cargo(cargo), last_compression(TimerGameCalendar::date) {}
+	LinkGraph(CargoID cargo) : cargo(cargo), last_compression(TimerGameCalendar::date), recalc_size(0) {}
 
 	void Init(uint size);
 	void ShiftDates(int interval);
 	void Compress();
 	void Merge(LinkGraph *other);
 
+	bool NeedsRecalculation(uint threshold) const;
+	void MarkRecalculated();
+
+	/**
+	 * Make sure the component is recalculated the next time it is due, even if it did not change.
+	 */
+	inline void ForceRecalculation() { this->recalc_size = 0; }
+
 	/* Splitting link graphs is intentionally not implemented.
 	 * The overhead in determining connectedness would probably outweigh the
 	 * benefit of having to deal with smaller graphs. In real world examples
@@ -266,6 +291,7 @@ protected:
 	CargoID cargo;         ///< Cargo of this component's link graph.
 	TimerGameCalendar::Date last_compression; ///< Last time the capacities and supplies were compressed.
 	NodeVector nodes;      ///< Nodes in the component.
+	NodeID recalc_size;    ///< Size of the component when it was last recalculated, or 0 if it has to be recalculated.
 };
 
 #endif /* LINKGRAPH_H */
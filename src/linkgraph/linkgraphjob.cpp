@@ -55,12 +55,16 @@ void LinkGraphJob::EraseFlows(NodeID from)
 }
 
 /**
- * Spawn a thread if possible and run the link graph job in the thread. If
- * that's not possible run the job right now in the current thread.
+ * Queue the link graph job on the task pool. The pool gets a thread for every
+ * job, so the job starts right away instead of waiting for the other jobs.
+ * If there are no task threads run the job right now in the current thread.
  */
 void LinkGraphJob::SpawnThread()
 {
-	if (!StartNewThread(&this->thread, "ottd:linkgraph", &(LinkGraphSchedule::Run), this)) {
+	if (GetTaskThreadCount() != 0) {
+		EnsureTaskThreads((uint)LinkGraphJob::GetNumItems());
+		this->task.Run([this]() { LinkGraphSchedule::Run(this); });
+	} else {
 		/* Of course this will hang a bit.
 		 * On the other hand, if you want to play games which make this hang noticeably
 		 * on a platform without threads then you'll probably get other problems first.
@@ -73,13 +77,11 @@ void LinkGraphJob::SpawnThread()
 }
 
 /**
- * Join the calling thread with this job's thread if threading is enabled.
+ * Wait till the job's task finished, if it runs on the task pool.
  */
 void LinkGraphJob::JoinThread()
 {
-	if (this->thread.joinable()) {
-		this->thread.join();
-	}
+	this->task.Wait();
 }
 
 /**
@@ -122,10 +124,11 @@ LinkGraphJob::~LinkGraphJob()
 
 		LinkGraph *lg = LinkGraph::Get(ge.link_graph);
 		FlowStatMap &flows = from.flows;
+		std::vector<StationID> erased_sources;
 
-		for (const auto &edge : from.edges) {
-			if (edge.Flow() == 0) continue;
-			NodeID dest_id = edge.base.dest_node;
+		for (EdgeID edge = this->FirstEdge(node_id); edge != this->EndEdge(node_id); ++edge) {
+			if (this->EdgeFlow(edge) == 0) continue;
+			NodeID dest_id = this->EdgeDestination(edge);
 			StationID to = this->nodes[dest_id].base.station;
 			Station *st2 = Station::GetIfValid(to);
 			if (st2 == nullptr || st2->goods[this->Cargo()].link_graph != this->link_graph.index ||
@@ -137,7 +140,7 @@ LinkGraphJob::~LinkGraphJob()
 				/* Delete old flows for source stations which have been deleted
 				 * from the new flows. This avoids flow cycles between old and
 				 * new flows. */
-				while (!erased.IsEmpty()) ge.flows.erase(erased.Pop());
+				while (!erased.IsEmpty()) erased_sources.push_back(erased.Pop());
 			} else if ((*lg)[node_id][dest_id].last_restricted_update == INVALID_DATE) {
 				/* Edge is fully restricted. */
 				flows.RestrictFlows(to);
@@ -147,29 +150,29 @@ LinkGraphJob::~LinkGraphJob()
 		/* Swap shares and invalidate ones that are completely deleted. Don't
 		 * really delete them as we could then end up with unroutable cargo
 		 * somewhere. Do delete them and also reroute relevant cargo if
-		 * automatic distribution has been turned off for that cargo. */
-		for (FlowStatMap::iterator it(ge.flows.begin()); it != ge.flows.end();) {
-			FlowStatMap::iterator new_it = flows.find(it->first);
-			if (new_it == flows.end()) {
-				if (_settings_game.linkgraph.GetDistributionType(this->Cargo()) != DT_MANUAL) {
-					it->second.Invalidate();
-					++it;
-				} else {
-					FlowStat shares(INVALID_STATION, 1);
-					it->second.SwapShares(shares);
-					ge.flows.erase(it++);
-					for (FlowStat::SharesMap::const_iterator shares_it(shares.GetShares()->begin());
-							shares_it != shares.GetShares()->end(); ++shares_it) {
-						RerouteCargo(st, this->Cargo(), shares_it->second, st->index);
-					}
+		 * automatic distribution has been turned off for that cargo. Both
+		 * maps are sorted, so they are merged in a single pass; the cargo
+		 * is rerouted once the merged flows are in place. */
+		std::sort(erased_sources.begin(), erased_sources.end());
+		bool manual = _settings_game.linkgraph.GetDistributionType(this->Cargo()) == DT_MANUAL;
+		std::vector<StationID> reroute_via;
+		ge.flows.Merge(std::move(flows),
+			[](StationID, FlowStat &old_flow, FlowStat &new_flow) {
+				old_flow.SwapShares(new_flow);
+				return true;
+			},
+			[&](StationID source, FlowStat &old_flow) {
+				if (std::binary_search(erased_sources.begin(), erased_sources.end(), source)) return false;
+				if (!manual) {
+					old_flow.Invalidate();
+					return true;
 				}
-			} else {
-				it->second.SwapShares(new_it->second);
-				flows.erase(new_it);
-				++it;
-			}
-		}
-		ge.flows.insert(flows.begin(), flows.end());
+				FlowStat shares(INVALID_STATION, 1);
+				old_flow.SwapShares(shares);
+				for (const auto &share : *shares.GetShares()) reroute_via.push_back(share.second);
+				return false;
+			});
+		for (StationID via : reroute_via) RerouteCargo(st, this->Cargo(), via, st->index);
 		InvalidateWindowData(WC_STATION_VIEW, st->index, this->Cargo());
 	}
 }
@@ -182,10 +185,38 @@ LinkGraphJob::~LinkGraphJob()
 void LinkGraphJob::Init()
 {
 	uint size = this->Size();
+	uint num_edges = 0;
 	this->nodes.reserve(size);
 	for (uint i = 0; i < size; ++i) {
 		this->nodes.emplace_back(this->link_graph.nodes[i], this->link_graph.Size());
+		num_edges += (uint)this->link_graph.nodes[i].edges.size();
+	}
+
+	/* Prioritize the fastest route for passengers, mail and express cargo,
+	 * and the shortest route for other classes of cargo.
+	 * In-between stops are punished with a 1 tile or 1 day penalty. */
+	bool express = IsCargoInClass(this->Cargo(), CC_PASSENGERS) ||
+		IsCargoInClass(this->Cargo(), CC_MAIL) ||
+		IsCargoInClass(this->Cargo(), CC_EXPRESS);
+
+	this->edge_offsets.reserve(size + 1);
+	this->edge_dest.reserve(num_edges);
+	this->edge_capacity.reserve(num_edges);
+	this->edge_distance.reserve(num_edges);
+	this->edge_flow.assign(num_edges, 0);
+	for (uint i = 0; i < size; ++i) {
+		const LinkGraph::BaseNode &from = this->link_graph.nodes[i];
+		this->edge_offsets.push_back((EdgeID)this->edge_dest.size());
+		for (const LinkGraph::BaseEdge &edge : from.edges) {
+			uint distance = DistanceMaxPlusManhattan(from.xy, this->link_graph.nodes[edge.dest_node].xy) + 1;
+			/* Compute a default travel time from the distance and an average speed of 1 tile/day. */
+			uint time = (edge.TravelTime() != 0) ? edge.TravelTime() + DAY_TICKS : distance * DAY_TICKS;
+			this->edge_dest.push_back(edge.dest_node);
+			this->edge_capacity.push_back(edge.capacity);
+			this->edge_distance.push_back(express ? time : distance);
+		}
 	}
+	this->edge_offsets.push_back((EdgeID)this->edge_dest.size());
 }
 
 /**
@@ -221,11 +252,11 @@ void Path::Fork(Path *base, uint cap, int free_cap, uint dist)
 uint Path::AddFlow(uint new_flow, LinkGraphJob &job, uint max_saturation)
 {
 	if (this->parent != nullptr) {
-		LinkGraphJob::EdgeAnnotation edge = job[this->parent->node][this->node];
+		LinkGraphJob::EdgeID edge = job.FindEdge(this->parent->node, this->node);
 		if (max_saturation != UINT_MAX) {
-			uint usable_cap = edge.base.capacity * max_saturation / 100;
-			if (usable_cap > edge.Flow()) {
-				new_flow = std::min(new_flow, usable_cap - edge.Flow());
+			uint usable_cap = job.EdgeCapacity(edge) * max_saturation / 100;
+			if (usable_cap > job.EdgeFlow(edge)) {
+				new_flow = std::min(new_flow, usable_cap - job.EdgeFlow(edge));
 			} else {
 				return 0;
 			}
@@ -234,7 +265,6 @@ uint Path::AddFlow(uint new_flow, LinkGraphJob &job, uint max_saturation)
 		if (this->flow == 0 && new_flow > 0) {
 			job[this->parent->node].paths.push_front(this);
 		}
-		edge.AddFlow(new_flow);
 	}
 	this->flow += new_flow;
 	return new_flow;
@@ -10,7 +10,7 @@
 #ifndef LINKGRAPHJOB_H
 #define LINKGRAPHJOB_H
 
-#include "../thread.h"
+#include "../task_pool.h"
 #include "linkgraph.h"
 #include <list>
 #include <atomic>
@@ -37,43 +37,8 @@ public:
 		uint unsatisfied_demand; ///< Demand over this edge that hasn't been satisfied yet.
 	};
 
-	/**
-	 * Annotation for a link graph edge.
-	 */
-	struct EdgeAnnotation {
-		const LinkGraph::BaseEdge &base; ///< Reference to the edge that is annotated.
-
-		uint flow;               ///< Planned flow over this edge.
-
-		EdgeAnnotation(const LinkGraph::BaseEdge &base) : base(base), flow(0) {}
-
-		/**
-		 * Get the total flow on the edge.
-		 * @return Flow.
-		 */
-		uint Flow() const { return this->flow; }
-
-		/**
-		 * Add some flow.
-		 * @param flow Flow to be added.
-		 */
-		void AddFlow(uint flow) { this->flow += flow; }
-
-		/**
-		 * Remove some flow.
-		 * @param flow Flow to be removed.
-		 */
-		void RemoveFlow(uint flow)
-		{
-			assert(flow <= this->flow);
-			this->flow -= flow;
-		}
-
-		friend inline bool operator <(NodeID dest, const EdgeAnnotation &rhs)
-		{
-			return dest < rhs.base.dest_node;
-		}
-	};
+	/** Index of an edge in the edge arrays of the job. */
+	typedef uint EdgeID;
 
 	/**
 	 * Annotation for a link graph node.
@@ -85,40 +50,13 @@ public:
 		PathList paths;          ///< Paths through this node, sorted so that those with flow == 0 are in the back.
 		FlowStatMap flows;       ///< Planned flows to other nodes.
 
-		std::vector<EdgeAnnotation>   edges;   ///< Annotations for all edges originating at this node.
 		std::vector<DemandAnnotation> demands; ///< Annotations for the demand to all other nodes.
 
 		NodeAnnotation(const LinkGraph::BaseNode &node, size_t size) : base(node), undelivered_supply(node.supply), paths(), flows()
 		{
-			this->edges.reserve(node.edges.size());
-			for (auto &e : node.edges) this->edges.emplace_back(e);
 			this->demands.resize(size);
 		}
 
-		/**
-		 * Retrieve an edge starting at this node.
-		 * @param to Remote end of the edge.
-		 * @return Edge between this node and "to".
-		 */
-		EdgeAnnotation &operator[](NodeID to)
-		{
-			auto it = std::find_if(this->edges.begin(), this->edges.end(), [=] (const EdgeAnnotation &e) { return e.base.dest_node == to; });
-			assert(it != this->edges.end());
-			return *it;
-		}
-
-		/**
-		 * Retrieve an edge starting at this node.
-		 * @param to Remote end of the edge.
-		 * @return Edge between this node and "to".
-		 */
-		const EdgeAnnotation &operator[](NodeID to) const
-		{
-			auto it = std::find_if(this->edges.begin(), this->edges.end(), [=] (const EdgeAnnotation &e) { return e.base.dest_node == to; });
-			assert(it != this->edges.end());
-			return *it;
-		}
-
 		/**
 		 * Get the transport demand between end the points of the edge.
 		 * @return Demand.
@@ -163,9 +101,17 @@ private:
 protected:
 	const LinkGraph link_graph;        ///< Link graph to by analyzed. Is copied when job is started and mustn't be modified later.
 	const LinkGraphSettings settings;  ///< Copy of _settings_game.linkgraph at spawn time.
-	std::thread thread;                ///< Thread the job is running in or a default-constructed thread if it's running in the main thread.
+	TaskGroup task;                    ///< Task of the job on the task pool, if it isn't running in the main thread.
 	TimerGameCalendar::Date join_date; ///< Date when the job is to be joined.
 	NodeAnnotationVector nodes;        ///< Extra node data necessary for link graph calculation.
+
+	/* The edges in compressed sparse row layout: the edges starting at node n
+	 * are [edge_offsets[n], edge_offsets[n + 1]), sorted by destination. */
+	std::vector<EdgeID> edge_offsets;  ///< First edge of each node, followed by the number of edges.
+	std::vector<NodeID> edge_dest;     ///< Destination node of each edge.
+	std::vector<uint> edge_capacity;   ///< Capacity of each edge.
+	std::vector<uint> edge_distance;   ///< Distance of each edge as rated by the path search.
+	std::vector<uint> edge_flow;       ///< Planned flow over each edge.
 	std::atomic<bool> job_completed;   ///< Is the job still running. This is accessed by multiple threads and reads may be stale.
 	std::atomic<bool> job_aborted;     ///< Has the job been aborted. This is accessed by multiple threads and reads may be stale.
 
@@ -245,6 +191,71 @@ public:
 	 */
 	inline NodeID Size() const { return this->link_graph.Size(); }
 
+	/**
+	 * Get the first edge starting at a node.
+	 * @param node ID of the node.
+	 * @return First edge of the node.
+	 */
+	inline EdgeID FirstEdge(NodeID node) const { return this->edge_offsets[node]; }
+
+	/**
+	 * Get the end of the edges starting at a node.
+	 * @param node ID of the node.
+	 * @return One past the last edge of the node.
+	 */
+	inline EdgeID EndEdge(NodeID node) const { return this->edge_offsets[node + 1]; }
+
+	/**
+	 * Find the edge between two nodes. The edge has to exist.
+	 * @param from Node the edge starts at.
+	 * @param to Remote end of the edge.
+	 * @return Edge between "from" and "to".
+	 */
+	inline EdgeID FindEdge(NodeID from, NodeID to) const
+	{
+		auto first = this->edge_dest.begin() + this->FirstEdge(from);
+		auto last = this->edge_dest.begin() + this->EndEdge(from);
+		auto it = std::lower_bound(first, last, to);
+		assert(it != last && *it == to);
+		return (EdgeID)(it - this->edge_dest.begin());
+	}
+
+	/**
+	 * Get the destination of an edge.
+	 * @param edge The edge.
+	 * @return Remote end of the edge.
+	 */
+	inline NodeID EdgeDestination(EdgeID edge) const { return this->edge_dest[edge]; }
+
+	/**
+	 * Get the capacity of an edge.
+	 * @param edge The edge.
+	 * @return Capacity.
+	 */
+	inline uint EdgeCapacity(EdgeID edge) const { return this->edge_capacity[edge]; }
+
+	/**
+	 * Get the distance of an edge as rated by the path search: the travel
+	 * time for passengers, mail and express cargo, the length otherwise.
+	 * @param edge The edge.
+	 * @return Distance.
+	 */
+	inline uint EdgeDistance(EdgeID edge) const { return this->edge_distance[edge]; }
+
+	/**
+	 * Get the total flow on an edge.
+	 * @param edge The edge.
+	 * @return Flow.
+	 */
+	inline uint EdgeFlow(EdgeID edge) const { return this->edge_flow[edge]; }
+
+	/**
+	 * Remove some flow from an edge.
+	 * @param edge The edge.
+	 * @param flow Flow to be removed.
+	 */
+	inline void RemoveEdgeFlow(EdgeID edge, uint flow) { this->edge_flow[edge] -= flow; }
+
 	/**
 	 * Get the cargo of the underlying link graph.
 	 * @return Cargo.
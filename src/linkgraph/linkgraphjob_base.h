@@ -15,6 +15,6 @@
 #include "linkgraphschedule.h"
 
 typedef LinkGraphJob::NodeAnnotation Node;
-typedef LinkGraphJob::EdgeAnnotation Edge;
+typedef LinkGraphJob::EdgeID EdgeID;
 
 #endif /* LINKGRAPHJOB_BASE_H */
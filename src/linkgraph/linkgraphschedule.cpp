@@ -28,14 +28,15 @@
 /* static */ LinkGraphSchedule LinkGraphSchedule::instance;
 
 /**
- * Start the next job in the schedule.
+ * Start the next job in the schedule. Components that did not change
+ * since their last calculation are skipped and keep their current flows.
  */
 void LinkGraphSchedule::SpawnNext()
 {
 	if (this->schedule.empty()) return;
 	LinkGraph *next = this->schedule.front();
 	LinkGraph *first = next;
-	while (next->Size() < 2) {
+	while (next->Size() < 2 || !next->NeedsRecalculation(_settings_game.linkgraph.recalc_threshold)) {
 		this->schedule.splice(this->schedule.end(), this->schedule, this->schedule.begin());
 		next = this->schedule.front();
 		if (next == first) return;
@@ -44,6 +45,7 @@ void LinkGraphSchedule::SpawnNext()
 	this->schedule.pop_front();
 	if (LinkGraphJob::CanAllocateItem()) {
 		LinkGraphJob *job = new LinkGraphJob(*next);
+		next->MarkRecalculated();
 		job->SpawnThread();
 		this->running.push_back(job);
 	} else {
@@ -3,6 +3,7 @@
 #include "../stdafx.h"
 #include "../core/math_func.hpp"
 #include "mcf.h"
+#include "../task_pool.h"
 #include <set>
 
 #include "../safeguards.h"
@@ -95,8 +96,9 @@ class GraphEdgeIterator {
 private:
 	LinkGraphJob &job; ///< Job being executed
 
-	std::vector<LinkGraphJob::EdgeAnnotation>::const_iterator i;   ///< Iterator pointing to current edge.
-	std::vector<LinkGraphJob::EdgeAnnotation>::const_iterator end; ///< Iterator pointing beyond last edge.
+	EdgeID i;    ///< Current edge.
+	EdgeID end;  ///< Edge beyond the last edge.
+	EdgeID last; ///< Edge last returned by Next().
 
 public:
 
@@ -104,7 +106,7 @@ public:
 	 * Construct a GraphEdgeIterator.
 	 * @param job Job to iterate on.
 	 */
-	GraphEdgeIterator(LinkGraphJob &job) : job(job), i(), end() {}
+	GraphEdgeIterator(LinkGraphJob &job) : job(job), i(0), end(0), last(0) {}
 
 	/**
 	 * Setup the node to start iterating at.
@@ -113,8 +115,8 @@ public:
 	 */
 	void SetNode(NodeID source, NodeID node)
 	{
-		this->i = this->job[node].edges.cbegin();
-		this->end = this->job[node].edges.cend();
+		this->i = this->job.FirstEdge(node);
+		this->end = this->job.EndEdge(node);
 	}
 
 	/**
@@ -123,7 +125,20 @@ public:
 	 */
 	NodeID Next()
 	{
-		return this->i != this->end ? (this->i++)->base.dest_node : INVALID_NODE;
+		if (this->i == this->end) return INVALID_NODE;
+		this->last = this->i++;
+		return this->job.EdgeDestination(this->last);
+	}
+
+	/**
+	 * Get the edge leading to the node last returned by Next().
+	 * @param from Unused.
+	 * @param to Unused.
+	 * @return Index of the edge in the job's edge arrays.
+	 */
+	EdgeID Edge(NodeID from, NodeID to) const
+	{
+		return this->last;
 	}
 };
 
@@ -186,6 +201,18 @@ public:
 		if (this->it == this->end) return INVALID_NODE;
 		return this->station_to_node[(this->it++)->second];
 	}
+
+	/**
+	 * Get the edge leading to the node last returned by Next(). Flows are
+	 * keyed by station, so the edge has to be looked up.
+	 * @param from Node the flow starts at.
+	 * @param to Node the flow leads to.
+	 * @return Index of the edge in the job's edge arrays.
+	 */
+	EdgeID Edge(NodeID from, NodeID to) const
+	{
+		return this->job.FindEdge(from, to);
+	}
 };
 
 /**
@@ -276,28 +303,20 @@ void MultiCommodityFlow::Dijkstra(NodeID source_node, PathVector &paths)
 		iter.SetNode(source_node, from);
 		for (NodeID to = iter.Next(); to != INVALID_NODE; to = iter.Next()) {
 			if (to == from) continue; // Not a real edge but a consumption sign.
-			const Edge &edge = this->job[from][to];
-			uint capacity = edge.base.capacity;
+			EdgeID edge = iter.Edge(from, to);
+			uint capacity = this->job.EdgeCapacity(edge);
 			if (this->max_saturation != UINT_MAX) {
 				capacity *= this->max_saturation;
 				capacity /= 100;
 				if (capacity == 0) capacity = 1;
 			}
-			/* Prioritize the fastest route for passengers, mail and express cargo,
-			 * and the shortest route for other classes of cargo.
-			 * In-between stops are punished with a 1 tile or 1 day penalty. */
-			bool express = IsCargoInClass(this->job.Cargo(), CC_PASSENGERS) ||
-				IsCargoInClass(this->job.Cargo(), CC_MAIL) ||
-				IsCargoInClass(this->job.Cargo(), CC_EXPRESS);
-			uint distance = DistanceMaxPlusManhattan(this->job[from].base.xy, this->job[to].base.xy) + 1;
-			/* Compute a default travel time from the distance and an average speed of 1 tile/day. */
-			uint time = (edge.base.TravelTime() != 0) ? edge.base.TravelTime() + DAY_TICKS : distance * DAY_TICKS;
-			uint distance_anno = express ? time : distance;
+			uint distance_anno = this->job.EdgeDistance(edge);
+			int free_capacity = capacity - this->job.EdgeFlow(edge);
 
 			Tannotation *dest = static_cast<Tannotation *>(paths[to]);
-			if (dest->IsBetter(source, capacity, capacity - edge.Flow(), distance_anno)) {
+			if (dest->IsBetter(source, capacity, free_capacity, distance_anno)) {
 				annos.erase(dest);
-				dest->Fork(source, capacity, capacity - edge.Flow(), distance_anno);
+				dest->Fork(source, capacity, free_capacity, distance_anno);
 				dest->UpdateAnnotation();
 				annos.insert(dest);
 			}
@@ -305,6 +324,42 @@ void MultiCommodityFlow::Dijkstra(NodeID source_node, PathVector &paths)
 	}
 }
 
+/**
+ * Run the Dijkstra algorithm for several sources at once. All paths are
+ * searched with the same edge flows, as flow is only pushed along them
+ * afterwards, so the searches are split over the task pool. The results
+ * don't depend on the number of threads.
+ * @tparam Tannotation Annotation to be used.
+ * @tparam Tedge_iterator Iterator to be used for getting outgoing edges.
+ * @param sources Nodes where the algorithm starts.
+ * @param paths Container for the paths of each source.
+ */
+template<class Tannotation, class Tedge_iterator>
+void MultiCommodityFlow::Dijkstra(const std::vector<NodeID> &sources, std::vector<PathVector> &paths)
+{
+	paths.resize(sources.size());
+	RunTasks(sources.size(), 1, [&](size_t first, size_t last) {
+		for (size_t i = first; i < last; ++i) {
+			this->Dijkstra<Tannotation, Tedge_iterator>(sources[i], paths[i]);
+		}
+	});
+}
+
+/**
+ * Get the sources whose paths are searched in the same round.
+ * @param first First node of the round.
+ * @param finished_sources Nodes whose demand is completely satisfied.
+ * @param[out] sources The unfinished nodes of the round.
+ */
+void MultiCommodityFlow::GetSources(uint first, const std::vector<bool> &finished_sources, std::vector<NodeID> &sources) const
+{
+	sources.clear();
+	uint last = std::min<uint>(first + this->sources_per_round, this->job.Size());
+	for (uint source = first; source < last; ++source) {
+		if (!finished_sources[source]) sources.push_back(source);
+	}
+}
+
 /**
  * Clean up paths that lead nowhere and the root path.
  * @param source_id ID of the root node.
@@ -392,8 +447,7 @@ void MCF1stPass::EliminateCycle(PathVector &path, Path *cycle_begin, uint flow)
 			}
 		}
 		cycle_begin = path[prev];
-		Edge &edge = this->job[prev][cycle_begin->GetNode()];
-		edge.RemoveFlow(flow);
+		this->job.RemoveEdgeFlow(this->job.FindEdge(prev, cycle_begin->GetNode()), flow);
 	} while (cycle_begin != cycle_end);
 }
 
@@ -499,7 +553,8 @@ bool MCF1stPass::EliminateCycles()
  */
 MCF1stPass::MCF1stPass(LinkGraphJob &job) : MultiCommodityFlow(job)
 {
-	PathVector paths;
+	std::vector<NodeID> sources;
+	std::vector<PathVector> source_paths;
 	uint16 size = job.Size();
 	uint accuracy = job.Settings().accuracy;
 	bool more_loops;
@@ -507,35 +562,39 @@ MCF1stPass::MCF1stPass(LinkGraphJob &job) : MultiCommodityFlow(job)
 
 	do {
 		more_loops = false;
-		for (NodeID source = 0; source < size; ++source) {
-			if (finished_sources[source]) continue;
+		for (uint first = 0; first < size; first += this->sources_per_round) {
+			this->GetSources(first, finished_sources, sources);
 
 			/* First saturate the shortest paths. */
-			this->Dijkstra<DistanceAnnotation, GraphEdgeIterator>(source, paths);
-
-			Node &src_node = job[source];
-			bool source_demand_left = false;
-			for (NodeID dest = 0; dest < size; ++dest) {
-				if (src_node.UnsatisfiedDemandTo(dest) > 0) {
-					Path *path = paths[dest];
-					assert(path != nullptr);
-					/* Generally only allow paths that don't exceed the
-					 * available capacity. But if no demand has been assigned
-					 * yet, make an exception and allow any valid path *once*. */
-					if (path->GetFreeCapacity() > 0 && this->PushFlow(src_node, dest, path,
-							accuracy, this->max_saturation) > 0) {
-						/* If a path has been found there is a chance we can
-						 * find more. */
-						more_loops = more_loops || (src_node.UnsatisfiedDemandTo(dest) > 0);
-					} else if (src_node.UnsatisfiedDemandTo(dest) == src_node.DemandTo(dest) &&
-							path->GetFreeCapacity() > INT_MIN) {
-						this->PushFlow(src_node, dest, path, accuracy, UINT_MAX);
+			this->Dijkstra<DistanceAnnotation, GraphEdgeIterator>(sources, source_paths);
+
+			for (uint i = 0; i < sources.size(); ++i) {
+				NodeID source = sources[i];
+				PathVector &paths = source_paths[i];
+				Node &src_node = job[source];
+				bool source_demand_left = false;
+				for (NodeID dest = 0; dest < size; ++dest) {
+					if (src_node.UnsatisfiedDemandTo(dest) > 0) {
+						Path *path = paths[dest];
+						assert(path != nullptr);
+						/* Generally only allow paths that don't exceed the
+						 * available capacity. But if no demand has been assigned
+						 * yet, make an exception and allow any valid path *once*. */
+						if (path->GetFreeCapacity() > 0 && this->PushFlow(src_node, dest, path,
+								accuracy, this->max_saturation) > 0) {
+							/* If a path has been found there is a chance we can
+							 * find more. */
+							more_loops = more_loops || (src_node.UnsatisfiedDemandTo(dest) > 0);
+						} else if (src_node.UnsatisfiedDemandTo(dest) == src_node.DemandTo(dest) &&
+								path->GetFreeCapacity() > INT_MIN) {
+							this->PushFlow(src_node, dest, path, accuracy, UINT_MAX);
+						}
+						if (src_node.UnsatisfiedDemandTo(dest) > 0) source_demand_left = true;
 					}
-					if (src_node.UnsatisfiedDemandTo(dest) > 0) source_demand_left = true;
 				}
+				finished_sources[source] = !source_demand_left;
+				this->CleanupPaths(source, paths);
 			}
-			finished_sources[source] = !source_demand_left;
-			this->CleanupPaths(source, paths);
 		}
 	} while ((more_loops || this->EliminateCycles()) && !job.IsJobAborted());
 }
@@ -548,32 +607,37 @@ MCF1stPass::MCF1stPass(LinkGraphJob &job) : MultiCommodityFlow(job)
 MCF2ndPass::MCF2ndPass(LinkGraphJob &job) : MultiCommodityFlow(job)
 {
 	this->max_saturation = UINT_MAX; // disable artificial cap on saturation
-	PathVector paths;
+	std::vector<NodeID> sources;
+	std::vector<PathVector> source_paths;
 	uint16 size = job.Size();
 	uint accuracy = job.Settings().accuracy;
 	bool demand_left = true;
 	std::vector<bool> finished_sources(size);
 	while (demand_left && !job.IsJobAborted()) {
 		demand_left = false;
-		for (NodeID source = 0; source < size; ++source) {
-			if (finished_sources[source]) continue;
+		for (uint first = 0; first < size; first += this->sources_per_round) {
+			this->GetSources(first, finished_sources, sources);
 
-			this->Dijkstra<CapacityAnnotation, FlowEdgeIterator>(source, paths);
+			this->Dijkstra<CapacityAnnotation, FlowEdgeIterator>(sources, source_paths);
 
-			Node &src_node = job[source];
-			bool source_demand_left = false;
-			for (NodeID dest = 0; dest < size; ++dest) {
-				Path *path = paths[dest];
-				if (src_node.UnsatisfiedDemandTo(dest) > 0 && path->GetFreeCapacity() > INT_MIN) {
-					this->PushFlow(src_node, dest, path, accuracy, UINT_MAX);
-					if (src_node.UnsatisfiedDemandTo(dest) > 0) {
-						demand_left = true;
-						source_demand_left = true;
+			for (uint i = 0; i < sources.size(); ++i) {
+				NodeID source = sources[i];
+				PathVector &paths = source_paths[i];
+				Node &src_node = job[source];
+				bool source_demand_left = false;
+				for (NodeID dest = 0; dest < size; ++dest) {
+					Path *path = paths[dest];
+					if (src_node.UnsatisfiedDemandTo(dest) > 0 && path->GetFreeCapacity() > INT_MIN) {
+						this->PushFlow(src_node, dest, path, accuracy, UINT_MAX);
+						if (src_node.UnsatisfiedDemandTo(dest) > 0) {
+							demand_left = true;
+							source_demand_left = true;
+						}
 					}
 				}
+				finished_sources[source] = !source_demand_left;
+				this->CleanupPaths(source, paths);
 			}
-			finished_sources[source] = !source_demand_left;
-			this->CleanupPaths(source, paths);
 		}
 	}
 }
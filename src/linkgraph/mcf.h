@@ -18,18 +18,28 @@ protected:
 	 * @param job Link graph job being executed.
 	 */
 	MultiCommodityFlow(LinkGraphJob &job) : job(job),
-			max_saturation(job.Settings().short_path_saturation)
+			max_saturation(job.Settings().short_path_saturation),
+			sources_per_round(job.Settings().parallel_mcf ? PARALLEL_SOURCES : 1)
 	{}
 
 	template<class Tannotation, class Tedge_iterator>
 	void Dijkstra(NodeID from, PathVector &paths);
 
+	template<class Tannotation, class Tedge_iterator>
+	void Dijkstra(const std::vector<NodeID> &sources, std::vector<PathVector> &paths);
+
+	void GetSources(uint first, const std::vector<bool> &finished_sources, std::vector<NodeID> &sources) const;
+
 	uint PushFlow(Node &node, NodeID to, Path *path, uint accuracy, uint max_saturation);
 
 	void CleanupPaths(NodeID source, PathVector &paths);
 
-	LinkGraphJob &job;   ///< Job we're working with.
-	uint max_saturation; ///< Maximum saturation for edges.
+	/** Number of sources whose paths are searched at once if parallel_mcf is enabled. */
+	static const uint PARALLEL_SOURCES = 64;
+
+	LinkGraphJob &job;      ///< Job we're working with.
+	uint max_saturation;    ///< Maximum saturation for edges.
+	uint sources_per_round; ///< Number of sources whose paths are searched before flow is pushed along them.
 };
 
 /**
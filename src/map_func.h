@@ -25,6 +25,7 @@
 class Tile {
 private:
 	friend struct Map;
+	friend struct MapSnapshot;
 	/**
 	 * Data that is stored per tile. Also used TileExtended for this.
 	 * Look at docs/landscape.html for the exact meaning of the members.
@@ -31,6 +31,8 @@
 #include "town_kdtree.h"
 #include "viewport_kdtree.h"
 #include "newgrf_profiling.h"
+#include "pathfinder/yapf/yapf_cache.h"
+#include "pathfinder/water_regions.h"
 
 #include "safeguards.h"
 
@@ -108,6 +110,10 @@ void InitializeGame(uint size_x, uint size_y, bool reset_date, bool reset_settin
 	InitializeBuildingCounts();
 
 	InitializeNPF();
+	/* Segments are only invalidated per tile, so forget those of the previous map. */
+	YapfNotifyTrackLayoutChange(INVALID_TILE, INVALID_TRACK);
+	InvalidateSignalBlocks();
+	InitializeWaterRegions();
 
 	InitializeCompanies();
 	AI::Initialize();
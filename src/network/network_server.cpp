@@ -32,8 +32,8 @@
 #include "../rev.h"
 #include "../timer/timer.h"
 #include "../timer/timer_game_calendar.h"
+#include <memory>
 #include <mutex>
-#include <condition_variable>
 
 #include "../safeguards.h"
 
@@ -56,152 +56,89 @@ INSTANTIATE_POOL_METHODS(NetworkClientSocket)
 /** Instantiate the listen sockets. */
 template SocketList TCPListenHandler<ServerNetworkGameSocketHandler, PACKET_SERVER_FULL, PACKET_SERVER_BANNED>::sockets;
 
-/** Writing a savegame directly to a number of packets. */
-struct PacketWriter : SaveFilter {
-	ServerNetworkGameSocketHandler *cs; ///< Socket we are associated with.
-	Packet *current;                    ///< The packet we're currently writing to.
-	size_t total_size;                  ///< Total size of the compressed savegame.
-	Packet *packets;                    ///< Packet queue of the savegame; send these "slowly" to the client.
-	std::mutex mutex;                   ///< Mutex for making threaded saving safe.
-	std::condition_variable exit_sig;   ///< Signal for threaded destruction of this packet writer.
+/** Savegame of a single frame, shared by all clients that start downloading the map in that frame. */
+struct NetworkMapSnapshot {
+	uint32 frame;           ///< Frame the savegame was made in.
+	std::mutex mutex;       ///< Mutex protecting #data and #finished, as the savegame is written by the saving thread.
+	std::vector<byte> data; ///< The compressed savegame, as far as it has been written.
+	bool finished = false;  ///< Whether the whole savegame has been written.
 
 	/**
-	 * Create the packet writer.
-	 * @param cs The socket handler we're making the packets for.
+	 * Create an empty snapshot.
+	 * @param frame The frame the savegame is made in.
 	 */
-	PacketWriter(ServerNetworkGameSocketHandler *cs) : SaveFilter(nullptr), cs(cs), current(nullptr), total_size(0), packets(nullptr)
-	{
-	}
-
-	/** Make sure everything is cleaned up. */
-	~PacketWriter()
-	{
-		std::unique_lock<std::mutex> lock(this->mutex);
-
-		if (this->cs != nullptr) this->exit_sig.wait(lock);
-
-		/* This must all wait until the Destroy function is called. */
-
-		while (this->packets != nullptr) {
-			delete Packet::PopFromQueue(&this->packets);
-		}
-
-		delete this->current;
-	}
-
-	/**
-	 * Begin the destruction of this packet writer. It can happen in two ways:
-	 * in the first case the client disconnected while saving the map. In this
-	 * case the saving has not finished and killed this PacketWriter. In that
-	 * case we simply set cs to nullptr, triggering the appending to fail due to
-	 * the connection problem and eventually triggering the destructor. In the
-	 * second case the destructor is already called, and it is waiting for our
-	 * signal which we will send. Only then the packets will be removed by the
-	 * destructor.
-	 */
-	void Destroy()
-	{
-		std::unique_lock<std::mutex> lock(this->mutex);
-
-		this->cs = nullptr;
+	NetworkMapSnapshot(uint32 frame) : frame(frame) {}
+};
 
-		this->exit_sig.notify_all();
-		lock.unlock();
+/** The snapshot of the frame the last download started in; expires when no client downloads it anymore. */
+static std::weak_ptr<NetworkMapSnapshot> _network_map_snapshot;
 
-		/* Make sure the saving is completely cancelled. Yes,
-		 * we need to handle the save finish as well as the
-		 * next connection might just be requesting a map. */
-		WaitTillSaved();
-		ProcessAsyncSaveFinish();
-	}
+/** Writing a savegame into a snapshot, from which it is sent to the clients. */
+struct SnapshotWriter : SaveFilter {
+	std::shared_ptr<NetworkMapSnapshot> snapshot; ///< The snapshot we are writing.
 
 	/**
-	 * Transfer all packets from here to the network's queue while holding
-	 * the lock on our mutex.
-	 * @param socket The network socket to write to.
-	 * @return True iff the last packet of the map has been sent.
+	 * Create the snapshot writer.
+	 * @param snapshot The snapshot to write the savegame to.
 	 */
-	bool TransferToNetworkQueue(ServerNetworkGameSocketHandler *socket)
+	SnapshotWriter(std::shared_ptr<NetworkMapSnapshot> snapshot) : SaveFilter(nullptr), snapshot(std::move(snapshot))
 	{
-		/* Unsafe check for the queue being empty or not. */
-		if (this->packets == nullptr) return false;
-
-		std::lock_guard<std::mutex> lock(this->mutex);
-
-		while (this->packets != nullptr) {
-			Packet *p = Packet::PopFromQueue(&this->packets);
-			bool last_packet = p->GetPacketType() == PACKET_SERVER_MAP_DONE;
-			socket->SendPacket(p);
-
-			if (last_packet) return true;
-		}
-
-		return false;
 	}
 
-	/** Append the current packet to the queue. */
-	void AppendQueue()
+	void Write(byte *buf, size_t size) override
 	{
-		if (this->current == nullptr) return;
+		/* We want to abort the saving when all clients downloading the map are gone. */
+		if (this->snapshot.use_count() == 1) SlError(STR_NETWORK_ERROR_LOSTCONNECTION);
 
-		Packet::AddToQueue(&this->packets, this->current);
-		this->current = nullptr;
+		std::lock_guard<std::mutex> lock(this->snapshot->mutex);
+		this->snapshot->data.insert(this->snapshot->data.end(), buf, buf + size);
 	}
 
-	/** Prepend the current packet to the queue. */
-	void PrependQueue()
+	void Finish() override
 	{
-		if (this->current == nullptr) return;
+		if (this->snapshot.use_count() == 1) SlError(STR_NETWORK_ERROR_LOSTCONNECTION);
 
-		/* Reversed from AppendQueue so the queue gets added to the current one. */
-		Packet::AddToQueue(&this->current, this->packets);
-		this->packets = this->current;
-		this->current = nullptr;
+		std::lock_guard<std::mutex> lock(this->snapshot->mutex);
+		this->snapshot->finished = true;
 	}
+};
 
-	void Write(byte *buf, size_t size) override
-	{
-		/* We want to abort the saving when the socket is closed. */
-		if (this->cs == nullptr) SlError(STR_NETWORK_ERROR_LOSTCONNECTION);
-
-		if (this->current == nullptr) this->current = new Packet(PACKET_SERVER_MAP_DATA, TCP_MTU);
-
-		std::lock_guard<std::mutex> lock(this->mutex);
+/**
+ * Send the part of the map snapshot the client did not get yet.
+ * @param cs The client downloading the map.
+ * @return True iff the last packet of the map has been sent.
+ */
+static bool TransferMapSnapshot(ServerNetworkGameSocketHandler *cs)
+{
+	/* Payload of a full packet of map data. */
+	static const size_t MAP_DATA_SIZE = TCP_MTU - sizeof(PacketSize) - sizeof(PacketType);
 
-		byte *bufe = buf + size;
-		while (buf != bufe) {
-			size_t written = this->current->Send_bytes(buf, bufe);
-			buf += written;
+	NetworkMapSnapshot &snapshot = *cs->map_snapshot;
+	std::lock_guard<std::mutex> lock(snapshot.mutex);
 
-			if (!this->current->CanWriteToPacket(1)) {
-				this->AppendQueue();
-				if (buf != bufe) this->current = new Packet(PACKET_SERVER_MAP_DATA, TCP_MTU);
-			}
-		}
-
-		this->total_size += size;
+	/* Fast-track the size to the client, as soon as it is known. */
+	if (snapshot.finished && !cs->map_size_sent) {
+		Packet *p = new Packet(PACKET_SERVER_MAP_SIZE);
+		p->Send_uint32((uint32)snapshot.data.size());
+		cs->SendPacket(p);
+		cs->map_size_sent = true;
 	}
 
-	void Finish() override
-	{
-		/* We want to abort the saving when the socket is closed. */
-		if (this->cs == nullptr) SlError(STR_NETWORK_ERROR_LOSTCONNECTION);
-
-		std::lock_guard<std::mutex> lock(this->mutex);
-
-		/* Make sure the last packet is flushed. */
-		this->AppendQueue();
+	const byte *data = snapshot.data.data();
+	size_t available = snapshot.data.size();
+	while (cs->map_sent < available) {
+		/* Only send full packets while the savegame is being written. */
+		if (!snapshot.finished && available - cs->map_sent < MAP_DATA_SIZE) return false;
 
-		/* Add a packet stating that this is the end to the queue. */
-		this->current = new Packet(PACKET_SERVER_MAP_DONE);
-		this->AppendQueue();
-
-		/* Fast-track the size to the client. */
-		this->current = new Packet(PACKET_SERVER_MAP_SIZE);
-		this->current->Send_uint32((uint32)this->total_size);
-		this->PrependQueue();
+		Packet *p = new Packet(PACKET_SERVER_MAP_DATA, TCP_MTU);
+		cs->map_sent += p->Send_bytes(data + cs->map_sent, data + available);
+		cs->SendPacket(p);
 	}
-};
+	if (!snapshot.finished) return false;
+
+	cs->SendPacket(new Packet(PACKET_SERVER_MAP_DONE));
+	return true;
+}
 
 
 /**
@@ -227,11 +164,6 @@ ServerNetworkGameSocketHandler::~ServerNetworkGameSocketHandler()
 {
 	if (_redirect_console_to_client == this->client_id) _redirect_console_to_client = INVALID_CLIENT_ID;
 	OrderBackup::ResetUser(this->client_id);
-
-	if (this->savegame != nullptr) {
-		this->savegame->Destroy();
-		this->savegame = nullptr;
-	}
 }
 
 Packet *ServerNetworkGameSocketHandler::ReceivePacket()
@@ -273,12 +205,11 @@ NetworkRecvStatus ServerNetworkGameSocketHandler::CloseConnection(NetworkRecvSta
 		}
 	}
 
-	/* If we were transfering a map to this client, stop the savegame creation
-	 * process and queue the next client to receive the map. */
+	/* If we were transfering a map to this client, let go of the savegame, so
+	 * its creation stops when no one else downloads it, and queue the next
+	 * clients to receive the map. */
 	if (this->status == STATUS_MAP) {
-		/* Ensure the saving of the game is stopped too. */
-		this->savegame->Destroy();
-		this->savegame = nullptr;
+		this->map_snapshot.reset();
 
 		this->CheckNextClientToSendMap(this);
 	}
@@ -514,28 +445,22 @@ NetworkRecvStatus ServerNetworkGameSocketHandler::SendWait()
 
 void ServerNetworkGameSocketHandler::CheckNextClientToSendMap(NetworkClientSocket *ignore_cs)
 {
-	/* Find the best candidate for joining, i.e. the first joiner. */
-	NetworkClientSocket *best = nullptr;
+	/* Wait till everyone downloading the current savegame is done, but keep the waiting clients informed. */
 	for (NetworkClientSocket *new_cs : NetworkClientSocket::Iterate()) {
-		if (ignore_cs == new_cs) continue;
-
-		if (new_cs->status == STATUS_MAP_WAIT) {
-			if (best == nullptr || best->GetInfo()->join_date > new_cs->GetInfo()->join_date || (best->GetInfo()->join_date == new_cs->GetInfo()->join_date && best->client_id > new_cs->client_id)) {
-				best = new_cs;
+		if (ignore_cs != new_cs && new_cs->status == STATUS_MAP) {
+			for (NetworkClientSocket *wait_cs : NetworkClientSocket::Iterate()) {
+				if (ignore_cs != wait_cs && wait_cs->status == STATUS_MAP_WAIT) wait_cs->SendWait();
 			}
+			return;
 		}
 	}
 
-	/* Is there someone else to join? */
-	if (best != nullptr) {
-		/* Let the first start joining. */
-		best->status = STATUS_AUTHORIZED;
-		best->SendMap();
+	/* Let all waiting clients start joining in this frame, so they share a single savegame. */
+	for (NetworkClientSocket *new_cs : NetworkClientSocket::Iterate()) {
+		if (ignore_cs == new_cs || new_cs->status != STATUS_MAP_WAIT) continue;
 
-		/* And update the rest. */
-		for (NetworkClientSocket *new_cs : NetworkClientSocket::Iterate()) {
-			if (new_cs->status == STATUS_MAP_WAIT) new_cs->SendWait();
-		}
+		new_cs->status = STATUS_AUTHORIZED;
+		new_cs->SendMap();
 	}
 }
 
@@ -548,7 +473,15 @@ NetworkRecvStatus ServerNetworkGameSocketHandler::SendMap()
 	}
 
 	if (this->status == STATUS_AUTHORIZED) {
-		this->savegame = new PacketWriter(this);
+		/* Share the savegame with the clients that started downloading in this frame. */
+		this->map_snapshot = _network_map_snapshot.lock();
+		bool new_snapshot = this->map_snapshot == nullptr || this->map_snapshot->frame != _frame_counter;
+		if (new_snapshot) {
+			this->map_snapshot = std::make_shared<NetworkMapSnapshot>(_frame_counter);
+			_network_map_snapshot = this->map_snapshot;
+		}
+		this->map_sent = 0;
+		this->map_size_sent = false;
 
 		/* Now send the _frame_counter and how many packets are coming */
 		Packet *p = new Packet(PACKET_SERVER_MAP_BEGIN);
@@ -561,16 +494,18 @@ NetworkRecvStatus ServerNetworkGameSocketHandler::SendMap()
 		this->last_frame = _frame_counter;
 		this->last_frame_server = _frame_counter;
 
-		/* Make a dump of the current game */
-		if (SaveWithFilter(this->savegame, true) != SL_OK) UserError("network savedump failed");
+		/* Make a dump of the current game, after the previous one is completely done. */
+		if (new_snapshot) {
+			WaitTillSaved();
+			if (SaveWithFilter(new SnapshotWriter(this->map_snapshot), true) != SL_OK) UserError("network savedump failed");
+		}
 	}
 
 	if (this->status == STATUS_MAP) {
-		bool last_packet = this->savegame->TransferToNetworkQueue(this);
+		bool last_packet = TransferMapSnapshot(this);
 		if (last_packet) {
-			/* Done reading, make sure saving is done as well */
-			this->savegame->Destroy();
-			this->savegame = nullptr;
+			/* Done reading; the others downloading the same savegame keep it alive. */
+			this->map_snapshot.reset();
 
 			/* Set the status to DONE_MAP, no we will wait for the client
 			 *  to send it is ready (maybe that happens like never ;)) */
@@ -952,9 +887,11 @@ NetworkRecvStatus ServerNetworkGameSocketHandler::Receive_CLIENT_GETMAP(Packet *
 		return this->SendError(NETWORK_ERROR_NOT_AUTHORIZED);
 	}
 
-	/* Check if someone else is receiving the map */
+	/* Check if someone else is receiving the map, of another frame than this one */
+	std::shared_ptr<NetworkMapSnapshot> snapshot = _network_map_snapshot.lock();
+	bool same_frame = snapshot != nullptr && snapshot->frame == _frame_counter;
 	for (NetworkClientSocket *new_cs : NetworkClientSocket::Iterate()) {
-		if (new_cs->status == STATUS_MAP) {
+		if (new_cs->status == STATUS_MAP && !same_frame) {
 			/* Tell the new client to wait */
 			this->status = STATUS_MAP_WAIT;
 			return this->SendWait();
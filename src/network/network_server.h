@@ -69,7 +69,9 @@ public:
 	CommandQueue outgoing_queue; ///< The command-queue awaiting delivery
 	size_t receive_limit;        ///< Amount of bytes that we can receive at this moment
 
-	struct PacketWriter *savegame; ///< Writer used to write the savegame.
+	std::shared_ptr<struct NetworkMapSnapshot> map_snapshot; ///< Savegame the client downloads, shared with the clients that started downloading in the same frame.
+	size_t map_sent;               ///< Number of bytes of #map_snapshot sent to the client.
+	bool map_size_sent;            ///< Whether the size of #map_snapshot has been sent to the client.
 	NetworkAddress client_address; ///< IP-address of the client (so they can be banned)
 
 	ServerNetworkGameSocketHandler(SOCKET s);
@@ -930,4 +930,6 @@ extern const TileTypeProcs _tile_type_object_procs = {
 	nullptr,                        // vehicle_enter_tile_proc
 	GetFoundation_Object,        // get_foundation_proc
 	TerraformTile_Object,        // terraform_tile_proc
+	nullptr,                     // plan_tile_loop_proc
+	nullptr,                     // commit_tile_loop_proc
 };
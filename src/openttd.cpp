@@ -72,6 +72,9 @@
 #include "timer/timer_game_calendar.h"
 #include "timer/timer_game_realtime.h"
 #include "timer/timer_game_tick.h"
+#include "task_pool.h"
+#include "pathfinder/water_regions.h"
+#include "pathfinder/yapf/yapf_cache.h"
 
 #include "linkgraph/linkgraphschedule.h"
 
@@ -315,6 +318,7 @@ static void ShutdownGame()
 
 	LinkGraphSchedule::Clear();
 	PoolBase::Clean(PT_ALL);
+	StopTaskThreads();
 
 	/* No NewGRFs were loaded when it was still bootstrapping. */
 	if (_game_mode != GM_BOOTSTRAP) ResetNewGRFData();
@@ -1286,6 +1290,15 @@ static void CheckCaches()
 	std::vector<StationList> old_industry_stations_near;
 	for (Industry *ind : Industry::Iterate())  old_industry_stations_near.push_back(ind->stations_near);
 
+	std::unordered_map<uint32, std::vector<StationID>> old_catchment_index = Station::catchment_index;
+
+	/* Check the set of stations with loading vehicles */
+	std::set<StationID> old_loading_stations = Station::loading_stations;
+	Station::RebuildLoadingStations();
+	if (old_loading_stations != Station::loading_stations) {
+		Debug(desync, 2, "loading stations mismatch: {} stations cached, {} stations with loading vehicles", old_loading_stations.size(), Station::loading_stations.size());
+	}
+
 	for (Station *st : Station::Iterate()) {
 		for (CargoID c = 0; c < NUM_CARGO; c++) {
 			byte buff[sizeof(StationCargoList)];
@@ -1319,6 +1332,11 @@ static void CheckCaches()
 		}
 	}
 
+	/* Check the catchment index, which was rebuilt while checking industries_near. */
+	if (Station::catchment_index != old_catchment_index) {
+		Debug(desync, 2, "catchment index mismatch: {} tiles cached, {} tiles covered", old_catchment_index.size(), Station::catchment_index.size());
+	}
+
 	/* Check stations_near */
 	i = 0;
 	for (Town *t : Town::Iterate()) {
@@ -1334,6 +1352,15 @@ static void CheckCaches()
 		}
 		i++;
 	}
+
+	/* Check the water regions of the ship pathfinder. */
+	CheckWaterRegions();
+
+	/* Check the cached road segments of the road vehicle pathfinder. */
+	YapfCheckRoadSegmentCache();
+
+	/* Check the known signal blocks. */
+	CheckSignalBlocks();
 }
 
 /**
@@ -0,0 +1,332 @@
+/*
+ * This file is part of OpenTTD.
+ * OpenTTD is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, version 2.
+ * OpenTTD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file water_regions.cpp Coarse graph of water regions to speed up ship pathfinding. */
+
+#include "../stdafx.h"
+#include "../map_func.h"
+#include "../tile_cmd.h"
+#include "../debug.h"
+#include "../ship.h"
+#include "follow_track.hpp"
+#include "water_regions.h"
+
+#include <queue>
+#include <unordered_map>
+
+#include "../safeguards.h"
+
+/**
+ * The tiles of a square part of the map, split into patches of connected water.
+ * Regions are calculated when they are first needed and thrown away when one of
+ * their tiles changes.
+ */
+struct WaterRegion {
+	/** A tile outside of the region that can be reached from a patch of the region. */
+	struct Exit {
+		uint8 label;     ///< Patch the exit starts from.
+		TileIndex tile;  ///< Tile that can be reached.
+
+		bool operator ==(const Exit &other) const { return this->label == other.label && this->tile == other.tile; }
+	};
+
+	bool initialized = false;        ///< Whether the patches and exits are up to date.
+	uint8 number_of_patches = 0;     ///< Number of patches of water in the region.
+	std::vector<uint8> tile_patch;   ///< Patch label of each tile, empty if the region has no water.
+	std::vector<Exit> exits;         ///< Tiles in other regions that can be reached directly.
+};
+
+static std::vector<WaterRegion> _water_regions; ///< All water regions of the map.
+
+/**
+ * Get the number of water regions along the X axis of the map.
+ * @return The number of regions.
+ */
+static inline uint GetWaterRegionMapSizeX()
+{
+	return Map::SizeX() / WATER_REGION_EDGE_LENGTH;
+}
+
+/**
+ * Get the index of the water region a tile belongs to.
+ * @param tile The tile.
+ * @return The index of the region.
+ */
+uint GetWaterRegionIndex(TileIndex tile)
+{
+	return (TileY(tile) / WATER_REGION_EDGE_LENGTH) * GetWaterRegionMapSizeX() + TileX(tile) / WATER_REGION_EDGE_LENGTH;
+}
+
+/**
+ * Get the north corner of a water region.
+ * @param region Index of the region.
+ * @param[out] x X coordinate of the northern tile.
+ * @param[out] y Y coordinate of the northern tile.
+ */
+void GetWaterRegionBounds(uint region, uint *x, uint *y)
+{
+	*x = (region % GetWaterRegionMapSizeX()) * WATER_REGION_EDGE_LENGTH;
+	*y = (region / GetWaterRegionMapSizeX()) * WATER_REGION_EDGE_LENGTH;
+}
+
+/**
+ * Get the position of a tile within its water region.
+ * @param tile The tile.
+ * @return Index into WaterRegion::tile_patch.
+ */
+static inline uint GetLocalTileIndex(TileIndex tile)
+{
+	return (TileY(tile) % WATER_REGION_EDGE_LENGTH) * WATER_REGION_EDGE_LENGTH + TileX(tile) % WATER_REGION_EDGE_LENGTH;
+}
+
+/**
+ * Get the tracks a ship can use on a tile.
+ * @param tile The tile.
+ * @return The water tracks.
+ */
+static inline TrackBits GetWaterTracks(TileIndex tile)
+{
+	return TrackStatusToTrackBits(GetTileTrackStatus(tile, TRANSPORT_WATER, 0));
+}
+
+/**
+ * Split a region into patches of connected water and collect the tiles of other regions it leads to.
+ * @param region The region to fill.
+ * @param index  The index of the region.
+ */
+static void CalculateWaterRegion(WaterRegion &region, uint index)
+{
+	region.number_of_patches = 0;
+	region.tile_patch.assign(WATER_REGION_NUMBER_OF_TILES, INVALID_WATER_REGION_PATCH);
+	region.exits.clear();
+
+	uint x, y;
+	GetWaterRegionBounds(index, &x, &y);
+
+	std::vector<TileIndex> stack;
+	for (TileIndex start : TileArea(TileXY(x, y), WATER_REGION_EDGE_LENGTH, WATER_REGION_EDGE_LENGTH)) {
+		if (region.tile_patch[GetLocalTileIndex(start)] != INVALID_WATER_REGION_PATCH || GetWaterTracks(start) == TRACK_BIT_NONE) continue;
+
+		/* A new patch; flood it along everything a ship could follow. */
+		assert(region.number_of_patches < UINT8_MAX);
+		uint8 label = ++region.number_of_patches;
+		region.tile_patch[GetLocalTileIndex(start)] = label;
+		stack.push_back(start);
+
+		while (!stack.empty()) {
+			TileIndex tile = stack.back();
+			stack.pop_back();
+
+			TrackdirBits trackdirs = TrackBitsToTrackdirBits(GetWaterTracks(tile));
+			while (trackdirs != TRACKDIR_BIT_NONE) {
+				Trackdir td = (Trackdir)FindFirstBit2x64(trackdirs);
+				trackdirs = KillFirstBit(trackdirs);
+
+				CFollowTrackWater follower;
+				if (!follower.Follow(tile, td)) continue;
+
+				TileIndex next = follower.m_new_tile;
+				if (GetWaterRegionIndex(next) != index) {
+					WaterRegion::Exit exit{ label, next };
+					if (std::find(region.exits.begin(), region.exits.end(), exit) == region.exits.end()) region.exits.push_back(exit);
+					continue;
+				}
+
+				uint8 &next_label = region.tile_patch[GetLocalTileIndex(next)];
+				if (next_label == INVALID_WATER_REGION_PATCH) {
+					next_label = label;
+					stack.push_back(next);
+				}
+			}
+		}
+	}
+
+	/* Don't keep the labels of regions without water around. */
+	if (region.number_of_patches == 0) region.tile_patch.clear();
+	region.initialized = true;
+}
+
+/**
+ * Get an up to date water region.
+ * @param index The index of the region.
+ * @return The region.
+ */
+static const WaterRegion &GetUpdatedWaterRegion(uint index)
+{
+	WaterRegion &region = _water_regions[index];
+	if (!region.initialized) CalculateWaterRegion(region, index);
+	return region;
+}
+
+/**
+ * Get the patch of water a tile belongs to.
+ * @param tile The tile.
+ * @return The region and patch label of the tile; the label is #INVALID_WATER_REGION_PATCH if ships can't sail there.
+ */
+WaterRegionPatchDesc GetWaterRegionPatchInfo(TileIndex tile)
+{
+	uint index = GetWaterRegionIndex(tile);
+	const WaterRegion &region = GetUpdatedWaterRegion(index);
+	if (region.number_of_patches == 0) return { index, INVALID_WATER_REGION_PATCH };
+	return { index, region.tile_patch[GetLocalTileIndex(tile)] };
+}
+
+/**
+ * Mark the water regions that depend on a tile as outdated. Besides the region
+ * of the tile itself, the exits of the neighbouring regions depend on it.
+ * @param tile The changed tile.
+ */
+void InvalidateWaterRegion(TileIndex tile)
+{
+	if (_water_regions.empty()) return;
+
+	_water_regions[GetWaterRegionIndex(tile)].initialized = false;
+	for (DiagDirection dir = DIAGDIR_BEGIN; dir < DIAGDIR_END; dir++) {
+		TileIndexDiffC diff = TileIndexDiffCByDiagDir(dir);
+		TileIndex neighbour = TileAddWrap(tile, diff.x, diff.y);
+		if (neighbour != INVALID_TILE) _water_regions[GetWaterRegionIndex(neighbour)].initialized = false;
+	}
+}
+
+/** Throw away all water regions, e.g. because a new map has been created or loaded. */
+void InitializeWaterRegions()
+{
+	_water_regions.clear();
+	_water_regions.resize(GetWaterRegionMapSizeX() * (Map::SizeY() / WATER_REGION_EDGE_LENGTH));
+}
+
+/**
+ * Encode a patch as a single number for use as key.
+ * @param patch The patch.
+ * @return The key.
+ */
+static inline uint32 GetWaterRegionPatchKey(const WaterRegionPatchDesc &patch)
+{
+	return patch.region << 8 | patch.label;
+}
+
+/**
+ * Decode a key created by #GetWaterRegionPatchKey.
+ * @param key The key.
+ * @return The patch.
+ */
+static inline WaterRegionPatchDesc GetWaterRegionPatchFromKey(uint32 key)
+{
+	return { key >> 8, (uint8)GB(key, 0, 8) };
+}
+
+/**
+ * Get the distance between two regions in regions.
+ * @param a First region.
+ * @param b Second region.
+ * @return The Manhattan distance between the regions.
+ */
+static uint GetWaterRegionDistance(uint a, uint b)
+{
+	uint size_x = GetWaterRegionMapSizeX();
+	return Delta(a % size_x, b % size_x) + Delta(a / size_x, b / size_x);
+}
+
+/**
+ * Find a path over patches of water from a tile to any of the destination
+ * tiles with A*. Each step between neighbouring regions costs one, so the
+ * path is the one crossing the fewest region borders.
+ * @param origin       Tile to start from.
+ * @param destinations Tiles to find a path to.
+ * @param max_nodes    Maximum number of patches to look at.
+ * @param[out] path    The patches of the path, starting with the patch of \a origin.
+ * @return Whether a path was found.
+ */
+bool FindWaterRegionPath(TileIndex origin, const std::vector<TileIndex> &destinations, uint max_nodes, std::vector<WaterRegionPatchDesc> &path)
+{
+	path.clear();
+
+	WaterRegionPatchDesc start = GetWaterRegionPatchInfo(origin);
+	if (start.label == INVALID_WATER_REGION_PATCH) return false;
+
+	std::vector<WaterRegionPatchDesc> targets;
+	for (TileIndex tile : destinations) {
+		WaterRegionPatchDesc target = GetWaterRegionPatchInfo(tile);
+		if (target.label != INVALID_WATER_REGION_PATCH) targets.push_back(target);
+	}
+	if (targets.empty()) return false;
+
+	auto estimate = [&targets](uint region) {
+		uint best = UINT_MAX;
+		for (const WaterRegionPatchDesc &target : targets) best = std::min(best, GetWaterRegionDistance(region, target.region));
+		return best;
+	};
+
+	/** Patch on the open list, ordered by estimated total cost and then by key. */
+	typedef std::pair<uint, uint32> OpenNode;
+	std::priority_queue<OpenNode, std::vector<OpenNode>, std::greater<OpenNode>> open;
+	/** Cost and parent of each patch that has been seen. */
+	struct Visited {
+		uint cost;
+		uint32 parent;
+	};
+	std::unordered_map<uint32, Visited> visited;
+
+	uint32 start_key = GetWaterRegionPatchKey(start);
+	visited[start_key] = { 0, start_key };
+	open.push({ estimate(start.region), start_key });
+
+	uint nodes = 0;
+	while (!open.empty() && nodes < max_nodes) {
+		uint32 key = open.top().second;
+		uint f = open.top().first;
+		open.pop();
+
+		WaterRegionPatchDesc patch = GetWaterRegionPatchFromKey(key);
+		uint cost = visited[key].cost;
+		/* Skip outdated entries of patches that were reached cheaper since. */
+		if (f != cost + estimate(patch.region)) continue;
+		nodes++;
+
+		if (std::find(targets.begin(), targets.end(), patch) != targets.end()) {
+			for (;;) {
+				path.push_back(GetWaterRegionPatchFromKey(key));
+				if (key == start_key) break;
+				key = visited[key].parent;
+			}
+			std::reverse(path.begin(), path.end());
+			return true;
+		}
+
+		for (const WaterRegion::Exit &exit : GetUpdatedWaterRegion(patch.region).exits) {
+			if (exit.label != patch.label) continue;
+
+			WaterRegionPatchDesc next = GetWaterRegionPatchInfo(exit.tile);
+			if (next.label == INVALID_WATER_REGION_PATCH) continue;
+
+			uint32 next_key = GetWaterRegionPatchKey(next);
+			uint next_cost = cost + GetWaterRegionDistance(patch.region, next.region);
+			auto it = visited.find(next_key);
+			if (it != visited.end() && it->second.cost <= next_cost) continue;
+
+			visited[next_key] = { next_cost, key };
+			open.push({ next_cost + estimate(next.region), next_key });
+		}
+	}
+
+	return false;
+}
+
+/** Check whether the calculated water regions still match the map; used by the desync debugging. */
+void CheckWaterRegions()
+{
+	for (uint index = 0; index < _water_regions.size(); index++) {
+		const WaterRegion &region = _water_regions[index];
+		if (!region.initialized) continue;
+
+		WaterRegion fresh;
+		CalculateWaterRegion(fresh, index);
+		if (fresh.tile_patch != region.tile_patch || fresh.exits != region.exits) {
+			Debug(desync, 2, "water region mismatch: region {}", index);
+		}
+	}
+}
@@ -0,0 +1,43 @@
+/*
+ * This file is part of OpenTTD.
+ * OpenTTD is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, version 2.
+ * OpenTTD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file water_regions.h Coarse graph of water regions to speed up ship pathfinding. */
+
+#ifndef WATER_REGIONS_H
+#define WATER_REGIONS_H
+
+#include "../tile_type.h"
+#include <vector>
+
+static const uint WATER_REGION_EDGE_LENGTH = 16;   ///< Number of tiles along each edge of a water region.
+static const uint WATER_REGION_NUMBER_OF_TILES = WATER_REGION_EDGE_LENGTH * WATER_REGION_EDGE_LENGTH; ///< Number of tiles in a water region.
+
+static const uint8 INVALID_WATER_REGION_PATCH = 0; ///< Patch label of tiles ships can't sail on.
+
+/**
+ * A patch of water within a water region. All tiles of a patch can be
+ * reached from each other without leaving the region.
+ */
+struct WaterRegionPatchDesc {
+	uint  region; ///< Index of the water region.
+	uint8 label;  ///< Label of the patch within the region, #INVALID_WATER_REGION_PATCH if not water.
+
+	bool operator ==(const WaterRegionPatchDesc &other) const { return this->region == other.region && this->label == other.label; }
+	bool operator !=(const WaterRegionPatchDesc &other) const { return !(*this == other); }
+};
+
+uint GetWaterRegionIndex(TileIndex tile);
+WaterRegionPatchDesc GetWaterRegionPatchInfo(TileIndex tile);
+void GetWaterRegionBounds(uint region, uint *x, uint *y);
+
+bool FindWaterRegionPath(TileIndex origin, const std::vector<TileIndex> &destinations, uint max_nodes, std::vector<WaterRegionPatchDesc> &path);
+
+void InvalidateWaterRegion(TileIndex tile);
+void InitializeWaterRegions();
+void CheckWaterRegions();
+
+#endif /* WATER_REGIONS_H */
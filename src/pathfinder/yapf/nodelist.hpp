@@ -13,18 +13,21 @@
 #include "../../misc/array.hpp"
 #include "../../misc/hashtable.hpp"
 #include "../../misc/binaryheap.hpp"
+#include <vector>
 
 /**
  * Hash table based node list multi-container class.
  *  Implements open list, closed list and priority queue for A-star
  *  path finder.
+ *  The items are allocated in blocks of Titem_block_ items; pathfinders
+ *  that keep many node lists alive at once can use smaller blocks.
  */
-template <class Titem_, int Thash_bits_open_, int Thash_bits_closed_>
+template <class Titem_, int Thash_bits_open_, int Thash_bits_closed_, uint Titem_block_ = 65536>
 class CNodeList_HashTableT {
 public:
 	typedef Titem_ Titem;                                        ///< Make #Titem_ visible from outside of class.
 	typedef typename Titem_::Key Key;                            ///< Make Titem_::Key a property of this class.
-	typedef SmallArray<Titem_, 65536, 256> CItemArray;           ///< Type that we will use as item container.
+	typedef SmallArray<Titem_, Titem_block_, 256> CItemArray;    ///< Type that we will use as item container.
 	typedef CHashTableT<Titem_, Thash_bits_open_  > COpenList;   ///< How pointers to open nodes will be stored.
 	typedef CHashTableT<Titem_, Thash_bits_closed_> CClosedList; ///< How pointers to closed nodes will be stored.
 	typedef CBinaryHeapT<Titem_> CPriorityQueue;                 ///< How the priority queue will be managed.
@@ -157,4 +160,296 @@ public:
 	}
 };
 
+/**
+ * Node list multi-container class with a 4-ary heap as priority queue.
+ *  Implements the same interface as #CNodeList_HashTableT, but is laid
+ *  out to avoid chasing pointers while searching:
+ *   - The items are kept in an arena and referred to by their index.
+ *   - The priority queue is a 4-ary heap of (cost estimate, index) pairs,
+ *     so the heap can be ordered without touching the items.
+ *   - Open and closed items are found by key through a single hash table
+ *     with open addressing that also stores the hash of each key.
+ *  Items with equal cost estimates are popped in the order they were
+ *  inserted into the open list, so an item whose cost was updated goes
+ *  after the items with the same estimate that were already open.
+ */
+template <class Titem_, int Thash_bits_, uint Titem_block_ = 65536>
+class CNodeList_DaryHeapT {
+	static_assert(Thash_bits_ > 0 && Thash_bits_ < 32);
+
+public:
+	typedef Titem_ Titem;                                      ///< Make #Titem_ visible from outside of class.
+	typedef typename Titem_::Key Key;                          ///< Make Titem_::Key a property of this class.
+	typedef SmallArray<Titem_, Titem_block_, 256> CItemArray;  ///< Type that we will use as item container.
+
+protected:
+	static constexpr uint HEAP_ARITY = 4;                 ///< Number of children of each heap entry.
+	static constexpr uint32 INVALID_INDEX = UINT32_MAX;   ///< Index of an empty hash table slot.
+	static constexpr uint32 NODE_DETACHED = UINT32_MAX;   ///< Heap position of an item that is neither open nor closed.
+	static constexpr uint32 NODE_CLOSED = UINT32_MAX - 1; ///< Heap position of a closed item.
+
+	/** Entry of the priority queue. */
+	struct HeapEntry {
+		int estimate; ///< Cost estimate of the item.
+		uint32 order; ///< Number of insertions into the open list before this one, to pop equal estimates in insertion order.
+		uint32 index; ///< Index of the item in the arena.
+
+		inline bool operator<(const HeapEntry &other) const
+		{
+			return this->estimate < other.estimate || (this->estimate == other.estimate && this->order < other.order);
+		}
+	};
+
+	/** Slot of the hash table. */
+	struct HashSlot {
+		uint32 hash;  ///< Hash of the key of the item.
+		uint32 index; ///< Index of the item in the arena, or #INVALID_INDEX for an empty slot.
+	};
+
+	CItemArray             m_arr;          ///< Here we store full item data (Titem_).
+	std::vector<uint32>    m_heap_pos;     ///< Position in m_heap of each item, or #NODE_DETACHED / #NODE_CLOSED.
+	std::vector<HeapEntry> m_heap;         ///< 4-ary heap of the open items.
+	std::vector<HashSlot>  m_hash;         ///< Hash table with open addressing of the open and closed items.
+	uint                   m_hash_shift;   ///< Shift of a hash to get its slot in m_hash.
+	uint                   m_hash_count;   ///< Number of used slots in m_hash.
+	uint                   m_closed_count; ///< Number of closed items.
+	uint32                 m_insert_count; ///< Number of insertions into the open list.
+	Titem                 *m_new_node;     ///< New open node under construction.
+	uint32                 m_new_index;    ///< Index of m_new_node in m_arr.
+
+	/** Spread the bits of a key's hash over the full width, so the high bits can be used as slot. */
+	static inline uint32 HashKey(const Key &key)
+	{
+		return (uint32)key.CalcHash() * 0x9E3779B1U;
+	}
+
+	/**
+	 * Find the slot of a key in the hash table.
+	 * @param key  The key.
+	 * @param hash Hash of the key.
+	 * @return The slot with the item of the key, or the empty slot where it belongs.
+	 */
+	inline HashSlot &FindSlot(const Key &key, uint32 hash)
+	{
+		uint mask = (uint)m_hash.size() - 1;
+		for (uint slot = hash >> m_hash_shift;; slot = (slot + 1) & mask) {
+			HashSlot &s = m_hash[slot];
+			if (s.index == INVALID_INDEX) return s;
+			if (s.hash == hash && m_arr[s.index].GetKey() == key) return s;
+		}
+	}
+
+	/** Double the size of the hash table and reinsert all items. */
+	void GrowHash()
+	{
+		std::vector<HashSlot> old(m_hash.size() * 2, { 0, INVALID_INDEX });
+		old.swap(m_hash);
+		m_hash_shift--;
+		uint mask = (uint)m_hash.size() - 1;
+		for (const HashSlot &s : old) {
+			if (s.index == INVALID_INDEX) continue;
+			uint slot = s.hash >> m_hash_shift;
+			while (m_hash[slot].index != INVALID_INDEX) slot = (slot + 1) & mask;
+			m_hash[slot] = s;
+		}
+	}
+
+	/**
+	 * Get the index of an item that is in the hash table.
+	 * @param item The item.
+	 * @return The index of the item in m_arr.
+	 */
+	inline uint32 IndexOf(const Titem_ &item)
+	{
+		uint32 index = FindSlot(item.GetKey(), HashKey(item.GetKey())).index;
+		assert(index != INVALID_INDEX && &m_arr[index] == &item);
+		return index;
+	}
+
+	/** Store an entry at a position of the heap. */
+	inline void PlaceHeapEntry(uint pos, const HeapEntry &entry)
+	{
+		m_heap[pos] = entry;
+		m_heap_pos[entry.index] = pos;
+	}
+
+	/** Move an entry from the given position towards the root until the heap is in order. */
+	void SiftUp(uint pos, HeapEntry entry)
+	{
+		while (pos > 0) {
+			uint parent = (pos - 1) / HEAP_ARITY;
+			if (!(entry < m_heap[parent])) break;
+			PlaceHeapEntry(pos, m_heap[parent]);
+			pos = parent;
+		}
+		PlaceHeapEntry(pos, entry);
+	}
+
+	/** Move an entry from the given position towards the leaves until the heap is in order. */
+	void SiftDown(uint pos, HeapEntry entry)
+	{
+		uint count = (uint)m_heap.size();
+		for (;;) {
+			uint first = pos * HEAP_ARITY + 1;
+			if (first >= count) break;
+			uint last = std::min(first + HEAP_ARITY, count);
+			uint best = first;
+			for (uint child = first + 1; child < last; child++) {
+				if (m_heap[child] < m_heap[best]) best = child;
+			}
+			if (!(m_heap[best] < entry)) break;
+			PlaceHeapEntry(pos, m_heap[best]);
+			pos = best;
+		}
+		PlaceHeapEntry(pos, entry);
+	}
+
+	/** Remove the entry at the given position from the heap. */
+	void RemoveHeapEntry(uint pos)
+	{
+		m_heap_pos[m_heap[pos].index] = NODE_DETACHED;
+		HeapEntry last = m_heap.back();
+		m_heap.pop_back();
+		if (pos == m_heap.size()) return;
+		if (pos > 0 && last < m_heap[(pos - 1) / HEAP_ARITY]) {
+			SiftUp(pos, last);
+		} else {
+			SiftDown(pos, last);
+		}
+	}
+
+public:
+	/** default constructor */
+	CNodeList_DaryHeapT() : m_hash((size_t)1 << Thash_bits_, { 0, INVALID_INDEX }), m_hash_shift(32 - Thash_bits_), m_hash_count(0), m_closed_count(0), m_insert_count(0), m_new_node(nullptr), m_new_index(0)
+	{
+		m_heap.reserve(2048);
+	}
+
+	/** return number of open nodes */
+	inline int OpenCount()
+	{
+		return (int)m_heap.size();
+	}
+
+	/** return number of closed nodes */
+	inline int ClosedCount()
+	{
+		return m_closed_count;
+	}
+
+	/** allocate new data item from m_arr */
+	inline Titem_ *CreateNewNode()
+	{
+		if (m_new_node == nullptr) {
+			m_new_index = m_arr.Length();
+			m_new_node = m_arr.AppendC();
+			m_heap_pos.push_back(NODE_DETACHED);
+		}
+		return m_new_node;
+	}
+
+	/** Notify the nodelist that we don't want to discard the given node. */
+	inline void FoundBestNode(Titem_ &item)
+	{
+		if (&item == m_new_node) {
+			m_new_node = nullptr;
+		}
+	}
+
+	/** insert given item as open node */
+	inline void InsertOpenNode(Titem_ &item)
+	{
+		uint32 index;
+		if (&item == m_new_node) {
+			/* A new item; it gets a slot in the hash table. */
+			uint32 hash = HashKey(item.GetKey());
+			HashSlot &slot = FindSlot(item.GetKey(), hash);
+			assert(slot.index == INVALID_INDEX);
+			index = m_new_index;
+			slot.hash = hash;
+			slot.index = index;
+			m_new_node = nullptr;
+			if (++m_hash_count * 2 > m_hash.size()) GrowHash();
+		} else {
+			/* An item that was taken from the open list to update its cost. */
+			index = IndexOf(item);
+			assert(m_heap_pos[index] == NODE_DETACHED);
+		}
+		m_heap.emplace_back();
+		SiftUp((uint)m_heap.size() - 1, { item.GetCostEstimate(), m_insert_count++, index });
+	}
+
+	/** return the best open node */
+	inline Titem_ *GetBestOpenNode()
+	{
+		if (!m_heap.empty()) {
+			return &m_arr[m_heap.front().index];
+		}
+		return nullptr;
+	}
+
+	/** remove and return the best open node */
+	inline Titem_ *PopBestOpenNode()
+	{
+		if (!m_heap.empty()) {
+			Titem_ *item = &m_arr[m_heap.front().index];
+			RemoveHeapEntry(0);
+			return item;
+		}
+		return nullptr;
+	}
+
+	/** return the open node specified by a key or nullptr if not found */
+	inline Titem_ *FindOpenNode(const Key &key)
+	{
+		uint32 index = FindSlot(key, HashKey(key)).index;
+		if (index == INVALID_INDEX || m_heap_pos[index] >= NODE_CLOSED) return nullptr;
+		return &m_arr[index];
+	}
+
+	/** remove and return the open node specified by a key */
+	inline Titem_& PopOpenNode(const Key &key)
+	{
+		uint32 index = FindSlot(key, HashKey(key)).index;
+		assert(index != INVALID_INDEX && m_heap_pos[index] < NODE_CLOSED);
+		RemoveHeapEntry(m_heap_pos[index]);
+		return m_arr[index];
+	}
+
+	/** close node */
+	inline void InsertClosedNode(Titem_ &item)
+	{
+		uint32 index = IndexOf(item);
+		assert(m_heap_pos[index] == NODE_DETACHED);
+		m_heap_pos[index] = NODE_CLOSED;
+		m_closed_count++;
+	}
+
+	/** return the closed node specified by a key or nullptr if not found */
+	inline Titem_ *FindClosedNode(const Key &key)
+	{
+		uint32 index = FindSlot(key, HashKey(key)).index;
+		if (index == INVALID_INDEX || m_heap_pos[index] != NODE_CLOSED) return nullptr;
+		return &m_arr[index];
+	}
+
+	/** The number of items. */
+	inline int TotalCount()
+	{
+		return m_arr.Length();
+	}
+
+	/** Get a particular item. */
+	inline Titem_& ItemAt(int idx)
+	{
+		return m_arr[idx];
+	}
+
+	/** Helper for creating output of this array. */
+	template <class D> void Dump(D &dmp) const
+	{
+		dmp.WriteStructT("m_arr", &m_arr);
+	}
+};
+
 #endif /* NODELIST_HPP */
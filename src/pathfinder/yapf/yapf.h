@@ -61,6 +61,18 @@ Trackdir YapfRoadVehicleChooseTrack(const RoadVehicle *v, TileIndex tile, DiagDi
  */
 Track YapfTrainChooseTrack(const Train *v, TileIndex tile, DiagDirection enterdir, TrackBits tracks, bool &path_found, bool reserve_track, struct PBSTileInfo *target, TileIndex *dest);
 
+/**
+ * Search the paths of trains approaching a junction ahead of time on the task threads.
+ * #YapfTrainChooseTrack uses such a path when nothing the search depends on has changed
+ * by the time the train asks for it, and searches again otherwise.
+ */
+void YapfTrainPlanPaths();
+
+/**
+ * Forget all paths of trains searched ahead of time.
+ */
+void YapfTrainDropPlannedPaths();
+
 /**
  * Used when user sends road vehicle to the nearest depot or if road vehicle needs servicing using YAPF.
  * @param v            vehicle that needs to go to some depot
@@ -12,6 +12,7 @@
 
 #include "../../debug.h"
 #include "../../settings_type.h"
+#include "yapf_benchmark.h"
 
 /**
  * CYapfBaseT - A-star type path finder base class.
@@ -28,6 +29,8 @@
  *
  *  For node list you can use template class CNodeList_HashTableT, for which
  *  you need to declare only your node type. Look at test_yapf.h for an example.
+ *  CNodeList_DaryHeapT has the same interface, but keeps the priority queue
+ *  and the hash table apart from the nodes, which makes large searches faster.
  *
  *
  *  Requirements to your pathfinder class derived from CYapfBaseT:
@@ -138,6 +141,7 @@ public:
 		}
 
 		bDestFound &= (m_pBestDestNode != nullptr);
+		_yapf_expanded_nodes.fetch_add(m_num_steps, std::memory_order_relaxed);
 
 		if (_debug_yapf_level >= 3) {
 			UnitID veh_idx = (m_veh != nullptr) ? m_veh->unitnumber : 0;
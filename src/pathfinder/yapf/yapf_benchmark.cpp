@@ -0,0 +1,123 @@
+/*
+ * This file is part of OpenTTD.
+ * OpenTTD is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, version 2.
+ * OpenTTD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file yapf_benchmark.cpp Recording and replaying of pathfinder queries to benchmark YAPF. */
+
+#include "../../stdafx.h"
+
+#include "yapf.h"
+#include "yapf_benchmark.h"
+#include "yapf_cache.h"
+#include "../../train.h"
+#include "../../map_func.h"
+
+#include <chrono>
+#include <sstream>
+
+#include "../../safeguards.h"
+
+std::atomic<uint64> _yapf_expanded_nodes; ///< Number of nodes expanded by all YAPF searches.
+
+/** Names of the query types in the recorded queries. */
+static const char * const _yapf_query_names[] = { "train", "road", "ship" };
+static_assert(lengthof(_yapf_query_names) == YQT_END);
+
+/**
+ * Format a query as line for the file of recorded queries.
+ * @param query The query.
+ * @return The line, without line end.
+ */
+std::string FormatYapfQuery(const YapfQuery &query)
+{
+	return fmt::format("{} {} {} {} {}", _yapf_query_names[query.type], query.vehicle, static_cast<uint32>(query.tile), (int)query.enterdir, query.tracks);
+}
+
+/**
+ * Parse a line of the file of recorded queries.
+ * @param line The line.
+ * @param[out] query The parsed query.
+ * @return True iff the line contains a query.
+ */
+bool ParseYapfQuery(const std::string &line, YapfQuery *query)
+{
+	std::istringstream stream(line);
+	std::string name;
+	uint vehicle, tile, enterdir, tracks;
+	if (!(stream >> name >> vehicle >> tile >> enterdir >> tracks)) return false;
+
+	auto type = std::find(std::begin(_yapf_query_names), std::end(_yapf_query_names), name);
+	if (type == std::end(_yapf_query_names)) return false;
+	if (vehicle >= INVALID_VEHICLE || enterdir >= DIAGDIR_END || tracks > UINT16_MAX) return false;
+
+	query->type = (YapfQueryType)(type - std::begin(_yapf_query_names));
+	query->vehicle = vehicle;
+	query->tile = tile;
+	query->enterdir = (DiagDirection)enterdir;
+	query->tracks = tracks;
+	return true;
+}
+
+/**
+ * Replay recorded queries against the current game and measure the searches.
+ * Nothing is reserved and the found paths are not cached for the vehicles,
+ * so the game state does not change. Queries are recorded while the game
+ * runs, so replaying them against a savegame of the start of the recording
+ * does not exactly reproduce the original searches, but gives a workload
+ * that is representative for the game.
+ * @param queries The queries.
+ * @param[in,out] stats The statistics to add the results to, for each query type.
+ */
+void ReplayYapfQueries(const std::vector<YapfQuery> &queries, YapfQueryStats stats[YQT_END])
+{
+	static const VehicleType query_vehicle_types[] = { VEH_TRAIN, VEH_ROAD, VEH_SHIP };
+
+	/* The searches have to be measured, not the paths searched ahead of time. */
+	YapfTrainDropPlannedPaths();
+
+	for (const YapfQuery &query : queries) {
+		YapfQueryStats &s = stats[query.type];
+		const Vehicle *v = Vehicle::GetIfValid(query.vehicle);
+		if (v == nullptr || v->type != query_vehicle_types[query.type] || !v->IsPrimaryVehicle() || query.tile >= Map::Size()) {
+			s.skipped++;
+			continue;
+		}
+
+		uint64 nodes = _yapf_expanded_nodes;
+		uint64 hits, misses;
+		YapfGetSegmentCacheStats(&hits, &misses);
+		auto start = std::chrono::steady_clock::now();
+
+		bool path_found;
+		switch (query.type) {
+			case YQT_TRAIN:
+				YapfTrainChooseTrack(Train::From(v), query.tile, query.enterdir, (TrackBits)query.tracks, path_found, false, nullptr, nullptr);
+				break;
+
+			case YQT_ROAD: {
+				RoadVehPathCache path_cache;
+				YapfRoadVehicleChooseTrack(RoadVehicle::From(v), query.tile, query.enterdir, (TrackdirBits)query.tracks, path_found, path_cache);
+				break;
+			}
+
+			case YQT_SHIP: {
+				ShipPathCache path_cache;
+				YapfShipChooseTrack(Ship::From(v), query.tile, query.enterdir, (TrackBits)query.tracks, path_found, path_cache);
+				break;
+			}
+
+			default: NOT_REACHED();
+		}
+
+		s.time_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+		uint64 end_hits, end_misses;
+		YapfGetSegmentCacheStats(&end_hits, &end_misses);
+		s.queries++;
+		s.nodes += _yapf_expanded_nodes - nodes;
+		s.cache_hits += end_hits - hits;
+		s.cache_misses += end_misses - misses;
+	}
+}
@@ -0,0 +1,53 @@
+/*
+ * This file is part of OpenTTD.
+ * OpenTTD is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, version 2.
+ * OpenTTD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file yapf_benchmark.h Recording and replaying of pathfinder queries to benchmark YAPF. */
+
+#ifndef YAPF_BENCHMARK_H
+#define YAPF_BENCHMARK_H
+
+#include "../../direction_type.h"
+#include "../../tile_type.h"
+#include "../../vehicle_type.h"
+#include <atomic>
+#include <string>
+#include <vector>
+
+/** Pathfinder function a query was made to. */
+enum YapfQueryType : byte {
+	YQT_TRAIN, ///< YapfTrainChooseTrack
+	YQT_ROAD,  ///< YapfRoadVehicleChooseTrack
+	YQT_SHIP,  ///< YapfShipChooseTrack
+	YQT_END,   ///< End marker.
+};
+
+/** Arguments of a single call to one of the Yapf*ChooseTrack functions. */
+struct YapfQuery {
+	YapfQueryType type;     ///< Pathfinder function that was called.
+	VehicleID vehicle;      ///< Vehicle the path was searched for.
+	TileIndex tile;         ///< Tile the vehicle is about to enter.
+	DiagDirection enterdir; ///< Direction in which the vehicle enters the tile.
+	uint16 tracks;          ///< Available TrackBits, or TrackdirBits for road vehicles.
+};
+
+/** Totals of replaying the queries of one type. */
+struct YapfQueryStats {
+	uint queries;        ///< Number of replayed queries.
+	uint skipped;        ///< Number of queries whose vehicle or tile does not fit the current game.
+	uint64 nodes;        ///< Number of nodes expanded by the searches.
+	uint64 cache_hits;   ///< Number of segments found in the segment caches.
+	uint64 cache_misses; ///< Number of segments added to the segment caches.
+	uint64 time_ns;      ///< Wall time spent in the searches, in nanoseconds.
+};
+
+extern std::atomic<uint64> _yapf_expanded_nodes;
+
+std::string FormatYapfQuery(const YapfQuery &query);
+bool ParseYapfQuery(const std::string &line, YapfQuery *query);
+void ReplayYapfQueries(const std::vector<YapfQuery> &queries, YapfQueryStats stats[YQT_END]);
+
+#endif /* YAPF_BENCHMARK_H */
@@ -19,4 +19,24 @@
  */
 void YapfNotifyTrackLayoutChange(TileIndex tile, Track track);
 
+/**
+ * Use this function to notify YAPF that the road on a tile has changed.
+ * @param tile the tile that is changed, or INVALID_TILE to flush all cached road segments
+ */
+void YapfNotifyRoadLayoutChange(TileIndex tile);
+
+/**
+ * Check whether the cached road segments still match the road on the map.
+ * A difference means a change of the road did not invalidate the segments
+ * running over it, so a client with a fresh cache could choose different paths.
+ */
+void YapfCheckRoadSegmentCache();
+
+/**
+ * Get the statistics of the rail and road segment caches since the start of the program.
+ * @param[out] hits   number of segments that were found in the caches
+ * @param[out] misses number of segments that had to be calculated
+ */
+void YapfGetSegmentCacheStats(uint64 *hits, uint64 *misses);
+
 #endif /* YAPF_CACHE_H */
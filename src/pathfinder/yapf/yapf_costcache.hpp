@@ -11,6 +11,7 @@
 #define YAPF_COSTCACHE_HPP
 
 #include "../../date_func.h"
+#include <unordered_map>
 
 /**
  * CYapfSegmentCostCacheNoneT - the formal only yapf cost cache provider that implements
@@ -40,6 +41,14 @@ public:
 	inline void PfNodeCacheFlush(Node &n)
 	{
 	}
+
+	/**
+	 * Called by YAPF for every tile of a segment whose cost is being calculated.
+	 *  Current cache implementation doesn't use that.
+	 */
+	inline void PfNodeCacheAddTile(Node &n, TileIndex tile)
+	{
+	}
 };
 
 
@@ -87,23 +96,117 @@ public:
 	inline void PfNodeCacheFlush(Node &n)
 	{
 	}
+
+	/**
+	 * Called by YAPF for every tile of a segment whose cost is being calculated.
+	 *  Local segments are thrown away after the run, so they don't need that.
+	 */
+	inline void PfNodeCacheAddTile(Node &n, TileIndex tile)
+	{
+	}
+};
+
+
+/**
+ * CYapfSegmentCostCacheRecordT - the yapf cost cache provider for searches that run
+ *  outside of the main thread. Like the local provider it never touches the global
+ *  caches, but it records all tiles the segments run over or tried to follow into,
+ *  so the caller can check later on whether the result of the search is still valid.
+ */
+template <class Types>
+class CYapfSegmentCostCacheRecordT : public CYapfSegmentCostCacheLocalT<Types>
+{
+public:
+	typedef typename Types::NodeList::Titem Node; ///< this will be our node type
+
+protected:
+	std::vector<TileIndex> m_recorded_tiles; ///< tiles read for all calculated segments, might contain duplicates
+
+public:
+	/**
+	 * Called by YAPF for every tile of a segment whose cost is being calculated.
+	 *  Records the tile for the validation of the result.
+	 */
+	inline void PfNodeCacheAddTile(Node &n, TileIndex tile)
+	{
+		m_recorded_tiles.push_back(tile);
+	}
+
+	/** Get the tiles the segments of the search were calculated from. */
+	inline const std::vector<TileIndex> &GetRecordedTiles() const
+	{
+		return m_recorded_tiles;
+	}
 };
 
 
+/**
+ * Call a function for the tile the track follower arrived at, and for every
+ * tile it skipped on the way there: the other tiles of a station platform,
+ * or the middle tiles of a tunnel or bridge.
+ * @param tile    Tile the track follower arrived at.
+ * @param exitdir Direction the track follower moved in.
+ * @param skipped Number of tiles skipped before reaching \a tile.
+ * @param proc    Function to call with each tile.
+ */
+template <typename Tproc>
+inline void IterateFollowedTiles(TileIndex tile, DiagDirection exitdir, int skipped, Tproc proc)
+{
+	TileIndexDiff diff = TileOffsByDiagDir(ReverseDiagDir(exitdir));
+	for (; skipped >= 0; skipped--, tile += diff) proc(tile);
+}
+
 /**
  * Base class for segment cost cache providers. Contains global counter
  *  of track layout changes and static notification function called whenever
  *  the track layout changes. It is implemented as base class because it needs
  *  to be shared between all rail YAPF types (one shared counter, one notification
- *  function.
+ *  function. Every cache registers itself, so a change of a single tile only
+ *  drops the segments that run over (or end next to) that tile from all caches.
  */
 struct CSegmentCostCacheBase
 {
-	static int   s_rail_change_counter;
+	typedef std::vector<CSegmentCostCacheBase *> CacheList;
+
+	static int    s_rail_change_counter;
+	static uint64 s_cache_hits;   ///< Number of segments that were found in a global cache.
+	static uint64 s_cache_misses; ///< Number of segments that had to be calculated for a global cache.
+
+	virtual ~CSegmentCostCacheBase() {}
+
+	/**
+	 * Drop all cached segments that run over the given tile.
+	 * @param tile The changed tile.
+	 */
+	virtual void InvalidateTile(TileIndex tile) = 0;
+
+	/** List of all global segment cost caches. */
+	static CacheList &GetCaches()
+	{
+		static CacheList caches;
+		return caches;
+	}
 
 	static void NotifyTrackLayoutChange(TileIndex tile, Track track)
 	{
-		s_rail_change_counter++;
+		if (tile == INVALID_TILE) {
+			/* Unknown change; flush everything the next time a cache is used. */
+			s_rail_change_counter++;
+			return;
+		}
+
+		for (CSegmentCostCacheBase *cache : GetCaches()) {
+			cache->InvalidateTile(tile);
+			/* Segments ending next to the tile depend on what could be followed into it. */
+			for (DiagDirection dir = DIAGDIR_BEGIN; dir < DIAGDIR_END; dir++) {
+				cache->InvalidateTile(TILE_ADD(tile, TileOffsByDiagDir(dir)));
+			}
+		}
+	}
+
+	static void NotifyTrackReservationChange(TileIndex tile)
+	{
+		for (CSegmentCostCacheBase *cache : GetCaches()) cache->InvalidateTile(tile);
 	}
 };
 
@@ -121,21 +224,71 @@ struct CSegmentCostCacheBase
 template <class Tsegment>
 struct CSegmentCostCacheT : public CSegmentCostCacheBase {
 	static const int C_HASH_BITS = 14;
+	static const uint C_MIN_DEAD_SEGMENTS = 1024; ///< Number of invalidated segments before the storage is reclaimed.
 
 	typedef CHashTableT<Tsegment, C_HASH_BITS> HashTable;
 	typedef SmallArray<Tsegment> Heap;
 	typedef typename Tsegment::Key Key;    ///< key to hash table
+	typedef std::unordered_map<uint32, std::vector<Tsegment *>> TileIndexMap;
 
 	HashTable    m_map;
 	Heap         m_heap;
+	TileIndexMap m_tile_segments;  ///< segments running over each tile
+	uint         m_dead_segments;  ///< number of segments in m_heap that are no longer in m_map
 
-	inline CSegmentCostCacheT() {}
+	inline CSegmentCostCacheT() : m_dead_segments(0)
+	{
+		GetCaches().push_back(this);
+	}
+
+	~CSegmentCostCacheT()
+	{
+		CacheList &caches = GetCaches();
+		caches.erase(std::find(caches.begin(), caches.end(), this));
+	}
 
 	/** flush (clear) the cache */
 	inline void Flush()
 	{
 		m_map.Clear();
 		m_heap.Clear();
+		m_tile_segments.clear();
+		m_dead_segments = 0;
+	}
+
+	/**
+	 * Check whether so many segments were invalidated that their storage should be reclaimed.
+	 * That is only safe when no pathfinder is using the cache.
+	 */
+	inline bool NeedsCompaction() const
+	{
+		return m_dead_segments >= C_MIN_DEAD_SEGMENTS && m_dead_segments >= m_heap.Length() / 2;
+	}
+
+	/**
+	 * Remember that a segment runs over a tile.
+	 * @param segment The segment being calculated.
+	 * @param tile    A tile of the segment.
+	 */
+	inline void AddTile(Tsegment &segment, TileIndex tile)
+	{
+		std::vector<Tsegment *> &segments = m_tile_segments[static_cast<uint32>(tile)];
+		if (segments.empty() || segments.back() != &segment) segments.push_back(&segment);
+	}
+
+	void InvalidateTile(TileIndex tile) override
+	{
+		auto it = m_tile_segments.find(static_cast<uint32>(tile));
+		if (it == m_tile_segments.end()) return;
+
+		for (Tsegment *segment : it->second) {
+			/* The segment might be invalidated already via one of its other tiles. */
+			if (m_map.Find(segment->GetKey()) != segment) continue;
+			/* Keep the storage, nodes of a running pathfinder might still point to it. */
+			m_map.Pop(*segment);
+			m_dead_segments++;
+		}
+		m_tile_segments.erase(it);
 	}
 
 	inline Tsegment& Get(Key &key, bool *found)
@@ -185,7 +338,7 @@ protected:
 		static Cache C;
 
 		/* delete the cache sometimes... */
-		if (last_rail_change_counter != Cache::s_rail_change_counter) {
+		if (last_rail_change_counter != Cache::s_rail_change_counter || C.NeedsCompaction()) {
 			last_rail_change_counter = Cache::s_rail_change_counter;
 			C.Flush();
 		}
@@ -206,6 +359,11 @@ public:
 		bool found;
 		CachedData &item = m_global_cache.Get(key, &found);
 		Yapf().ConnectNodeToCachedData(n, item);
+		if (found) {
+			Cache::s_cache_hits++;
+		} else {
+			Cache::s_cache_misses++;
+		}
 		return found;
 	}
 
@@ -216,6 +374,15 @@ public:
 	inline void PfNodeCacheFlush(Node &n)
 	{
 	}
+
+	/**
+	 * Called by YAPF for every tile of a segment whose cost is being calculated.
+	 *  Records the tile so a change to it invalidates the segment.
+	 */
+	inline void PfNodeCacheAddTile(Node &n, TileIndex tile)
+	{
+		if (Yapf().CanUseGlobalCache(n)) m_global_cache.AddTile(*n.m_segment, tile);
+	}
 };
 
 #endif /* YAPF_COSTCACHE_HPP */
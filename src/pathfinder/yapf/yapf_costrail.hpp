@@ -370,6 +370,10 @@ public:
 
 no_entry_cost: // jump here at the beginning if the node has no parent (it is the first node)
 
+			/* Remember the tiles of the segment, including the skipped platform, tunnel and
+			 * bridge tiles, so changing one of them only invalidates this segment. */
+			IterateFollowedTiles(cur.tile, TrackdirToExitdir(cur.td), tf->m_tiles_skipped, [&](TileIndex tile) { Yapf().PfNodeCacheAddTile(n, tile); });
+
 			/* All other tile costs will be calculated here. */
 			segment_cost += Yapf().OneTileCost(cur.tile, cur.td);
 
@@ -482,7 +486,14 @@ no_entry_cost: // jump here at the beginning if the node has no parent (it is th
 			tf = &tf_local;
 			tf_local.Init(v, Yapf().GetCompatibleRailTypes());
 
-			if (!tf_local.Follow(cur.tile, cur.td)) {
+			bool followed = tf_local.Follow(cur.tile, cur.td);
+
+			/* The end of the segment depends on the tile the follower tried to enter as well. */
+			if (tf_local.m_new_tile != INVALID_TILE) {
+				IterateFollowedTiles(tf_local.m_new_tile, tf_local.m_exitdir, tf_local.m_tiles_skipped, [&](TileIndex tile) { Yapf().PfNodeCacheAddTile(n, tile); });
+			}
+
+			if (!followed) {
 				assert(tf_local.m_err != TrackFollower::EC_NONE);
 				/* Can't move to the next tile (EOL?). */
 				if (tf_local.m_err == TrackFollower::EC_RAIL_ROAD_TYPE) {
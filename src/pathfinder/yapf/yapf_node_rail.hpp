@@ -221,4 +221,10 @@ typedef CYapfRailNodeT<CYapfNodeKeyTrackDir> CYapfRailNodeTrackDir;
 typedef CNodeList_HashTableT<CYapfRailNodeExitDir , 8, 10> CRailNodeListExitDir;
 typedef CNodeList_HashTableT<CYapfRailNodeTrackDir, 8, 10> CRailNodeListTrackDir;
 
+/* NodeList types with a 4-ary heap as priority queue */
+typedef CNodeList_DaryHeapT<CYapfRailNodeTrackDir, 10> CRailNodeListTrackDirHeap;
+
+/* NodeList type for searches whose nodes are kept after the search, so many of them can be alive at once */
+typedef CNodeList_DaryHeapT<CYapfRailNodeTrackDir, 10, 4096> CRailNodeListTrackDirSmall;
+
 #endif /* YAPF_NODE_RAIL_HPP */
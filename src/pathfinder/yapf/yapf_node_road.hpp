@@ -10,17 +10,120 @@
 #ifndef YAPF_NODE_ROAD_HPP
 #define YAPF_NODE_ROAD_HPP
 
+/**
+ * key for cached road segments of road YAPF; which road can be followed
+ * depends on the road types the vehicle can drive on and on its owner
+ */
+struct CYapfRoadSegmentKey
+{
+	TileIndex    m_tile;                 ///< first tile of the segment
+	Trackdir     m_td;                   ///< trackdir on the first tile
+	RoadTramType m_rtt;                  ///< whether road or tram track is followed
+	Owner        m_owner;                ///< owner of the vehicle, only its own depots can be entered
+	RoadTypes    m_compatible_roadtypes; ///< road types the vehicle can drive on
+
+	inline CYapfRoadSegmentKey(const CYapfNodeKeyExitDir &node_key, const RoadVehicle *v)
+		: m_tile(node_key.m_tile)
+		, m_td(node_key.m_td)
+		, m_rtt(GetRoadTramType(v->roadtype))
+		, m_owner(v->owner)
+		, m_compatible_roadtypes(v->compatible_roadtypes)
+	{}
+
+	inline int32 CalcHash() const
+	{
+		return (((int)m_tile) << 4) | m_td;
+	}
+
+	inline bool operator==(const CYapfRoadSegmentKey &other) const
+	{
+		return m_tile == other.m_tile && m_td == other.m_td && m_rtt == other.m_rtt &&
+				m_owner == other.m_owner && m_compatible_roadtypes == other.m_compatible_roadtypes;
+	}
+};
+
+/**
+ * cached road segment for road YAPF: the road from a node up to the next junction,
+ * dead end or depot, with everything about its tiles that only changes when the road does
+ */
+struct CYapfRoadSegment
+{
+	typedef CYapfRoadSegmentKey Key;
+
+	/** Flags of a tile of a segment. */
+	enum StepFlags {
+		RSSF_FOLLOWED       = 0, ///< the segment continues after this tile
+		RSSF_LEVEL_CROSSING = 1, ///< the tile is a level crossing
+		RSSF_ROAD_STOP      = 2, ///< the tile is a road stop, its cost depends on how occupied it is
+		RSSF_SLOPE_UP       = 3, ///< the road goes uphill towards the next tile
+	};
+
+	/** A tile of a segment. */
+	struct Step {
+		TileIndex tile;          ///< the tile
+		Trackdir  td;            ///< trackdir on the tile
+		uint8     flags;         ///< #StepFlags of the tile
+		int       tiles_skipped; ///< tunnel or bridge tiles skipped towards the next tile
+		int       min_speed;     ///< minimum speed towards the next tile
+		int       max_speed;     ///< speed limit towards the next tile
+
+		inline bool operator==(const Step &other) const
+		{
+			return tile == other.tile && td == other.td && flags == other.flags && tiles_skipped == other.tiles_skipped &&
+					min_speed == other.min_speed && max_speed == other.max_speed;
+		}
+	};
+
+	CYapfRoadSegmentKey  m_key;
+	std::vector<Step>    m_steps;     ///< tiles of the segment in driving order
+	TileIndex            m_last_tile; ///< tile where the segment ends
+	Trackdir             m_last_td;   ///< trackdir where the segment ends
+	bool                 m_loop;      ///< the road loops back to the start of the segment without any junction
+	CYapfRoadSegment    *m_hash_next;
+
+	inline CYapfRoadSegment(const CYapfRoadSegmentKey &key)
+		: m_key(key)
+		, m_last_tile(INVALID_TILE)
+		, m_last_td(INVALID_TRACKDIR)
+		, m_loop(false)
+		, m_hash_next(nullptr)
+	{}
+
+	inline const Key& GetKey() const
+	{
+		return m_key;
+	}
+
+	inline TileIndex GetTile() const
+	{
+		return m_key.m_tile;
+	}
+
+	inline CYapfRoadSegment *GetHashNext()
+	{
+		return m_hash_next;
+	}
+
+	inline void SetHashNext(CYapfRoadSegment *next)
+	{
+		m_hash_next = next;
+	}
+};
+
 /** Yapf Node for road YAPF */
 template <class Tkey_>
 struct CYapfRoadNodeT : CYapfNodeT<Tkey_, CYapfRoadNodeT<Tkey_> > {
 	typedef CYapfNodeT<Tkey_, CYapfRoadNodeT<Tkey_> > base;
+	typedef CYapfRoadSegment CachedData;
 
+	CYapfRoadSegment *m_segment;
 	TileIndex m_segment_last_tile;
 	Trackdir  m_segment_last_td;
 
 	void Set(CYapfRoadNodeT *parent, TileIndex tile, Trackdir td, bool is_choice)
 	{
 		base::Set(parent, tile, td, is_choice);
+		m_segment = nullptr;
 		m_segment_last_tile = tile;
 		m_segment_last_td = td;
 	}
@@ -34,4 +137,8 @@ typedef CYapfRoadNodeT<CYapfNodeKeyTrackDir> CYapfRoadNodeTrackDir;
 typedef CNodeList_HashTableT<CYapfRoadNodeExitDir , 8, 10> CRoadNodeListExitDir;
 typedef CNodeList_HashTableT<CYapfRoadNodeTrackDir, 8, 10> CRoadNodeListTrackDir;
 
+/* NodeList types with a 4-ary heap as priority queue */
+typedef CNodeList_DaryHeapT<CYapfRoadNodeExitDir , 10> CRoadNodeListExitDirHeap;
+typedef CNodeList_DaryHeapT<CYapfRoadNodeTrackDir, 10> CRoadNodeListTrackDirHeap;
+
 #endif /* YAPF_NODE_ROAD_HPP */
@@ -34,4 +34,8 @@ typedef CYapfShipNodeT<CYapfNodeKeyTrackDir> CYapfShipNodeTrackDir;
 typedef CNodeList_HashTableT<CYapfShipNodeExitDir , 10, 12> CShipNodeListExitDir;
 typedef CNodeList_HashTableT<CYapfShipNodeTrackDir, 10, 12> CShipNodeListTrackDir;
 
+/* NodeList types with a 4-ary heap as priority queue */
+typedef CNodeList_DaryHeapT<CYapfShipNodeExitDir , 12> CShipNodeListExitDirHeap;
+typedef CNodeList_DaryHeapT<CYapfShipNodeTrackDir, 12> CShipNodeListTrackDirHeap;
+
 #endif /* YAPF_NODE_SHIP_HPP */
@@ -16,6 +16,11 @@
 #include "yapf_destrail.hpp"
 #include "../../viewport_func.h"
 #include "../../newgrf_station.h"
+#include "../../task_pool.h"
+
+#include <map>
+#include <memory>
+#include <unordered_map>
 
 #include "../../safeguards.h"
 
@@ -122,6 +127,23 @@ private:
 		return (tile != m_res_dest || td != m_res_dest_td) && (tile != m_res_fail_tile || td != m_res_fail_td);
 	}
 
+	/** Drop the cached segments running over a freshly reserved track/platform. */
+	bool InvalidateReservedTrack(TileIndex tile, Trackdir td)
+	{
+		if (IsRailStationTile(tile)) {
+			TileIndex     start = tile;
+			TileIndexDiff diff = TileOffsByDiagDir(TrackdirToExitdir(ReverseTrackdir(td)));
+			do {
+				CSegmentCostCacheBase::NotifyTrackReservationChange(tile);
+				tile = TILE_ADD(tile, diff);
+			} while (IsCompatibleTrainStationTile(tile, start) && tile != m_origin_tile);
+			tile = start;
+		} else {
+			CSegmentCostCacheBase::NotifyTrackReservationChange(tile);
+		}
+		return tile != m_res_dest || td != m_res_dest_td;
+	}
+
 public:
 	/** Set the target to where the reservation should be extended. */
 	inline void SetReservationTarget(Node *node, TileIndex tile, Trackdir td)
@@ -178,7 +200,9 @@ public:
 		if (target != nullptr) target->okay = true;
 
 		if (Yapf().CanUseGlobalCache(*m_res_node)) {
-			YapfNotifyTrackLayoutChange(INVALID_TILE, INVALID_TRACK);
+			for (Node *node = m_res_node; node->m_parent != nullptr; node = node->m_parent) {
+				node->IterateTiles(Yapf().GetVehicle(), Yapf(), *this, &CYapfReserveTrack<Types>::InvalidateReservedTrack);
+			}
 		}
 
 		return true;
@@ -419,16 +443,39 @@ public:
 
 	inline Trackdir ChooseRailTrack(const Train *v, TileIndex tile, DiagDirection enterdir, TrackBits tracks, bool &path_found, bool reserve_track, PBSTileInfo *target, TileIndex *dest)
 	{
-		if (target != nullptr) target->tile = INVALID_TILE;
-		if (dest != nullptr) *dest = INVALID_TILE;
+		path_found = this->FindRailPath(v, FollowTrainReservation(v));
+		return this->UseRailPath(path_found, reserve_track, target, dest);
+	}
 
+	/**
+	 * Search the best path for the train. This only reads the map, so it
+	 *  can be done ahead of time; see #YapfTrainPlanPaths.
+	 * @param v      The train.
+	 * @param origin The end of the reservation of the train.
+	 * @return Whether a path has been found.
+	 */
+	inline bool FindRailPath(const Train *v, const PBSTileInfo &origin)
+	{
 		/* set origin and destination nodes */
-		PBSTileInfo origin = FollowTrainReservation(v);
 		Yapf().SetOrigin(origin.tile, origin.trackdir, INVALID_TILE, INVALID_TRACKDIR, 1, true);
 		Yapf().SetDestination(v);
 
 		/* find the best path */
-		path_found = Yapf().FindPath(v);
+		return Yapf().FindPath(v);
+	}
+
+	/**
+	 * Choose the track to follow from the path found by #FindRailPath and reserve the path if requested.
+	 * @param[in,out] path_found Whether a path has been found.
+	 * @param reserve_track Whether the path should be reserved.
+	 * @param[out] target The target tile of the reservation.
+	 * @param[out] dest   The final tile of the best path found.
+	 * @return The best trackdir to follow, or INVALID_TRACKDIR.
+	 */
+	inline Trackdir UseRailPath(bool &path_found, bool reserve_track, PBSTileInfo *target, TileIndex *dest)
+	{
+		if (target != nullptr) target->tile = INVALID_TILE;
+		if (dest != nullptr) *dest = INVALID_TILE;
 
 		/* if path not found - return INVALID_TRACKDIR */
 		Trackdir next_trackdir = INVALID_TRACKDIR;
@@ -505,10 +552,10 @@ public:
 	}
 };
 
-template <class Tpf_, class Ttrack_follower, class Tnode_list, template <class Types> class TdestinationT, template <class Types> class TfollowT>
+template <class Tpf_, class Ttrack_follower, class Tnode_list, template <class Types> class TdestinationT, template <class Types> class TfollowT, template <class Types> class TcacheT = CYapfSegmentCostCacheGlobalT>
 struct CYapfRail_TypesT
 {
-	typedef CYapfRail_TypesT<Tpf_, Ttrack_follower, Tnode_list, TdestinationT, TfollowT>  Types;
+	typedef CYapfRail_TypesT<Tpf_, Ttrack_follower, Tnode_list, TdestinationT, TfollowT, TcacheT>  Types;
 
 	typedef Tpf_                                Tpf;
 	typedef Ttrack_follower                     TrackFollower;
@@ -518,32 +565,404 @@ struct CYapfRail_TypesT
 	typedef TfollowT<Types>                     PfFollow;
 	typedef CYapfOriginTileTwoWayT<Types>       PfOrigin;
 	typedef TdestinationT<Types>                PfDestination;
-	typedef CYapfSegmentCostCacheGlobalT<Types> PfCache;
+	typedef TcacheT<Types>                      PfCache;
 	typedef CYapfCostRailT<Types>               PfCost;
 };
 
-struct CYapfRail1         : CYapfT<CYapfRail_TypesT<CYapfRail1        , CFollowTrackRail    , CRailNodeListTrackDir, CYapfDestinationTileOrStationRailT, CYapfFollowRailT> > {};
-struct CYapfRail2         : CYapfT<CYapfRail_TypesT<CYapfRail2        , CFollowTrackRailNo90, CRailNodeListTrackDir, CYapfDestinationTileOrStationRailT, CYapfFollowRailT> > {};
+struct CYapfRail1         : CYapfT<CYapfRail_TypesT<CYapfRail1        , CFollowTrackRail    , CRailNodeListTrackDirHeap, CYapfDestinationTileOrStationRailT, CYapfFollowRailT> > {};
+struct CYapfRail2         : CYapfT<CYapfRail_TypesT<CYapfRail2        , CFollowTrackRailNo90, CRailNodeListTrackDirHeap, CYapfDestinationTileOrStationRailT, CYapfFollowRailT> > {};
+
+/* Rail pathfinders for searches made ahead of time on the task threads; see YapfTrainPlanPaths(). */
+struct CYapfRailPlan1     : CYapfT<CYapfRail_TypesT<CYapfRailPlan1    , CFollowTrackRail    , CRailNodeListTrackDirSmall, CYapfDestinationTileOrStationRailT, CYapfFollowRailT, CYapfSegmentCostCacheRecordT> > {};
+struct CYapfRailPlan2     : CYapfT<CYapfRail_TypesT<CYapfRailPlan2    , CFollowTrackRailNo90, CRailNodeListTrackDirSmall, CYapfDestinationTileOrStationRailT, CYapfFollowRailT, CYapfSegmentCostCacheRecordT> > {};
+
+struct CYapfAnyDepotRail1 : CYapfT<CYapfRail_TypesT<CYapfAnyDepotRail1, CFollowTrackRail    , CRailNodeListTrackDirHeap, CYapfDestinationAnyDepotRailT     , CYapfFollowAnyDepotRailT> > {};
+struct CYapfAnyDepotRail2 : CYapfT<CYapfRail_TypesT<CYapfAnyDepotRail2, CFollowTrackRailNo90, CRailNodeListTrackDirHeap, CYapfDestinationAnyDepotRailT     , CYapfFollowAnyDepotRailT> > {};
+
+struct CYapfAnySafeTileRail1 : CYapfT<CYapfRail_TypesT<CYapfAnySafeTileRail1, CFollowTrackFreeRail    , CRailNodeListTrackDirHeap, CYapfDestinationAnySafeTileRailT , CYapfFollowAnySafeTileRailT> > {};
+struct CYapfAnySafeTileRail2 : CYapfT<CYapfRail_TypesT<CYapfAnySafeTileRail2, CFollowTrackFreeRailNo90, CRailNodeListTrackDirHeap, CYapfDestinationAnySafeTileRailT , CYapfFollowAnySafeTileRailT> > {};
+
+static const uint RAIL_PATH_PLAN_LOOKAHEAD = 4; ///< Number of tiles a train is looked ahead for the junction it will search its next path at.
+static const uint MAX_RAIL_PATH_PLANS = 256;    ///< Maximum number of rail paths kept searched ahead of time.
+
+/** Everything about a train a search for its path depends on, besides the map and the settings. */
+struct RailPathPlanKey {
+	const Train *train;             ///< The train.
+	TileIndex origin_tile;          ///< Tile the path is searched from, i.e. the end of the reservation.
+	Trackdir origin_td;             ///< Trackdir the path is searched from.
+	uint32 order;                   ///< Packed current order of the train.
+	TileIndex dest_tile;            ///< Destination tile of the train.
+	TileIndex station_tile;         ///< Tile of the destination station closest to the train, if any.
+	int max_speed;                  ///< Maximum speed of the train, including the limit of its order.
+	uint16 total_length;            ///< Length of the train.
+	RailTypes compatible_railtypes; ///< Rail types the train can run on.
+	RailType railtype;              ///< Rail type of the train.
+	Owner owner;                    ///< Owner of the train.
+
+	RailPathPlanKey(const Train *v, const PBSTileInfo &origin) :
+		train(v), origin_tile(origin.tile), origin_td(origin.trackdir), order(v->current_order.Pack()), dest_tile(v->dest_tile), station_tile(INVALID_TILE),
+		max_speed(std::min<int>(v->GetDisplayMaxSpeed(), v->current_order.GetMaxSpeed())), total_length(v->gcache.cached_total_length),
+		compatible_railtypes(v->compatible_railtypes), railtype(v->railtype), owner(v->owner)
+	{
+		if (v->current_order.IsType(OT_GOTO_STATION) || v->current_order.IsType(OT_GOTO_WAYPOINT)) {
+			this->station_tile = CalcClosestStationTile(v->current_order.GetDestination(), v->tile, v->current_order.IsType(OT_GOTO_STATION) ? STATION_RAIL : STATION_WAYPOINT);
+		}
+	}
+
+	bool operator ==(const RailPathPlanKey &other) const
+	{
+		return this->train == other.train && this->origin_tile == other.origin_tile && this->origin_td == other.origin_td &&
+				this->order == other.order && this->dest_tile == other.dest_tile && this->station_tile == other.station_tile &&
+				this->max_speed == other.max_speed && this->total_length == other.total_length &&
+				this->compatible_railtypes == other.compatible_railtypes && this->railtype == other.railtype && this->owner == other.owner;
+	}
+};
+
+/** Copy of the contents of a tile, to detect changes to it. */
+struct RailPathPlanTile {
+	TileIndex tile; ///< The tile.
+	byte type;      ///< Copy of Tile::type().
+	byte height;    ///< Copy of Tile::height().
+	byte m1;        ///< Copy of Tile::m1().
+	byte m3;        ///< Copy of Tile::m3().
+	byte m4;        ///< Copy of Tile::m4().
+	byte m5;        ///< Copy of Tile::m5().
+	byte m6;        ///< Copy of Tile::m6().
+	byte m7;        ///< Copy of Tile::m7().
+	uint16 m2;      ///< Copy of Tile::m2().
+	uint16 m8;      ///< Copy of Tile::m8().
+	Slope slope;    ///< Slope of the tile, which depends on the heights of the tiles south of it as well.
+
+	RailPathPlanTile(TileIndex index) : tile(index)
+	{
+		Tile t(index);
+		this->type = t.type();
+		this->height = t.height();
+		this->slope = GetTileSlope(index);
+		this->m1 = t.m1();
+		this->m3 = t.m3();
+		this->m4 = t.m4();
+		this->m5 = t.m5();
+		this->m6 = t.m6();
+		this->m7 = t.m7();
+		this->m2 = t.m2();
+		this->m8 = t.m8();
+	}
+
+	/** Check whether the tile still has the copied contents. */
+	bool IsUnchanged() const
+	{
+		Tile t(this->tile);
+		return t.type() == this->type && t.height() == this->height && t.m1() == this->m1 && t.m2() == this->m2 &&
+				t.m3() == this->m3 && t.m4() == this->m4 && t.m5() == this->m5 && t.m6() == this->m6 &&
+				t.m7() == this->m7 && t.m8() == this->m8 && GetTileSlope(this->tile) == this->slope;
+	}
+};
+
+/**
+ * A path of a train that has been searched ahead of time on a task thread.
+ * It keeps the pathfinder with all its nodes, so the path can be used and
+ * reserved once the train asks for it. That is only done when nothing the
+ * search depends on has changed in the meantime, so the result is exactly
+ * what a search at that moment would give.
+ */
+struct RailPathPlan {
+	RailPathPlanKey key;                 ///< The train and its state at the time of the search.
+	int rail_changes;                    ///< Counter of unknown track layout changes at the time of the search.
+	PathfinderSettings settings;         ///< Pathfinder settings at the time of the search.
+	std::vector<RailPathPlanTile> tiles; ///< Contents of all tiles the search read.
+	bool path_found;                     ///< Whether the search found a path.
+	bool indexed;                        ///< Whether the tiles are in #_rail_path_plan_index.
+	bool outdated;                       ///< Whether a change to one of the tiles has been notified.
+	std::unique_ptr<CYapfRailPlan1> pf1; ///< The pathfinder, if 90 degree turns are allowed.
+	std::unique_ptr<CYapfRailPlan2> pf2; ///< The pathfinder, if 90 degree turns are forbidden.
+
+	RailPathPlan(const RailPathPlanKey &key) : key(key), rail_changes(CSegmentCostCacheBase::s_rail_change_counter), path_found(false), indexed(false), outdated(false)
+	{
+		memcpy(&this->settings, &_settings_game.pf, sizeof(this->settings));
+	}
+
+	~RailPathPlan();
+
+	/**
+	 * Check whether the plan is worth keeping. This does not look at the
+	 * tiles themselves, only at the changes that have been notified.
+	 * @param key The current state of the train.
+	 * @return True iff the plan is expected to be usable.
+	 */
+	bool IsCurrent(const RailPathPlanKey &key) const
+	{
+		if (!(key == this->key) || this->outdated) return false;
+		if (this->rail_changes != CSegmentCostCacheBase::s_rail_change_counter) return false;
+		return memcmp(&this->settings, &_settings_game.pf, sizeof(this->settings)) == 0;
+	}
+
+	/**
+	 * Check whether the search would still give the same result. Not every
+	 * change to the map is notified, e.g. signals switching or reservations
+	 * of moving trains, so this compares all tiles the search read.
+	 * @param key The current state of the train.
+	 * @return True iff the plan can be used.
+	 */
+	bool IsValid(const RailPathPlanKey &key) const
+	{
+		if (!this->IsCurrent(key)) return false;
+		for (const RailPathPlanTile &tile : this->tiles) {
+			if (!tile.IsUnchanged()) return false;
+		}
+		return true;
+	}
+
+	/**
+	 * Search the path and remember all tiles the search read.
+	 * @param pf The pathfinder to use.
+	 */
+	template <class Tpf>
+	void Search(Tpf &pf)
+	{
+		const Train *v = this->key.train;
+		this->path_found = pf.FindRailPath(v, PBSTileInfo(this->key.origin_tile, this->key.origin_td, false));
 
-struct CYapfAnyDepotRail1 : CYapfT<CYapfRail_TypesT<CYapfAnyDepotRail1, CFollowTrackRail    , CRailNodeListTrackDir, CYapfDestinationAnyDepotRailT     , CYapfFollowAnyDepotRailT> > {};
-struct CYapfAnyDepotRail2 : CYapfT<CYapfRail_TypesT<CYapfAnyDepotRail2, CFollowTrackRailNo90, CRailNodeListTrackDir, CYapfDestinationAnyDepotRailT     , CYapfFollowAnyDepotRailT> > {};
+		/* The recorded tiles include the skipped platform, tunnel and bridge tiles, and the tiles the segments tried to continue into. */
+		std::vector<TileIndex> tiles = pf.GetRecordedTiles();
+		/* The track of the destination tile is read when the train heads for a depot or a single tile. */
+		if (IsValidTile(v->dest_tile)) tiles.push_back(v->dest_tile);
 
-struct CYapfAnySafeTileRail1 : CYapfT<CYapfRail_TypesT<CYapfAnySafeTileRail1, CFollowTrackFreeRail    , CRailNodeListTrackDir, CYapfDestinationAnySafeTileRailT , CYapfFollowAnySafeTileRailT> > {};
-struct CYapfAnySafeTileRail2 : CYapfT<CYapfRail_TypesT<CYapfAnySafeTileRail2, CFollowTrackFreeRailNo90, CRailNodeListTrackDir, CYapfDestinationAnySafeTileRailT , CYapfFollowAnySafeTileRailT> > {};
+		std::sort(tiles.begin(), tiles.end());
+		tiles.erase(std::unique(tiles.begin(), tiles.end()), tiles.end());
+		this->tiles.assign(tiles.begin(), tiles.end());
+	}
 
+	/**
+	 * Use the searched path as #CYapfFollowRailT::ChooseRailTrack would.
+	 * @see CYapfFollowRailT::UseRailPath
+	 */
+	Trackdir Use(bool &path_found, bool reserve_track, PBSTileInfo *target, TileIndex *dest)
+	{
+		path_found = this->path_found;
+		if (this->pf1 != nullptr) return this->pf1->UseRailPath(path_found, reserve_track, target, dest);
+		return this->pf2->UseRailPath(path_found, reserve_track, target, dest);
+	}
+};
 
-Track YapfTrainChooseTrack(const Train *v, TileIndex tile, DiagDirection enterdir, TrackBits tracks, bool &path_found, bool reserve_track, PBSTileInfo *target, TileIndex *dest)
+/**
+ * Index of the tiles the paths searched ahead of time read. It gets the same
+ * notifications as the segment cost caches, so a change to a tile only marks
+ * the plans that read it as outdated, instead of checking all plans.
+ */
+struct RailPathPlanIndex : CSegmentCostCacheBase {
+	std::unordered_map<uint32, std::vector<RailPathPlan *>> plans; ///< The plans that read each tile.
+
+	RailPathPlanIndex()
+	{
+		GetCaches().push_back(this);
+	}
+
+	~RailPathPlanIndex()
+	{
+		CacheList &caches = GetCaches();
+		caches.erase(std::find(caches.begin(), caches.end(), this));
+	}
+
+	void InvalidateTile(TileIndex tile) override
+	{
+		auto it = this->plans.find(static_cast<uint32>(tile));
+		if (it == this->plans.end()) return;
+
+		for (RailPathPlan *plan : it->second) plan->outdated = true;
+		this->plans.erase(it);
+	}
+
+	/**
+	 * Add the tiles of a plan to the index.
+	 * @param plan The plan after its search.
+	 */
+	void Add(RailPathPlan *plan)
+	{
+		for (const RailPathPlanTile &tile : plan->tiles) this->plans[static_cast<uint32>(tile.tile)].push_back(plan);
+		plan->indexed = true;
+	}
+
+	/**
+	 * Remove the tiles of a plan from the index.
+	 * @param plan The plan that is going to be destroyed.
+	 */
+	void Remove(RailPathPlan *plan)
+	{
+		for (const RailPathPlanTile &tile : plan->tiles) {
+			auto it = this->plans.find(static_cast<uint32>(tile.tile));
+			if (it == this->plans.end()) continue;
+			std::vector<RailPathPlan *> &plans = it->second;
+			plans.erase(std::remove(plans.begin(), plans.end(), plan), plans.end());
+			if (plans.empty()) this->plans.erase(it);
+		}
+		plan->indexed = false;
+	}
+};
+
+/** Index of the tiles of all plans; declared before the plans, so it outlives them. */
+static RailPathPlanIndex _rail_path_plan_index;
+
+/** Paths searched ahead of time, by vehicle index of the train. */
+static std::map<VehicleID, std::unique_ptr<RailPathPlan>> _rail_path_plans;
+
+RailPathPlan::~RailPathPlan()
 {
-	/* default is YAPF type 2 */
-	typedef Trackdir (*PfnChooseRailTrack)(const Train*, TileIndex, DiagDirection, TrackBits, bool&, bool, PBSTileInfo*, TileIndex*);
-	PfnChooseRailTrack pfnChooseRailTrack = &CYapfRail1::stChooseRailTrack;
+	if (this->indexed) _rail_path_plan_index.Remove(this);
+}
 
-	/* check if non-default YAPF type needed */
-	if (_settings_game.pf.forbid_90_deg) {
-		pfnChooseRailTrack = &CYapfRail2::stChooseRailTrack; // Trackdir, forbid 90-deg
+/**
+ * Predict where a train will search its next path from. That is the end of its
+ * reservation when that is close by, or when it has no reservation ahead, the
+ * last tile before the junction it is approaching.
+ * @param v The train.
+ * @param[out] origin The predicted origin of the search.
+ * @return True iff the train is expected to search a path soon.
+ */
+static bool PredictRailPathOrigin(const Train *v, PBSTileInfo *origin)
+{
+	/* Complex waypoints make the search look at tiles beyond its segments. */
+	if (v->current_order.IsType(OT_GOTO_WAYPOINT) && !Waypoint::Get(v->current_order.GetDestination())->IsSingleTile()) return false;
+
+	*origin = FollowTrainReservation(v);
+	if (origin->tile != v->tile) return DistanceManhattan(origin->tile, v->tile) <= RAIL_PATH_PLAN_LOOKAHEAD;
+
+	CFollowTrackRail ft(v);
+	TileIndex tile = origin->tile;
+	Trackdir td = origin->trackdir;
+	for (uint i = 0; i < RAIL_PATH_PLAN_LOOKAHEAD; i++) {
+		if (!ft.Follow(tile, td)) return false;
+		if (KillFirstBit(ft.m_new_td_bits) != TRACKDIR_BIT_NONE) {
+			/* The train will choose its track when entering the junction. */
+			origin->tile = tile;
+			origin->trackdir = td;
+			return true;
+		}
+		tile = ft.m_new_tile;
+		td = FindFirstTrackdir(ft.m_new_td_bits);
 	}
+	return false;
+}
 
-	Trackdir td_ret = pfnChooseRailTrack(v, tile, enterdir, tracks, path_found, reserve_track, target, dest);
+void YapfTrainPlanPaths()
+{
+	/** What to do with the plan of a train. */
+	enum PlanAction : byte {
+		PA_DROP,   ///< The train is not expected to search a path soon.
+		PA_KEEP,   ///< The current plan is still good.
+		PA_SEARCH, ///< Search a new plan.
+	};
+
+	static std::vector<const Train *> trains;
+	static std::vector<PBSTileInfo> origins;
+	static std::vector<PlanAction> actions;
+	static std::vector<RailPathPlan *> searches;
+
+	trains.clear();
+	for (const Train *v : Train::Iterate()) {
+		if (!v->IsFrontEngine() || (v->vehstatus & (VS_CRASHED | VS_STOPPED)) != 0 || v->cur_speed == 0 || v->track == TRACK_BIT_DEPOT) continue;
+		trains.push_back(v);
+	}
+	origins.resize(trains.size());
+	actions.resize(trains.size());
+
+	/* Find where the trains will search, and whether that has been searched already. */
+	RunTasks(trains.size(), 64, [](size_t first, size_t last) {
+		for (size_t i = first; i < last; i++) {
+			const Train *v = trains[i];
+			if (!PredictRailPathOrigin(v, &origins[i])) {
+				actions[i] = PA_DROP;
+				continue;
+			}
+			auto it = _rail_path_plans.find(v->index);
+			actions[i] = (it != _rail_path_plans.end() && it->second->IsCurrent(RailPathPlanKey(v, origins[i]))) ? PA_KEEP : PA_SEARCH;
+		}
+	});
+
+	std::map<VehicleID, std::unique_ptr<RailPathPlan>> plans;
+	for (size_t i = 0; i < trains.size(); i++) {
+		if (actions[i] == PA_KEEP) plans[trains[i]->index] = std::move(_rail_path_plans[trains[i]->index]);
+	}
+	searches.clear();
+	for (size_t i = 0; i < trains.size() && plans.size() < MAX_RAIL_PATH_PLANS; i++) {
+		if (actions[i] != PA_SEARCH) continue;
+		std::unique_ptr<RailPathPlan> &plan = plans[trains[i]->index];
+		plan.reset(new RailPathPlan(RailPathPlanKey(trains[i], origins[i])));
+		searches.push_back(plan.get());
+	}
+	_rail_path_plans.swap(plans);
+
+	RunTasks(searches.size(), 1, [](size_t first, size_t last) {
+		for (size_t i = first; i < last; i++) {
+			RailPathPlan *plan = searches[i];
+			if (plan->settings.forbid_90_deg) {
+				plan->pf2.reset(new CYapfRailPlan2());
+				plan->Search(*plan->pf2);
+			} else {
+				plan->pf1.reset(new CYapfRailPlan1());
+				plan->Search(*plan->pf1);
+			}
+		}
+	});
+
+	/* Later changes to the tiles mark the plans as outdated. */
+	for (RailPathPlan *plan : searches) _rail_path_plan_index.Add(plan);
+}
+
+void YapfTrainDropPlannedPaths()
+{
+	_rail_path_plans.clear();
+}
+
+/**
+ * Use the path searched ahead of time for a train, if it is still valid.
+ * @see YapfTrainChooseTrack
+ * @return True iff a planned path was used.
+ */
+static bool UsePlannedRailPath(const Train *v, bool &path_found, bool reserve_track, PBSTileInfo *target, TileIndex *dest, Trackdir *trackdir)
+{
+	auto it = _rail_path_plans.find(v->index);
+	if (it == _rail_path_plans.end()) return false;
+
+	/* A plan is only used once. */
+	std::unique_ptr<RailPathPlan> plan = std::move(it->second);
+	_rail_path_plans.erase(it);
+
+	if (!plan->IsValid(RailPathPlanKey(v, FollowTrainReservation(v)))) return false;
+
+	if (_debug_desync_level > 1) {
+		bool serial_path_found;
+		Trackdir serial = _settings_game.pf.forbid_90_deg ?
+				CYapfRail2::stChooseRailTrack(v, INVALID_TILE, INVALID_DIAGDIR, TRACK_BIT_NONE, serial_path_found, false, nullptr, nullptr) :
+				CYapfRail1::stChooseRailTrack(v, INVALID_TILE, INVALID_DIAGDIR, TRACK_BIT_NONE, serial_path_found, false, nullptr, nullptr);
+		*trackdir = plan->Use(path_found, reserve_track, target, dest);
+		if (*trackdir != serial || path_found != serial_path_found) {
+			Debug(desync, 2, "planned rail path mismatch: train {}, planned [{}, {}], serial [{}, {}]", v->index, *trackdir, path_found, serial, serial_path_found);
+		}
+		return true;
+	}
+
+	*trackdir = plan->Use(path_found, reserve_track, target, dest);
+	return true;
+}
+
+Track YapfTrainChooseTrack(const Train *v, TileIndex tile, DiagDirection enterdir, TrackBits tracks, bool &path_found, bool reserve_track, PBSTileInfo *target, TileIndex *dest)
+{
+	Debug(pfquery, 1, "{}", FormatYapfQuery({ YQT_TRAIN, v->index, tile, enterdir, (uint16)tracks }));
+
+	Trackdir td_ret;
+	if (_rail_path_plans.empty() || !UsePlannedRailPath(v, path_found, reserve_track, target, dest, &td_ret)) {
+		/* default is YAPF type 2 */
+		typedef Trackdir (*PfnChooseRailTrack)(const Train*, TileIndex, DiagDirection, TrackBits, bool&, bool, PBSTileInfo*, TileIndex*);
+		PfnChooseRailTrack pfnChooseRailTrack = &CYapfRail1::stChooseRailTrack;
+
+		/* check if non-default YAPF type needed */
+		if (_settings_game.pf.forbid_90_deg) {
+			pfnChooseRailTrack = &CYapfRail2::stChooseRailTrack; // Trackdir, forbid 90-deg
+		}
+
+		td_ret = pfnChooseRailTrack(v, tile, enterdir, tracks, path_found, reserve_track, target, dest);
+	}
 	return (td_ret != INVALID_TRACKDIR) ? TrackdirToTrack(td_ret) : FindFirstTrack(tracks);
 }
 
@@ -638,10 +1057,23 @@ bool YapfTrainFindNearestSafeTile(const Train *v, TileIndex tile, Trackdir td, b
 	return pfnFindNearestSafeTile(v, tile, td, override_railtype);
 }
 
-/** if any track changes, this counter is incremented - that will invalidate segment cost cache */
+/** if the track layout changes in an unknown way, this counter is incremented - that will flush the segment cost caches */
 int CSegmentCostCacheBase::s_rail_change_counter = 0;
+uint64 CSegmentCostCacheBase::s_cache_hits = 0;
+uint64 CSegmentCostCacheBase::s_cache_misses = 0;
 
 void YapfNotifyTrackLayoutChange(TileIndex tile, Track track)
 {
 	CSegmentCostCacheBase::NotifyTrackLayoutChange(tile, track);
+
+	/* Segments through a tunnel or over a bridge continue at its other end. */
+	if (tile != INVALID_TILE && IsTileType(tile, MP_TUNNELBRIDGE)) {
+		CSegmentCostCacheBase::NotifyTrackLayoutChange(GetOtherTunnelBridgeEnd(tile), track);
+	}
+}
+
+void YapfGetSegmentCacheStats(uint64 *hits, uint64 *misses)
+{
+	*hits = CSegmentCostCacheBase::s_cache_hits;
+	*misses = CSegmentCostCacheBase::s_cache_misses;
 }
@@ -12,8 +12,167 @@
 #include "yapf_node_road.hpp"
 #include "../../roadstop_base.h"
 
+#include <map>
+#include <tuple>
+
 #include "../../safeguards.h"
 
+/**
+ * Check whether the road goes uphill between the centres of two tiles.
+ * @param tile      Tile the vehicle leaves.
+ * @param next_tile Tile the vehicle enters.
+ * @return True if the road goes uphill.
+ */
+static bool IsRoadSlopeUp(TileIndex tile, TileIndex next_tile)
+{
+	/* height of the center of the current tile */
+	int x1 = TileX(tile) * TILE_SIZE;
+	int y1 = TileY(tile) * TILE_SIZE;
+	int z1 = GetSlopePixelZ(x1 + TILE_SIZE / 2, y1 + TILE_SIZE / 2, true);
+
+	/* height of the center of the next tile */
+	int x2 = TileX(next_tile) * TILE_SIZE;
+	int y2 = TileY(next_tile) * TILE_SIZE;
+	int z2 = GetSlopePixelZ(x2 + TILE_SIZE / 2, y2 + TILE_SIZE / 2, true);
+
+	return z2 - z1 > 1;
+}
+
+/**
+ * Follow the road from the start of a segment up to the next junction, dead end or depot
+ * and store everything about the tiles on the way that only changes when the road does.
+ * What depends on the vehicle or on the occupancy of road stops is left to the cost calculation.
+ * @param v       The vehicle the road is followed for.
+ * @param segment The segment to fill.
+ */
+static void FollowRoadSegment(const RoadVehicle *v, CYapfRoadSegment &segment)
+{
+	TileIndex tile = segment.m_key.m_tile;
+	Trackdir trackdir = segment.m_key.m_td;
+	uint tiles = 0;
+
+	segment.m_steps.clear();
+	segment.m_loop = false;
+
+	for (;;) {
+		segment.m_steps.push_back({tile, trackdir, 0, 0, 0, INT_MAX});
+		CYapfRoadSegment::Step &step = segment.m_steps.back();
+		if (IsDiagonalTrackdir(trackdir)) {
+			if (IsLevelCrossingTile(tile)) SetBit(step.flags, CYapfRoadSegment::RSSF_LEVEL_CROSSING);
+			if (IsTileType(tile, MP_STATION)) SetBit(step.flags, CYapfRoadSegment::RSSF_ROAD_STOP);
+		}
+
+		/* stop if we have just entered the depot */
+		if (IsRoadDepotTile(tile) && trackdir == DiagDirToDiagTrackdir(ReverseDiagDir(GetRoadDepotDirection(tile)))) {
+			/* next time we will reverse and leave the depot */
+			break;
+		}
+
+		/* if there are no reachable trackdirs on new tile, we have end of road */
+		CFollowTrackRoad F(v);
+		if (!F.Follow(tile, trackdir)) break;
+
+		/* if there are more trackdirs available & reachable, we are at the end of segment */
+		if (KillFirstBit(F.m_new_td_bits) != TRACKDIR_BIT_NONE) break;
+
+		Trackdir new_td = (Trackdir)FindFirstBit2x64(F.m_new_td_bits);
+
+		/* stop if RV is on simple loop with no junctions */
+		if (F.m_new_tile == segment.m_key.m_tile && new_td == segment.m_key.m_td) {
+			segment.m_loop = true;
+			break;
+		}
+
+		SetBit(step.flags, CYapfRoadSegment::RSSF_FOLLOWED);
+		step.tiles_skipped = F.m_tiles_skipped;
+		if (IsRoadSlopeUp(tile, F.m_new_tile)) SetBit(step.flags, CYapfRoadSegment::RSSF_SLOPE_UP);
+		step.max_speed = F.GetSpeedLimit(&step.min_speed);
+		tiles += F.m_tiles_skipped + 1;
+
+		/* move to the next tile */
+		tile = F.m_new_tile;
+		trackdir = new_td;
+		if (tiles > MAX_MAP_SIZE) break;
+	}
+
+	segment.m_last_tile = tile;
+	segment.m_last_td = trackdir;
+}
+
+static CSegmentCostCacheT<CYapfRoadSegment> _road_segment_cache; ///< Road segments followed by any of the road pathfinders.
+static int _road_segment_cache_counter = 0; ///< Layout change counter at the last flush of the road segment cache.
+
+/**
+ * CYapfSegmentCostCacheRoadT - the yapf cost cache provider of road YAPF. Every road segment
+ *  is followed only once and then kept until a road on (or next to) one of its tiles changes.
+ */
+template <class Types>
+class CYapfSegmentCostCacheRoadT
+{
+public:
+	typedef typename Types::Tpf Tpf;              ///< the pathfinder class (derived from THIS class)
+	typedef typename Types::NodeList::Titem Node; ///< this will be our node type
+	typedef typename Node::CachedData CachedData;
+	typedef typename CachedData::Key CacheKey;
+	typedef CSegmentCostCacheT<CachedData> Cache;
+
+protected:
+	Cache &m_global_cache;
+
+	inline CYapfSegmentCostCacheRoadT() : m_global_cache(stGetGlobalCache()) {};
+
+	/** to access inherited path finder */
+	inline Tpf& Yapf()
+	{
+		return *static_cast<Tpf *>(this);
+	}
+
+	inline static Cache& stGetGlobalCache()
+	{
+		/* delete the cache sometimes... */
+		if (_road_segment_cache_counter != Cache::s_rail_change_counter || _road_segment_cache.NeedsCompaction()) {
+			_road_segment_cache_counter = Cache::s_rail_change_counter;
+			_road_segment_cache.Flush();
+		}
+		return _road_segment_cache;
+	}
+
+public:
+	/**
+	 * Called by YAPF to attach cached segment data to the given node.
+	 *  @return true if the segment was already cached
+	 */
+	inline bool PfNodeCacheFetch(Node &n)
+	{
+		/* Origin nodes don't have a segment cost. */
+		if (n.m_parent == nullptr) return false;
+
+		CacheKey key(n.m_key, Yapf().GetVehicle());
+		bool found;
+		CachedData &item = m_global_cache.Get(key, &found);
+		n.m_segment = &item;
+		if (found) {
+			Cache::s_cache_hits++;
+			return true;
+		}
+
+		Cache::s_cache_misses++;
+		FollowRoadSegment(Yapf().GetVehicle(), item);
+		/* Remember the tiles of the segment, so changing one of them only invalidates this segment. */
+		for (const typename CachedData::Step &step : item.m_steps) m_global_cache.AddTile(item, step.tile);
+		m_global_cache.AddTile(item, item.m_last_tile);
+		return false;
+	}
+
+	/**
+	 * Called by YAPF to flush the cached segment cost data back into cache storage.
+	 *  Current cache implementation doesn't use that.
+	 */
+	inline void PfNodeCacheFlush(Node &n)
+	{
+	}
+};
+
 
 template <class Types>
 class CYapfCostRoadT
@@ -35,61 +194,36 @@ protected:
 		return *static_cast<Tpf *>(this);
 	}
 
-	int SlopeCost(TileIndex tile, TileIndex next_tile, Trackdir trackdir)
-	{
-		/* height of the center of the current tile */
-		int x1 = TileX(tile) * TILE_SIZE;
-		int y1 = TileY(tile) * TILE_SIZE;
-		int z1 = GetSlopePixelZ(x1 + TILE_SIZE / 2, y1 + TILE_SIZE / 2, true);
-
-		/* height of the center of the next tile */
-		int x2 = TileX(next_tile) * TILE_SIZE;
-		int y2 = TileY(next_tile) * TILE_SIZE;
-		int z2 = GetSlopePixelZ(x2 + TILE_SIZE / 2, y2 + TILE_SIZE / 2, true);
-
-		if (z2 - z1 > 1) {
-			/* Slope up */
-			return Yapf().PfGetSettings().road_slope_penalty;
-		}
-		return 0;
-	}
-
 	/** return one tile cost */
-	inline int OneTileCost(TileIndex tile, Trackdir trackdir)
+	inline int OneTileCost(const CYapfRoadSegment::Step &step)
 	{
+		TileIndex tile = step.tile;
+		Trackdir trackdir = step.td;
 		int cost = 0;
 		/* set base cost */
 		if (IsDiagonalTrackdir(trackdir)) {
 			cost += YAPF_TILE_LENGTH;
-			switch (GetTileType(tile)) {
-				case MP_ROAD:
-					/* Increase the cost for level crossings */
-					if (IsLevelCrossing(tile)) {
-						cost += Yapf().PfGetSettings().road_crossing_penalty;
-					}
-					break;
-
-				case MP_STATION: {
-					const RoadStop *rs = RoadStop::GetByTile(tile, GetRoadStopType(tile));
-					if (IsDriveThroughStopTile(tile)) {
-						/* Increase the cost for drive-through road stops */
-						cost += Yapf().PfGetSettings().road_stop_penalty;
-						DiagDirection dir = TrackdirToExitdir(trackdir);
-						if (!RoadStop::IsDriveThroughRoadStopContinuation(tile, tile - TileOffsByDiagDir(dir))) {
-							/* When we're the first road stop in a 'queue' of them we increase
-							 * cost based on the fill percentage of the whole queue. */
-							const RoadStop::Entry *entry = rs->GetEntry(dir);
-							cost += entry->GetOccupied() * Yapf().PfGetSettings().road_stop_occupied_penalty / entry->GetLength();
-						}
-					} else {
-						/* Increase cost for filled road stops */
-						cost += Yapf().PfGetSettings().road_stop_bay_occupied_penalty * (!rs->IsFreeBay(0) + !rs->IsFreeBay(1)) / 2;
+			/* Increase the cost for level crossings */
+			if (HasBit(step.flags, CYapfRoadSegment::RSSF_LEVEL_CROSSING)) {
+				cost += Yapf().PfGetSettings().road_crossing_penalty;
+			}
+
+			if (HasBit(step.flags, CYapfRoadSegment::RSSF_ROAD_STOP)) {
+				const RoadStop *rs = RoadStop::GetByTile(tile, GetRoadStopType(tile));
+				if (IsDriveThroughStopTile(tile)) {
+					/* Increase the cost for drive-through road stops */
+					cost += Yapf().PfGetSettings().road_stop_penalty;
+					DiagDirection dir = TrackdirToExitdir(trackdir);
+					if (!RoadStop::IsDriveThroughRoadStopContinuation(tile, tile - TileOffsByDiagDir(dir))) {
+						/* When we're the first road stop in a 'queue' of them we increase
+						 * cost based on the fill percentage of the whole queue. */
+						const RoadStop::Entry *entry = rs->GetEntry(dir);
+						cost += entry->GetOccupied() * Yapf().PfGetSettings().road_stop_occupied_penalty / entry->GetLength();
 					}
-					break;
+				} else {
+					/* Increase cost for filled road stops */
+					cost += Yapf().PfGetSettings().road_stop_bay_occupied_penalty * (!rs->IsFreeBay(0) + !rs->IsFreeBay(1)) / 2;
 				}
-
-				default:
-					break;
 			}
 		} else {
 			/* non-diagonal trackdir */
@@ -111,20 +245,29 @@ public:
 	 */
 	inline bool PfCalcCost(Node &n, const TrackFollower *tf)
 	{
+		const CYapfRoadSegment &segment = *n.m_segment;
 		int segment_cost = 0;
-		uint tiles = 0;
-		/* start at n.m_key.m_tile / n.m_key.m_td and walk to the end of segment */
-		TileIndex tile = n.m_key.m_tile;
-		Trackdir trackdir = n.m_key.m_td;
 		int parent_cost = (n.m_parent != nullptr) ? n.m_parent->m_cost : 0;
 
-		for (;;) {
+		const RoadVehicle *v = Yapf().GetVehicle();
+		int max_veh_speed = std::min<int>(v->GetDisplayMaxSpeed(), v->current_order.GetMaxSpeed() * 2);
+
+		/* walk the cached tiles of the segment; only the occupancy of road stops,
+		 * the destination and the vehicle's speed need to be looked at per tile */
+		TileIndex tile = segment.m_last_tile;
+		Trackdir trackdir = segment.m_last_td;
+		bool destination_found = false;
+		for (const CYapfRoadSegment::Step &step : segment.m_steps) {
 			/* base tile cost depending on distance between edges */
-			segment_cost += Yapf().OneTileCost(tile, trackdir);
+			segment_cost += Yapf().OneTileCost(step);
 
-			const RoadVehicle *v = Yapf().GetVehicle();
 			/* we have reached the vehicle's destination - segment should end here to avoid target skipping */
-			if (Yapf().PfDetectDestinationTile(tile, trackdir)) break;
+			if (Yapf().PfDetectDestinationTile(step.tile, step.td)) {
+				tile = step.tile;
+				trackdir = step.td;
+				destination_found = true;
+				break;
+			}
 
 			/* Finish if we already exceeded the maximum path cost (i.e. when
 			 * searching for the nearest depot). */
@@ -132,44 +275,23 @@ public:
 				return false;
 			}
 
-			/* stop if we have just entered the depot */
-			if (IsRoadDepotTile(tile) && trackdir == DiagDirToDiagTrackdir(ReverseDiagDir(GetRoadDepotDirection(tile)))) {
-				/* next time we will reverse and leave the depot */
-				break;
-			}
-
-			/* if there are no reachable trackdirs on new tile, we have end of road */
-			TrackFollower F(Yapf().GetVehicle());
-			if (!F.Follow(tile, trackdir)) break;
-
-			/* if there are more trackdirs available & reachable, we are at the end of segment */
-			if (KillFirstBit(F.m_new_td_bits) != TRACKDIR_BIT_NONE) break;
-
-			Trackdir new_td = (Trackdir)FindFirstBit2x64(F.m_new_td_bits);
-
-			/* stop if RV is on simple loop with no junctions */
-			if (F.m_new_tile == n.m_key.m_tile && new_td == n.m_key.m_td) return false;
+			/* end of road, junction or depot */
+			if (!HasBit(step.flags, CYapfRoadSegment::RSSF_FOLLOWED)) break;
 
 			/* if we skipped some tunnel tiles, add their cost */
-			segment_cost += F.m_tiles_skipped * YAPF_TILE_LENGTH;
-			tiles += F.m_tiles_skipped + 1;
+			segment_cost += step.tiles_skipped * YAPF_TILE_LENGTH;
 
 			/* add hilly terrain penalty */
-			segment_cost += Yapf().SlopeCost(tile, F.m_new_tile, trackdir);
+			if (HasBit(step.flags, CYapfRoadSegment::RSSF_SLOPE_UP)) segment_cost += Yapf().PfGetSettings().road_slope_penalty;
 
 			/* add min/max speed penalties */
-			int min_speed = 0;
-			int max_veh_speed = std::min<int>(v->GetDisplayMaxSpeed(), v->current_order.GetMaxSpeed() * 2);
-			int max_speed = F.GetSpeedLimit(&min_speed);
-			if (max_speed < max_veh_speed) segment_cost += YAPF_TILE_LENGTH * (max_veh_speed - max_speed) * (4 + F.m_tiles_skipped) / max_veh_speed;
-			if (min_speed > max_veh_speed) segment_cost += YAPF_TILE_LENGTH * (min_speed - max_veh_speed);
-
-			/* move to the next tile */
-			tile = F.m_new_tile;
-			trackdir = new_td;
-			if (tiles > MAX_MAP_SIZE) break;
+			if (step.max_speed < max_veh_speed) segment_cost += YAPF_TILE_LENGTH * (max_veh_speed - step.max_speed) * (4 + step.tiles_skipped) / max_veh_speed;
+			if (step.min_speed > max_veh_speed) segment_cost += YAPF_TILE_LENGTH * (step.min_speed - max_veh_speed);
 		}
 
+		/* stop if RV is on simple loop with no junctions */
+		if (!destination_found && segment.m_loop) return false;
+
 		/* save end of segment back to the node */
 		n.m_segment_last_tile = tile;
 		n.m_segment_last_td = trackdir;
@@ -518,19 +640,21 @@ struct CYapfRoad_TypesT
 	typedef CYapfFollowRoadT<Types>           PfFollow;
 	typedef CYapfOriginTileT<Types>           PfOrigin;
 	typedef Tdestination<Types>               PfDestination;
-	typedef CYapfSegmentCostCacheNoneT<Types> PfCache;
+	typedef CYapfSegmentCostCacheRoadT<Types> PfCache;
 	typedef CYapfCostRoadT<Types>             PfCost;
 };
 
-struct CYapfRoad1         : CYapfT<CYapfRoad_TypesT<CYapfRoad1        , CRoadNodeListTrackDir, CYapfDestinationTileRoadT    > > {};
-struct CYapfRoad2         : CYapfT<CYapfRoad_TypesT<CYapfRoad2        , CRoadNodeListExitDir , CYapfDestinationTileRoadT    > > {};
+struct CYapfRoad1         : CYapfT<CYapfRoad_TypesT<CYapfRoad1        , CRoadNodeListTrackDirHeap, CYapfDestinationTileRoadT    > > {};
+struct CYapfRoad2         : CYapfT<CYapfRoad_TypesT<CYapfRoad2        , CRoadNodeListExitDirHeap , CYapfDestinationTileRoadT    > > {};
 
-struct CYapfRoadAnyDepot1 : CYapfT<CYapfRoad_TypesT<CYapfRoadAnyDepot1, CRoadNodeListTrackDir, CYapfDestinationAnyDepotRoadT> > {};
-struct CYapfRoadAnyDepot2 : CYapfT<CYapfRoad_TypesT<CYapfRoadAnyDepot2, CRoadNodeListExitDir , CYapfDestinationAnyDepotRoadT> > {};
+struct CYapfRoadAnyDepot1 : CYapfT<CYapfRoad_TypesT<CYapfRoadAnyDepot1, CRoadNodeListTrackDirHeap, CYapfDestinationAnyDepotRoadT> > {};
+struct CYapfRoadAnyDepot2 : CYapfT<CYapfRoad_TypesT<CYapfRoadAnyDepot2, CRoadNodeListExitDirHeap , CYapfDestinationAnyDepotRoadT> > {};
 
 
 Trackdir YapfRoadVehicleChooseTrack(const RoadVehicle *v, TileIndex tile, DiagDirection enterdir, TrackdirBits trackdirs, bool &path_found, RoadVehPathCache &path_cache)
 {
+	Debug(pfquery, 1, "{}", FormatYapfQuery({ YQT_ROAD, v->index, tile, enterdir, (uint16)trackdirs }));
+
 	/* default is YAPF type 2 */
 	typedef Trackdir (*PfnChooseRoadTrack)(const RoadVehicle*, TileIndex, DiagDirection, bool &path_found, RoadVehPathCache &path_cache);
 	PfnChooseRoadTrack pfnChooseRoadTrack = &CYapfRoad2::stChooseRoadTrack; // default: ExitDir, allow 90-deg
@@ -564,3 +688,39 @@ FindDepotData YapfRoadVehicleFindNearestDepot(const RoadVehicle *v, int max_dist
 
 	return pfnFindNearestDepot(v, tile, trackdir, max_distance);
 }
+
+void YapfNotifyRoadLayoutChange(TileIndex tile)
+{
+	CSegmentCostCacheBase::NotifyTrackLayoutChange(tile, INVALID_TRACK);
+
+	/* Segments through a tunnel or over a bridge continue at its other end. */
+	if (tile != INVALID_TILE && IsTileType(tile, MP_TUNNELBRIDGE)) {
+		CSegmentCostCacheBase::NotifyTrackLayoutChange(GetOtherTunnelBridgeEnd(tile), INVALID_TRACK);
+	}
+}
+
+void YapfCheckRoadSegmentCache()
+{
+	/* A segment can only be followed again for a vehicle that drives on the same roads. */
+	std::map<std::tuple<RoadTramType, Owner, RoadTypes>, const RoadVehicle *> vehicles;
+	for (const RoadVehicle *v : RoadVehicle::Iterate()) {
+		if (v->IsFrontEngine()) vehicles.emplace(std::make_tuple(GetRoadTramType(v->roadtype), v->owner, v->compatible_roadtypes), v);
+	}
+
+	CSegmentCostCacheT<CYapfRoadSegment> &cache = _road_segment_cache;
+	for (uint i = 0; i < cache.m_heap.Length(); i++) {
+		const CYapfRoadSegment &segment = cache.m_heap[i];
+		const CYapfRoadSegmentKey &key = segment.GetKey();
+		/* Skip the segments that were invalidated already. */
+		if (cache.m_map.Find(key) != &segment) continue;
+
+		auto it = vehicles.find(std::make_tuple(key.m_rtt, key.m_owner, key.m_compatible_roadtypes));
+		if (it == vehicles.end()) continue;
+
+		CYapfRoadSegment check(key);
+		FollowRoadSegment(it->second, check);
+		if (check.m_steps != segment.m_steps || check.m_last_tile != segment.m_last_tile || check.m_last_td != segment.m_last_td || check.m_loop != segment.m_loop) {
+			Debug(desync, 2, "road segment cache mismatch: tile {}, trackdir {}", static_cast<uint32>(key.m_tile), (uint)key.m_td);
+		}
+	}
+}
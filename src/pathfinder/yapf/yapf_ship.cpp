@@ -11,12 +11,34 @@
 #include "../../ship.h"
 #include "../../industry.h"
 #include "../../vehicle_func.h"
+#include "../../station_base.h"
+#include "../water_regions.h"
 
 #include "yapf.hpp"
 #include "yapf_node_ship.hpp"
 
 #include "../../safeguards.h"
 
+/**
+ * Get the tiles a ship could end its journey on.
+ * @param v          The ship.
+ * @param[out] tiles The destination tiles.
+ */
+static void GetShipDestinationTiles(const Ship *v, std::vector<TileIndex> &tiles)
+{
+	if (!v->current_order.IsType(OT_GOTO_STATION)) {
+		if (IsValidTile(v->dest_tile)) tiles.push_back(v->dest_tile);
+		return;
+	}
+
+	StationID station = v->current_order.GetDestination();
+	const Station *st = Station::GetIfValid(station);
+	if (st == nullptr) return;
+	for (TileIndex tile : st->docking_station) {
+		if (IsDockingTile(tile) && IsShipDestinationTile(tile, station)) tiles.push_back(tile);
+	}
+}
+
 template <class Types>
 class CYapfDestinationTileWaterT
 {
@@ -31,7 +53,12 @@ protected:
 	TrackdirBits m_destTrackdirs;
 	StationID    m_destStation;
 
+	std::vector<WaterRegionPatchDesc> m_corridor; ///< patches of water the search is limited to, empty if not limited
+	bool         m_intermediate_dest;             ///< whether the last patch of the corridor is the destination instead of the real one
+
 public:
+	CYapfDestinationTileWaterT() : m_intermediate_dest(false) {}
+
 	void SetDestination(const Ship *v)
 	{
 		if (v->current_order.IsType(OT_GOTO_STATION)) {
@@ -45,6 +72,26 @@ public:
 		}
 	}
 
+	/**
+	 * Limit the search to the patches of water of a path found over the water regions.
+	 * When the path is long, only its first part is used and the search ends when
+	 * the last patch of that part is reached.
+	 * @param path Patches from the origin to the destination.
+	 */
+	void SetCorridor(const std::vector<WaterRegionPatchDesc> &path)
+	{
+		m_intermediate_dest = path.size() > YAPF_SHIP_CORRIDOR_REGIONS;
+		m_corridor.assign(path.begin(), path.begin() + std::min<size_t>(path.size(), YAPF_SHIP_CORRIDOR_REGIONS));
+	}
+
+	/** Check whether a tile is within the corridor the search is limited to. */
+	inline bool IsInCorridor(TileIndex tile) const
+	{
+		if (m_corridor.empty()) return true;
+		WaterRegionPatchDesc patch = GetWaterRegionPatchInfo(tile);
+		return std::find(m_corridor.begin(), m_corridor.end(), patch) != m_corridor.end();
+	}
+
 protected:
 	/** to access inherited path finder */
 	inline Tpf& Yapf()
@@ -61,6 +108,10 @@ public:
 
 	inline bool PfDetectDestinationTile(TileIndex tile, Trackdir trackdir)
 	{
+		if (m_intermediate_dest) {
+			return GetWaterRegionPatchInfo(tile) == m_corridor.back();
+		}
+
 		if (m_destStation != INVALID_STATION) {
 			return IsDockingTile(tile) && IsShipDestinationTile(tile, m_destStation);
 		}
@@ -87,6 +138,13 @@ public:
 		int y1 = 2 * TileY(tile) + dg_dir_to_y_offs[(int)exitdir];
 		int x2 = 2 * TileX(m_destTile);
 		int y2 = 2 * TileY(m_destTile);
+		if (m_intermediate_dest) {
+			/* Distance to the nearest tile of the region we are heading for. */
+			uint rx, ry;
+			GetWaterRegionBounds(m_corridor.back().region, &rx, &ry);
+			x2 = Clamp(x1, 2 * (int)rx, 2 * (int)(rx + WATER_REGION_EDGE_LENGTH - 1));
+			y2 = Clamp(y1, 2 * (int)ry, 2 * (int)(ry + WATER_REGION_EDGE_LENGTH - 1));
+		}
 		int dx = abs(x1 - x2);
 		int dy = abs(y1 - y2);
 		int dmin = std::min(dx, dy);
@@ -125,7 +183,7 @@ public:
 	inline void PfFollowNode(Node &old_node)
 	{
 		TrackFollower F(Yapf().GetVehicle());
-		if (F.Follow(old_node.m_key.m_tile, old_node.m_key.m_td)) {
+		if (F.Follow(old_node.m_key.m_tile, old_node.m_key.m_td) && Yapf().IsInCorridor(F.m_new_tile)) {
 			Yapf().AddMultipleNodes(&old_node, F);
 		}
 	}
@@ -158,11 +216,41 @@ public:
 		/* convert origin trackdir to TrackdirBits */
 		TrackdirBits trackdirs = TrackdirToTrackdirBits(trackdir);
 
+		/* Find the way over the water regions first, so the tile search only has to look at a corridor. */
+		std::vector<WaterRegionPatchDesc> high_level_path;
+		std::vector<TileIndex> dest_tiles;
+		GetShipDestinationTiles(v, dest_tiles);
+		if (FindWaterRegionPath(src_tile, dest_tiles, _settings_game.pf.yapf.max_search_nodes, high_level_path)) {
+			Trackdir next_trackdir = FindShipTrack(v, tile, src_tile, trackdirs, &high_level_path, path_found, path_cache);
+			if (path_found) return next_trackdir;
+			/* The regions promised a way the tiles don't have; fall back to searching everywhere. */
+			path_cache.clear();
+		}
+
+		return FindShipTrack(v, tile, src_tile, trackdirs, nullptr, path_found, path_cache);
+	}
+
+	/**
+	 * Search the path of a ship over the tiles.
+	 * @param v          The ship.
+	 * @param tile       The tile the ship is about to enter.
+	 * @param src_tile   The tile the ship is coming from.
+	 * @param trackdirs  The trackdirs to start the search with.
+	 * @param corridor   Patches of water to limit the search to, or \c nullptr to search everywhere.
+	 * @param[out] path_found Whether the destination was reached.
+	 * @param[out] path_cache The first steps of the found path.
+	 * @return The trackdir to take on \a tile, or INVALID_TRACKDIR if there is none.
+	 */
+	static Trackdir FindShipTrack(const Ship *v, TileIndex tile, TileIndex src_tile, TrackdirBits trackdirs, const std::vector<WaterRegionPatchDesc> *corridor, bool &path_found, ShipPathCache &path_cache)
+	{
 		/* create pathfinder instance */
 		Tpf pf;
 		/* set origin and destination nodes */
 		pf.SetOrigin(src_tile, trackdirs);
 		pf.SetDestination(v);
+
+		if (corridor != nullptr) pf.SetCorridor(*corridor);
+
 		/* find best path */
 		path_found = pf.FindPath(v);
 
@@ -344,13 +432,15 @@ struct CYapfShip_TypesT
 };
 
 /* YAPF type 1 - uses TileIndex/Trackdir as Node key */
-struct CYapfShip1 : CYapfT<CYapfShip_TypesT<CYapfShip1, CFollowTrackWater    , CShipNodeListTrackDir> > {};
+struct CYapfShip1 : CYapfT<CYapfShip_TypesT<CYapfShip1, CFollowTrackWater    , CShipNodeListTrackDirHeap> > {};
 /* YAPF type 2 - uses TileIndex/DiagDirection as Node key */
-struct CYapfShip2 : CYapfT<CYapfShip_TypesT<CYapfShip2, CFollowTrackWater    , CShipNodeListExitDir > > {};
+struct CYapfShip2 : CYapfT<CYapfShip_TypesT<CYapfShip2, CFollowTrackWater    , CShipNodeListExitDirHeap> > {};
 
 /** Ship controller helper - path finder invoker */
 Track YapfShipChooseTrack(const Ship *v, TileIndex tile, DiagDirection enterdir, TrackBits tracks, bool &path_found, ShipPathCache &path_cache)
 {
+	Debug(pfquery, 1, "{}", FormatYapfQuery({ YQT_SHIP, v->index, tile, enterdir, (uint16)tracks }));
+
 	/* default is YAPF type 2 */
 	typedef Trackdir (*PfnChooseShipTrack)(const Ship*, TileIndex, DiagDirection, TrackBits, bool &path_found, ShipPathCache &path_cache);
 	PfnChooseShipTrack pfnChooseShipTrack = CYapfShip2::ChooseShipTrack; // default: ExitDir
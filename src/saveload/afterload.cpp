@@ -31,6 +31,7 @@
 #include "../roadstop_base.h"
 #include "../tunnelbridge_map.h"
 #include "../pathfinder/yapf/yapf_cache.h"
+#include "../pathfinder/water_regions.h"
 #include "../elrail_func.h"
 #include "../signs_func.h"
 #include "../aircraft.h"
@@ -840,7 +841,8 @@ bool AfterLoadGame()
 		}
 	}
 
-	/* Update all vehicles */
+	/* Update all vehicles. The map has its final size now, so size the tile hash for it first. */
+	ResetVehicleHash();
 	AfterLoadVehicles(true);
 
 	/* make sure there is a town in the game */
@@ -1621,7 +1623,7 @@ bool AfterLoadGame()
 			if ((v->type != VEH_TRAIN || Train::From(v)->IsFrontEngine()) &&  // for all locs
 					!(v->vehstatus & (VS_STOPPED | VS_CRASHED)) && // not stopped or crashed
 					v->current_order.IsType(OT_LOADING)) {         // loading
-				Station::Get(v->last_station_visited)->loading_vehicles.push_back(v);
+				Station::Get(v->last_station_visited)->AddLoadingVehicle(v);
 
 				/* The loading finished flag is *only* set when actually completely
 				 * finished. Because the vehicle is loading, it is not finished. */
@@ -1636,7 +1638,7 @@ bool AfterLoadGame()
 			for (iter = st->loading_vehicles.begin(); iter != st->loading_vehicles.end();) {
 				Vehicle *v = *iter;
 				iter++;
-				if (!v->current_order.IsType(OT_LOADING)) st->loading_vehicles.remove(v);
+				if (!v->current_order.IsType(OT_LOADING)) st->RemoveLoadingVehicle(v);
 			}
 		}
 	}
@@ -3282,6 +3284,8 @@ bool AfterLoadGame()
 	ResetSignalHandlers();
 
 	AfterLoadLinkGraphs();
+	InitializeWaterRegions();
+	InvalidateSignalBlocks();
 
 	CheckGroundVehiclesAtCorrectZ();
 
@@ -3325,6 +3329,8 @@ void ReloadNewGRFData()
 	GroupStatistics::UpdateAfterLoad();
 	/* update station graphics */
 	AfterLoadStations();
+	/* station tiles may no longer be passable */
+	InvalidateSignalBlocks();
 	/* Update company statistics. */
 	AfterLoadCompanyStats();
 	/* Check and update house and town values */
@@ -38,6 +38,9 @@ public:
 		SLE_CONDVAR(Edge, last_restricted_update,   SLE_INT32, SLV_187, SL_MAX_VERSION),
 		    SLE_VAR(Edge, dest_node,                SLE_UINT16),
 		SLE_CONDVARNAME(Edge, dest_node, "next_edge", SLE_UINT16, SL_MIN_VERSION, SLV_LINKGRAPH_EDGES),
+		SLE_CONDVAR(Edge, recalc_capacity,          SLE_UINT32, SLV_LINKGRAPH_RECALC_THRESHOLD, SL_MAX_VERSION),
+		SLE_CONDVAR(Edge, recalc_travel_time,       SLE_UINT32, SLV_LINKGRAPH_RECALC_THRESHOLD, SL_MAX_VERSION),
+		SLE_CONDVAR(Edge, recalc_restriction,       SLE_UINT8,  SLV_LINKGRAPH_RECALC_THRESHOLD, SL_MAX_VERSION),
 	};
 	inline const static SaveLoadCompatTable compat_description = _linkgraph_edge_sl_compat;
 
@@ -101,6 +104,9 @@ public:
 		    SLE_VAR(Node, demand,      SLE_UINT32),
 		    SLE_VAR(Node, station,     SLE_UINT16),
 		    SLE_VAR(Node, last_update, SLE_INT32),
+		SLE_CONDVAR(Node, recalc_supply, SLE_UINT32, SLV_LINKGRAPH_RECALC_THRESHOLD, SL_MAX_VERSION),
+		SLE_CONDVAR(Node, recalc_demand, SLE_UINT32, SLV_LINKGRAPH_RECALC_THRESHOLD, SL_MAX_VERSION),
+		SLE_CONDVAR(Node, recalc_edges,  SLE_UINT16, SLV_LINKGRAPH_RECALC_THRESHOLD, SL_MAX_VERSION),
 		SLEG_STRUCTLIST("edges", SlLinkgraphEdge),
 	};
 	inline const static SaveLoadCompatTable compat_description = _linkgraph_node_sl_compat;
@@ -139,6 +145,7 @@ SaveLoadTable GetLinkGraphDesc()
 		 SLE_VAR(LinkGraph, last_compression, SLE_INT32),
 		SLEG_CONDVAR("num_nodes", _num_nodes, SLE_UINT16, SL_MIN_VERSION, SLV_SAVELOAD_LIST_LENGTH),
 		 SLE_VAR(LinkGraph, cargo,            SLE_UINT8),
+		SLE_CONDVAR(LinkGraph, recalc_size,   SLE_UINT16, SLV_LINKGRAPH_RECALC_THRESHOLD, SL_MAX_VERSION),
 		SLEG_STRUCTLIST("nodes", SlLinkgraphNode),
 	};
 	return link_graph_desc;
@@ -42,8 +42,11 @@
 #include "../string_func.h"
 #include "../fios.h"
 #include "../error.h"
+#include "../task_pool.h"
+#include <array>
 #include <atomic>
 #include <deque>
+#include <memory>
 #include <vector>
 #include <string>
 #ifdef __EMSCRIPTEN__
@@ -116,6 +119,31 @@ struct ReadBuffer {
 		return *this->bufp++;
 	}
 
+	/**
+	 * Read a number of bytes at once.
+	 * @param p      Where to store the bytes.
+	 * @param length The number of bytes to read.
+	 */
+	void CopyBytes(byte *p, size_t length)
+	{
+		while (length > 0) {
+			if (this->bufp == this->bufe) {
+				size_t len = this->reader->Read(this->buf, lengthof(this->buf));
+				if (len == 0) SlErrorCorrupt("Unexpected end of chunk");
+
+				this->read += len;
+				this->bufp = this->buf;
+				this->bufe = this->buf + len;
+			}
+
+			size_t n = std::min<size_t>(length, this->bufe - this->bufp);
+			memcpy(p, this->bufp, n);
+			this->bufp += n;
+			p += n;
+			length -= n;
+		}
+	}
+
 	/**
 	 * Get the size of the memory dump made so far.
 	 * @return The size.
@@ -145,6 +173,14 @@ struct MemoryDumper {
 		}
 	}
 
+	/** Start writing into a new block of memory. */
+	void AllocateBlock()
+	{
+		this->buf = CallocT<byte>(MEMORY_CHUNK_SIZE);
+		this->blocks.push_back(this->buf);
+		this->bufe = this->buf + MEMORY_CHUNK_SIZE;
+	}
+
 	/**
 	 * Write a single byte into the dumper.
 	 * @param b The byte to write.
@@ -152,15 +188,29 @@ struct MemoryDumper {
 	inline void WriteByte(byte b)
 	{
 		/* Are we at the end of this chunk? */
-		if (this->buf == this->bufe) {
-			this->buf = CallocT<byte>(MEMORY_CHUNK_SIZE);
-			this->blocks.push_back(this->buf);
-			this->bufe = this->buf + MEMORY_CHUNK_SIZE;
-		}
+		if (this->buf == this->bufe) this->AllocateBlock();
 
 		*this->buf++ = b;
 	}
 
+	/**
+	 * Write a number of bytes into the dumper at once.
+	 * @param p      The bytes to write.
+	 * @param length The number of bytes to write.
+	 */
+	void CopyBytes(const byte *p, size_t length)
+	{
+		while (length > 0) {
+			if (this->buf == this->bufe) this->AllocateBlock();
+
+			size_t n = std::min<size_t>(length, this->bufe - this->buf);
+			memcpy(this->buf, p, n);
+			this->buf += n;
+			p += n;
+			length -= n;
+		}
+	}
+
 	/**
 	 * Flush this dumper into a writer.
 	 * @param writer The filter we want to use.
@@ -176,8 +226,6 @@ struct MemoryDumper {
 			writer->Write(this->blocks[i++], to_write);
 			t -= to_write;
 		}
-
-		writer->Finish();
 	}
 
 	/**
@@ -203,6 +251,7 @@ struct SaveLoadParams {
 
 	MemoryDumper *dumper;                ///< Memory dumper to write the savegame to.
 	SaveFilter *sf;                      ///< Filter to write the savegame to.
+	std::vector<std::pair<MemoryDumper *, const ChunkHandler *>> snapshots; ///< Chunks to save from their snapshot on the saving thread, with the dump of the chunks before them.
 
 	ReadBuffer *reader;                  ///< Savegame reading buffer.
 	LoadFilter *lf;                      ///< Filter to read the savegame from.
@@ -762,11 +811,40 @@ static void SlCopyBytes(void *ptr, size_t length)
 	switch (_sl.action) {
 		case SLA_LOAD_CHECK:
 		case SLA_LOAD:
-			for (; length != 0; length--) *p++ = SlReadByte();
+			_sl.reader->CopyBytes(p, length);
 			break;
 		case SLA_SAVE:
-			for (; length != 0; length--) SlWriteByte(*p++);
+			_sl.dumper->CopyBytes(p, length);
+			break;
+		default: NOT_REACHED();
+	}
+}
+
+/**
+ * Save/Load 16 bits integers in bulk, converting them from/to the big
+ * endian order of the savegame.
+ * @param p      The integers to save or load.
+ * @param length The number of integers.
+ */
+static void SlCopyUint16s(uint16 *p, size_t length)
+{
+	switch (_sl.action) {
+		case SLA_LOAD_CHECK:
+		case SLA_LOAD:
+			_sl.reader->CopyBytes((byte *)p, length * sizeof(uint16));
+			for (size_t i = 0; i != length; i++) p[i] = FROM_BE16(p[i]);
+			break;
+		case SLA_SAVE: {
+			std::array<uint16, 1024> buf;
+			while (length > 0) {
+				size_t n = std::min(length, buf.size());
+				for (size_t i = 0; i != n; i++) buf[i] = TO_BE16(p[i]);
+				_sl.dumper->CopyBytes((const byte *)buf.data(), n * sizeof(uint16));
+				p += n;
+				length -= n;
+			}
 			break;
+		}
 		default: NOT_REACHED();
 	}
 }
@@ -1109,6 +1187,8 @@ static void SlCopyInternal(void *object, size_t length, VarType conv)
 	 * conversion is needed, use specialized copy-copy function to speed up things */
 	if (conv == SLE_INT8 || conv == SLE_UINT8) {
 		SlCopyBytes(object, length);
+	} else if (conv == SLE_INT16 || conv == SLE_UINT16) {
+		SlCopyUint16s((uint16 *)object, length);
 	} else {
 		byte *a = (byte*)object;
 		byte mem_size = SlCalcConvMemLen(conv);
@@ -2256,10 +2336,19 @@ static void SlSaveChunk(const ChunkHandler &ch)
 	if (_sl.expect_table_header) SlErrorCorrupt("Table chunk without header");
 }
 
-/** Save all chunks */
-static void SlSaveChunks()
+/**
+ * Save all chunks
+ * @param snapshot Whether the chunks that can capture their data do so, to be saved on the saving thread.
+ */
+static void SlSaveChunks(bool snapshot)
 {
-	for (auto &ch : ChunkHandlers()) {
+	for (const ChunkHandler &ch : ChunkHandlers()) {
+		if (snapshot && ch.type != CH_READONLY && ch.Snapshot()) {
+			/* The chunks after this one go into a new dump. */
+			_sl.snapshots.emplace_back(_sl.dumper, &ch);
+			_sl.dumper = new MemoryDumper();
+			continue;
+		}
 		SlSaveChunk(ch);
 	}
 
@@ -2768,8 +2857,289 @@ struct LZMASaveFilter : SaveFilter {
 	}
 };
 
+/** Number of uncompressed bytes in the blocks of a block-parallel LZMA savegame. */
+static const size_t LZMA_MT_BLOCK_SIZE = 4 * 1024 * 1024;
+
+/**
+ * A block of a block-parallel LZMA savegame, which is (de)compressed on the task pool.
+ * The blocks go before queued link graph jobs, and when all task threads are busy
+ * the filter (de)compresses the block it waits for itself.
+ */
+struct LZMABlock {
+	std::vector<byte> data;       ///< The uncompressed data.
+	std::vector<byte> compressed; ///< The compressed data.
+	bool failed = false;          ///< Whether (de)compressing the block failed.
+	TaskGroup task;               ///< The task (de)compressing the block; destroyed first, so it waits before the buffers go.
+};
+
+/**
+ * Filter using LZMA compression in independent blocks, so they can be
+ * decompressed in parallel. Each block is preceded by its uncompressed and
+ * compressed size as big endian uint32, and the stream ends with an empty block.
+ */
+struct LZMAMTLoadFilter : LoadFilter {
+	std::deque<std::unique_ptr<LZMABlock>> blocks; ///< Blocks that are being decompressed, in savegame order.
+	size_t read_pos = 0;                           ///< Number of bytes of the front block that have been read.
+	bool end = false;                              ///< Whether the last block has been read from the file.
+
+	/**
+	 * Initialise this filter.
+	 * @param chain The next filter in this chain.
+	 */
+	LZMAMTLoadFilter(LoadFilter *chain) : LoadFilter(chain)
+	{
+	}
+
+	/** Read the next block from the file and start decompressing it. */
+	void ReadBlock()
+	{
+		uint32 hdr[2];
+		if (this->chain->Read((byte *)hdr, sizeof(hdr)) != sizeof(hdr)) SlError(STR_GAME_SAVELOAD_ERROR_FILE_NOT_READABLE);
+
+		size_t size = FROM_BE32(hdr[0]);
+		size_t compressed_size = FROM_BE32(hdr[1]);
+		if (size == 0) {
+			this->end = true;
+			return;
+		}
+		if (size > LZMA_MT_BLOCK_SIZE || compressed_size > lzma_stream_buffer_bound(LZMA_MT_BLOCK_SIZE)) SlErrorCorrupt("Invalid LZMA block size");
+
+		LZMABlock *block = this->blocks.emplace_back(new LZMABlock()).get();
+		block->compressed.resize(compressed_size);
+		if (this->chain->Read(block->compressed.data(), compressed_size) != compressed_size) SlError(STR_GAME_SAVELOAD_ERROR_FILE_NOT_READABLE);
+		block->data.resize(size);
+
+		block->task.Run([block]() {
+			uint64 memlimit = UINT64_MAX;
+			size_t in_pos = 0;
+			size_t out_pos = 0;
+			lzma_ret r = lzma_stream_buffer_decode(&memlimit, 0, nullptr, block->compressed.data(), &in_pos, block->compressed.size(), block->data.data(), &out_pos, block->data.size());
+			block->failed = r != LZMA_OK || in_pos != block->compressed.size() || out_pos != block->data.size();
+		}, true);
+	}
+
+	size_t Read(byte *buf, size_t size) override
+	{
+		size_t read = 0;
+		while (read < size) {
+			/* Keep a block queued for every task thread, besides the one we are reading. */
+			while (!this->end && this->blocks.size() <= GetTaskThreadCount()) this->ReadBlock();
+			if (this->blocks.empty()) break;
+
+			LZMABlock &block = *this->blocks.front();
+			block.task.Wait();
+			if (block.failed) SlError(STR_GAME_SAVELOAD_ERROR_BROKEN_INTERNAL_ERROR, "liblzma returned error code");
+
+			size_t n = std::min(size - read, block.data.size() - this->read_pos);
+			memcpy(buf + read, block.data.data() + this->read_pos, n);
+			read += n;
+			this->read_pos += n;
+
+			if (this->read_pos == block.data.size()) {
+				this->blocks.pop_front();
+				this->read_pos = 0;
+			}
+		}
+		return read;
+	}
+
+	void Reset() override
+	{
+		this->blocks.clear();
+		this->read_pos = 0;
+		this->end = false;
+		this->chain->Reset();
+	}
+};
+
+/** Filter using LZMA compression in independent blocks, which are compressed in parallel. */
+struct LZMAMTSaveFilter : SaveFilter {
+	std::deque<std::unique_ptr<LZMABlock>> blocks; ///< Blocks that are being compressed, in savegame order.
+	std::unique_ptr<LZMABlock> current;            ///< Block that is being filled.
+	byte compression_level;                        ///< The requested level of compression.
+
+	/**
+	 * Initialise this filter.
+	 * @param chain             The next filter in this chain.
+	 * @param compression_level The requested level of compression.
+	 */
+	LZMAMTSaveFilter(SaveFilter *chain, byte compression_level) : SaveFilter(chain), compression_level(compression_level)
+	{
+	}
+
+	/** Start compressing the block that is being filled. */
+	void CompressBlock()
+	{
+		LZMABlock *block = this->blocks.emplace_back(std::move(this->current)).get();
+		uint32 level = this->compression_level;
+
+		block->task.Run([block, level]() {
+			block->compressed.resize(lzma_stream_buffer_bound(block->data.size()));
+			size_t out_pos = 0;
+			block->failed = lzma_easy_buffer_encode(level, LZMA_CHECK_CRC32, nullptr, block->data.data(), block->data.size(), block->compressed.data(), &out_pos, block->compressed.size()) != LZMA_OK;
+			block->compressed.resize(out_pos);
+		}, true);
+	}
+
+	/** Wait for the oldest block to be compressed, and write it. */
+	void WriteBlock()
+	{
+		LZMABlock &block = *this->blocks.front();
+		block.task.Wait();
+		if (block.failed) SlError(STR_GAME_SAVELOAD_ERROR_BROKEN_INTERNAL_ERROR, "liblzma returned error code");
+
+		uint32 hdr[2] = { TO_BE32((uint32)block.data.size()), TO_BE32((uint32)block.compressed.size()) };
+		this->chain->Write((byte *)hdr, sizeof(hdr));
+		this->chain->Write(block.compressed.data(), block.compressed.size());
+		this->blocks.pop_front();
+	}
+
+	void Write(byte *buf, size_t size) override
+	{
+		while (size > 0) {
+			if (this->current == nullptr) {
+				this->current.reset(new LZMABlock());
+				this->current->data.reserve(LZMA_MT_BLOCK_SIZE);
+			}
+
+			size_t n = std::min(size, LZMA_MT_BLOCK_SIZE - this->current->data.size());
+			this->current->data.insert(this->current->data.end(), buf, buf + n);
+			buf += n;
+			size -= n;
+
+			if (this->current->data.size() == LZMA_MT_BLOCK_SIZE) {
+				this->CompressBlock();
+				/* Keep a block in progress for every task thread, and no more, to bound the memory usage. */
+				while (this->blocks.size() > GetTaskThreadCount()) this->WriteBlock();
+			}
+		}
+	}
+
+	void Finish() override
+	{
+		if (this->current != nullptr) this->CompressBlock();
+		while (!this->blocks.empty()) this->WriteBlock();
+
+		uint32 end[2] = { 0, 0 };
+		this->chain->Write((byte *)end, sizeof(end));
+		this->chain->Finish();
+	}
+};
+
 #endif /* WITH_LIBLZMA */
 
+/********************************************
+ ********** START OF ZSTD CODE **************
+ ********************************************/
+
+#if defined(WITH_ZSTD)
+#include <zstd.h>
+
+/** Filter using Zstandard compression. */
+struct ZSTDLoadFilter : LoadFilter {
+	ZSTD_DCtx *zstd;                   ///< Stream state we are reading from.
+	ZSTD_inBuffer input;               ///< The part of #fread_buf that has not been decompressed yet.
+	byte fread_buf[MEMORY_CHUNK_SIZE]; ///< Buffer for reading from the file.
+
+	/**
+	 * Initialise this filter.
+	 * @param chain The next filter in this chain.
+	 */
+	ZSTDLoadFilter(LoadFilter *chain) : LoadFilter(chain), input({ this->fread_buf, 0, 0 })
+	{
+		this->zstd = ZSTD_createDCtx();
+		if (this->zstd == nullptr) SlError(STR_GAME_SAVELOAD_ERROR_BROKEN_INTERNAL_ERROR, "cannot initialize decompressor");
+	}
+
+	/** Clean everything up. */
+	~ZSTDLoadFilter()
+	{
+		ZSTD_freeDCtx(this->zstd);
+	}
+
+	size_t Read(byte *buf, size_t size) override
+	{
+		ZSTD_outBuffer output = { buf, size, 0 };
+
+		do {
+			/* read more bytes from the file? */
+			if (this->input.pos == this->input.size) {
+				this->input.size = this->chain->Read(this->fread_buf, sizeof(this->fread_buf));
+				this->input.pos = 0;
+				if (this->input.size == 0) break;
+			}
+
+			/* decompress the data */
+			size_t r = ZSTD_decompressStream(this->zstd, &output, &this->input);
+			if (ZSTD_isError(r)) SlError(STR_GAME_SAVELOAD_ERROR_BROKEN_INTERNAL_ERROR, "libzstd returned error code");
+			/* The frame has ended and all its data has been flushed. */
+			if (r == 0 && output.pos < output.size) break;
+		} while (output.pos != output.size);
+
+		return output.pos;
+	}
+};
+
+/** Filter using Zstandard compression. */
+struct ZSTDSaveFilter : SaveFilter {
+	ZSTD_CCtx *zstd; ///< Stream state we are writing to.
+
+	/**
+	 * Initialise this filter.
+	 * @param chain             The next filter in this chain.
+	 * @param compression_level The requested level of compression.
+	 */
+	ZSTDSaveFilter(SaveFilter *chain, byte compression_level) : SaveFilter(chain)
+	{
+		this->zstd = ZSTD_createCCtx();
+		if (this->zstd == nullptr || ZSTD_isError(ZSTD_CCtx_setParameter(this->zstd, ZSTD_c_compressionLevel, compression_level))) {
+			SlError(STR_GAME_SAVELOAD_ERROR_BROKEN_INTERNAL_ERROR, "cannot initialize compressor");
+		}
+	}
+
+	/** Clean up what we allocated. */
+	~ZSTDSaveFilter()
+	{
+		ZSTD_freeCCtx(this->zstd);
+	}
+
+	/**
+	 * Helper loop for writing the data.
+	 * @param p    The bytes to write.
+	 * @param len  Amount of bytes to write.
+	 * @param mode Mode for ZSTD_compressStream2.
+	 */
+	void WriteLoop(byte *p, size_t len, ZSTD_EndDirective mode)
+	{
+		byte buf[MEMORY_CHUNK_SIZE]; // output buffer
+		ZSTD_inBuffer input = { p, len, 0 };
+		for (;;) {
+			ZSTD_outBuffer output = { buf, sizeof(buf), 0 };
+			size_t r = ZSTD_compressStream2(this->zstd, &output, &input, mode);
+			if (ZSTD_isError(r)) SlError(STR_GAME_SAVELOAD_ERROR_BROKEN_INTERNAL_ERROR, "libzstd returned error code");
+
+			/* bytes were emitted? */
+			if (output.pos != 0) this->chain->Write(buf, output.pos);
+
+			/* When continuing all input has to be consumed, when ending everything has to be flushed too. */
+			if (mode == ZSTD_e_continue ? input.pos == input.size : r == 0) break;
+		}
+	}
+
+	void Write(byte *buf, size_t size) override
+	{
+		this->WriteLoop(buf, size, ZSTD_e_continue);
+	}
+
+	void Finish() override
+	{
+		this->WriteLoop(nullptr, 0, ZSTD_e_end);
+		this->chain->Finish();
+	}
+};
+
+#endif /* WITH_ZSTD */
+
 /*******************************************
  ************* END OF CODE *****************
  *******************************************/
@@ -2805,6 +3175,21 @@ static const SaveLoadFormat _saveload_formats[] = {
 #else
 	{"zlib",   TO_BE32X('OTTZ'), nullptr,                            nullptr,                            0, 0, 0},
 #endif
+#if defined(WITH_ZSTD)
+	/* Level 3 is faster than zlib level 6, while it results in smaller saves. Levels above 19 are left out, as they need
+	 * much more memory. Like lzma-mt it is listed before lzma, so lzma stays the default format that older versions can load. */
+	{"zstd",   TO_BE32X('OTTS'), CreateLoadFilter<ZSTDLoadFilter>,   CreateSaveFilter<ZSTDSaveFilter>,   1, 3, 19},
+#else
+	{"zstd",   TO_BE32X('OTTS'), nullptr,                            nullptr,                            0, 0, 0},
+#endif
+#if defined(WITH_LIBLZMA)
+	/* The same compression as lzma, but in independent blocks of 4 MiB that are (de)compressed in parallel on the task pool.
+	 * The blocks make the savegame slightly bigger, as matches cannot cross them. It is listed before lzma, so it does not
+	 * become the default format: older versions cannot load it. */
+	{"lzma-mt", TO_BE32X('OTTM'), CreateLoadFilter<LZMAMTLoadFilter>, CreateSaveFilter<LZMAMTSaveFilter>, 0, 2, 9},
+#else
+	{"lzma-mt", TO_BE32X('OTTM'), nullptr,                            nullptr,                            0, 0, 0},
+#endif
 #if defined(WITH_LIBLZMA)
 	/* Level 2 compression is speed wise as fast as zlib level 6 compression (old default), but results in ~10% smaller saves.
 	 * Higher compression levels are possible, and might improve savegame size by up to 25%, but are also up to 10 times slower.
@@ -2888,6 +3273,12 @@ static inline void ClearSaveLoadState()
 	delete _sl.dumper;
 	_sl.dumper = nullptr;
 
+	for (auto &snapshot : _sl.snapshots) {
+		delete snapshot.first;
+		snapshot.second->ReleaseSnapshot();
+	}
+	_sl.snapshots.clear();
+
 	delete _sl.sf;
 	_sl.sf = nullptr;
 
@@ -2960,7 +3351,21 @@ static SaveOrLoadResult SaveFileToDisk(bool threaded)
 		_sl.sf->Write((byte*)hdr, sizeof(hdr));
 
 		_sl.sf = fmt->init_write(_sl.sf, compression);
+
+		for (auto &snapshot : _sl.snapshots) {
+			/* The chunks before the captured one, which were saved while the game was paused. */
+			snapshot.first->Flush(_sl.sf);
+			delete snapshot.first;
+			snapshot.first = new MemoryDumper();
+
+			/* Now save the captured chunk, while the dump of the chunks after it waits. */
+			std::swap(snapshot.first, _sl.dumper);
+			SlSaveChunk(*snapshot.second);
+			std::swap(snapshot.first, _sl.dumper);
+			snapshot.first->Flush(_sl.sf);
+		}
 		_sl.dumper->Flush(_sl.sf);
+		_sl.sf->Finish();
 
 		ClearSaveLoadState();
 
@@ -3003,6 +3408,8 @@ void WaitTillSaved()
  * Actually perform the saving of the savegame.
  * General tactics is to first save the game to memory, then write it to file
  * using the writer, either in threaded mode if possible, or single-threaded.
+ * In threaded mode the chunks that can capture their data, like the map, are
+ * saved on the saving thread as well, so the game is paused for less time.
  * @param writer   The filter to write the savegame to.
  * @param threaded Whether to try to perform the saving asynchronously.
  * @return Return the result of the action. #SL_OK or #SL_ERROR
@@ -3017,7 +3424,7 @@ static SaveOrLoadResult DoSave(SaveFilter *writer, bool threaded)
 	_sl_version = SAVEGAME_VERSION;
 
 	SaveViewportBeforeSaveGame();
-	SlSaveChunks();
+	SlSaveChunks(threaded);
 
 	SaveFileStart();
 
@@ -352,6 +352,10 @@ enum SaveLoadVersion : uint16 {
 	SLV_MORE_CARGO_AGE,                     ///< 307  PR#10596 Track cargo age for a longer period.
 	SLV_LINKGRAPH_SECONDS,                  ///< 308  PR#10610 Store linkgraph update intervals in seconds instead of days.
 	SLV_AI_START_DATE,                      ///< 309  PR#10653 Removal of individual AI start dates and added a generic one.
+	SLV_LINKGRAPH_PARALLEL_MCF,             ///< 310  Search the paths of several link graph sources at once.
+	SLV_LINKGRAPH_RECALC_THRESHOLD,         ///< 311  Skip link graph components that did not change since their last calculation.
+	SLV_LAZY_CARGO_AGING,                   ///< 312  Cargo in vehicles is aged lazily.
+	SLV_MAP_COLUMNS,                        ///< 313  Map chunks are saved as a single column, with height and m2 delta encoded.
 
 	SL_MAX_VERSION,                         ///< Highest possible saveload version
 };
@@ -452,6 +456,19 @@ struct ChunkHandler {
 	 */
 	virtual void LoadCheck(size_t len = 0) const;
 
+	/**
+	 * Capture the data of the chunk, so Save() can run on the saving thread
+	 * while the game goes on. Only chunks that can copy their data much
+	 * quicker than they can save it should implement this.
+	 * @return True iff the data was captured; Save() then saves the captured data.
+	 */
+	virtual bool Snapshot() const { return false; }
+
+	/**
+	 * Release the data captured by Snapshot(), after the chunk has been saved or the saving failed.
+	 */
+	virtual void ReleaseSnapshot() const {}
+
 	std::string GetName() const
 	{
 		return std::string()
@@ -132,6 +132,8 @@ void AfterLoadStations()
 		StationUpdateCachedTriggers(st);
 		RoadStopUpdateCachedTriggers(st);
 	}
+
+	Station::RebuildLoadingStations();
 }
 
 /**
@@ -1883,6 +1883,8 @@ static SettingsContainer &GetSettingsTree()
 				cdist->Add(new SettingEntry("linkgraph.demand_distance"));
 				cdist->Add(new SettingEntry("linkgraph.demand_size"));
 				cdist->Add(new SettingEntry("linkgraph.short_path_saturation"));
+				cdist->Add(new SettingEntry("linkgraph.parallel_mcf"));
+				cdist->Add(new SettingEntry("linkgraph.recalc_threshold"));
 			}
 
 			environment->Add(new SettingEntry("station.modified_catchment"));
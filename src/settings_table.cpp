@@ -46,6 +46,8 @@
 #include "vehicle_func.h"
 #include "viewport_func.h"
 #include "void_map.h"
+#include "task_pool.h"
+#include "linkgraph/linkgraph.h"
 
 #include "table/strings.h"
 #include "table/settings.h"
@@ -112,6 +114,12 @@ static void UpdateLinkgraphColours(int32 new_value)
 	MarkWholeScreenDirty();
 }
 
+/** Recalculate all link graphs after a setting changed that affects the distribution. */
+static void LinkGraphSettingChanged(int32 new_value)
+{
+	for (LinkGraph *lg : LinkGraph::Iterate()) lg->ForceRecalculation();
+}
+
 static void StationSpreadChanged(int32 new_value)
 {
 	InvalidateWindowData(WC_SELECT_STATION, 0);
@@ -202,6 +210,7 @@ static void TrainAccelerationModelChanged(int32 new_value)
 	for (Train *t : Train::Iterate()) {
 		if (t->IsFrontEngine()) {
 			t->tcache.cached_max_curve_speed = t->GetCurveSpeedLimit();
+			t->curve_speed_outdated = false;
 			t->UpdateAcceleration();
 		}
 	}
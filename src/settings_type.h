@@ -547,6 +547,8 @@ struct LinkGraphSettings {
 	uint8 demand_size;                      ///< influence of supply ("station size") on the demand function
 	uint8 demand_distance;                  ///< influence of distance between stations on the demand function
 	uint8 short_path_saturation;            ///< percentage up to which short paths are saturated before saturating most capacious paths
+	bool parallel_mcf;                      ///< search the paths of several sources at once before assigning flow to them
+	uint8 recalc_threshold;                 ///< percentage by which a component has to change before it is recalculated, 0 to always recalculate
 
 	inline DistributionType GetDistributionType(CargoID cargo) const {
 		if (IsCargoInClass(cargo, CC_PASSENGERS)) return this->distribution_pax;
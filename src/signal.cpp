@@ -16,16 +16,13 @@
 #include "train.h"
 #include "company_base.h"
 
-#include "safeguards.h"
+#include <unordered_map>
 
+#include "safeguards.h"
 
-/** these are the maximums used for updating signal blocks */
-static const uint SIG_TBU_SIZE    =  64; ///< number of signals entering to block
-static const uint SIG_TBD_SIZE    = 256; ///< number of intersections - open nodes in current block
-static const uint SIG_GLOB_SIZE   = 128; ///< number of open blocks (block can be opened more times until detected)
-static const uint SIG_GLOB_UPDATE =  64; ///< how many items need to be in _globset to force update
 
-static_assert(SIG_GLOB_UPDATE <= SIG_GLOB_SIZE);
+static const uint SIG_GLOB_UPDATE    = 64;      ///< number of items in _globset that forces an update
+static const uint MAX_SIGNAL_BLOCKS  = 1 << 18; ///< number of known signal blocks after which they are all forgotten
 
 /** incidating trackbits with given enterdir */
 static const TrackBits _enterdir_to_trackbits[DIAGDIR_END] = {
@@ -44,41 +41,26 @@ static const TrackdirBits _enterdir_to_trackdirbits[DIAGDIR_END] = {
 };
 
 /**
- * Set containing 'items' items of 'tile and Tdir'
+ * Set of 'tile and Tdir' items.
  * No tree structure is used because it would cause
  * slowdowns in most usual cases
  */
-template <typename Tdir, uint items>
+template <typename Tdir>
 struct SmallSet {
 private:
-	uint n;           // actual number of units
-	bool overflowed;  // did we try to overflow the set?
-	const char *name; // name, used for debugging purposes...
-
 	/** Element of set */
 	struct SSdata {
 		TileIndex tile;
 		Tdir dir;
-	} data[items];
+	};
 
-public:
-	/** Constructor - just set default values and 'name' */
-	SmallSet(const char *name) : n(0), overflowed(false), name(name) { }
+	std::vector<SSdata> data; ///< the items in the set
 
-	/** Reset variables to default values */
+public:
+	/** Remove all items */
 	void Reset()
 	{
-		this->n = 0;
-		this->overflowed = false;
-	}
-
-	/**
-	 * Returns value of 'overflowed'
-	 * @return did we try to overflow the set?
-	 */
-	bool Overflowed()
-	{
-		return this->overflowed;
+		this->data.clear();
 	}
 
 	/**
@@ -87,28 +69,30 @@ public:
 	 */
 	bool IsEmpty()
 	{
-		return this->n == 0;
+		return this->data.empty();
 	}
 
 	/**
-	 * Checks for full set
-	 * @return is the set full?
+	 * Reads the number of items
+	 * @return current number of items
 	 */
-	bool IsFull()
+	uint Items()
 	{
-		return this->n == lengthof(data);
+		return (uint)this->data.size();
 	}
 
 	/**
-	 * Reads the number of items
-	 * @return current number of items
+	 * Reads an item without removing it
+	 * @param index index of the item
+	 * @param tile pointer where tile is written to
+	 * @param dir pointer where dir is written to
 	 */
-	uint Items()
+	void Peek(uint index, TileIndex *tile, Tdir *dir)
 	{
-		return this->n;
+		*tile = this->data[index].tile;
+		*dir = this->data[index].dir;
 	}
 
-
 	/**
 	 * Tries to remove first instance of given tile and dir
 	 * @param tile tile
@@ -117,9 +101,10 @@ public:
 	 */
 	bool Remove(TileIndex tile, Tdir dir)
 	{
-		for (uint i = 0; i < this->n; i++) {
+		for (uint i = 0; i < this->data.size(); i++) {
 			if (this->data[i].tile == tile && this->data[i].dir == dir) {
-				this->data[i] = this->data[--this->n];
+				this->data[i] = this->data.back();
+				this->data.pop_back();
 				return true;
 			}
 		}
@@ -135,33 +120,21 @@ public:
 	 */
 	bool IsIn(TileIndex tile, Tdir dir)
 	{
-		for (uint i = 0; i < this->n; i++) {
-			if (this->data[i].tile == tile && this->data[i].dir == dir) return true;
+		for (const SSdata &item : this->data) {
+			if (item.tile == tile && item.dir == dir) return true;
 		}
 
 		return false;
 	}
 
 	/**
-	 * Adds tile & dir into the set, checks for full set
-	 * Sets the 'overflowed' flag if the set was full
+	 * Adds tile & dir into the set
 	 * @param tile tile
 	 * @param dir and dir to add
-	 * @return true iff the item could be added (set wasn't full)
 	 */
-	bool Add(TileIndex tile, Tdir dir)
+	void Add(TileIndex tile, Tdir dir)
 	{
-		if (this->IsFull()) {
-			overflowed = true;
-			Debug(misc, 0, "SignalSegment too complex. Set {} is full (maximum {})", name, items);
-			return false; // set is full
-		}
-
-		this->data[this->n].tile = tile;
-		this->data[this->n].dir = dir;
-		this->n++;
-
-		return true;
+		this->data.push_back({ tile, dir });
 	}
 
 	/**
@@ -172,19 +145,18 @@ public:
 	 */
 	bool Get(TileIndex *tile, Tdir *dir)
 	{
-		if (this->n == 0) return false;
+		if (this->data.empty()) return false;
 
-		this->n--;
-		*tile = this->data[this->n].tile;
-		*dir = this->data[this->n].dir;
+		*tile = this->data.back().tile;
+		*dir = this->data.back().dir;
+		this->data.pop_back();
 
 		return true;
 	}
 };
 
-static SmallSet<Trackdir, SIG_TBU_SIZE> _tbuset("_tbuset");         ///< set of signals that will be updated
-static SmallSet<DiagDirection, SIG_TBD_SIZE> _tbdset("_tbdset");    ///< set of open nodes in current signal block
-static SmallSet<DiagDirection, SIG_GLOB_SIZE> _globset("_globset"); ///< set of places to be updated in following runs
+static SmallSet<DiagDirection> _tbdset;  ///< set of open nodes in current signal block
+static SmallSet<DiagDirection> _globset; ///< set of places to be updated in following runs
 
 
 /** Check whether there is a train on rail, not in a depot */
@@ -196,11 +168,122 @@ static Vehicle *TrainOnTileEnum(Vehicle *v, void *)
 }
 
 
+/**
+ * Place where a signal block can be entered: a side of a tile, or the inside
+ * of a depot or the wormhole of a tunnel or bridge for #INVALID_DIAGDIR.
+ * @param tile tile
+ * @param dir side of the tile
+ * @return key of the place in #SignalBlock::keys
+ */
+static inline uint64 SignalBlockKey(TileIndex tile, DiagDirection dir)
+{
+	return (uint64)static_cast<uint32>(tile) << 8 | (uint8)dir;
+}
+
+/** Tile of a signal block that has to be checked for trains. */
+struct SignalBlockTile {
+	TileIndex tile;   ///< the tile
+	TrackBits tracks; ///< tracks to check, or TRACK_BIT_NONE to check the whole tile
+
+	bool operator <(const SignalBlockTile &other) const { return std::tie(this->tile, this->tracks) < std::tie(other.tile, other.tracks); }
+	bool operator ==(const SignalBlockTile &other) const { return this->tile == other.tile && this->tracks == other.tracks; }
+};
+
+/** Signal at the border of a signal block. */
+struct SignalBlockSignal {
+	TileIndex tile;     ///< tile of the signal
+	Trackdir trackdir;  ///< trackdir of the signal
+
+	bool operator <(const SignalBlockSignal &other) const { return std::tie(this->tile, this->trackdir) < std::tie(other.tile, other.trackdir); }
+	bool operator ==(const SignalBlockSignal &other) const { return this->tile == other.tile && this->trackdir == other.trackdir; }
+};
+
+/**
+ * Layout of a signal block, as found by ExploreSegment. Everything that does
+ * not change when trains move or signals change state is kept, so the state
+ * of the block can be determined again without searching the tracks.
+ * All lists are sorted, so a block is the same no matter where the search started.
+ */
+struct SignalBlock {
+	Owner owner = INVALID_OWNER;            ///< owner whose signals the block was searched for
+	bool pbs = false;                       ///< a pbs signal was found
+	std::vector<SignalBlockTile> tiles;     ///< tiles to check for trains
+	std::vector<SignalBlockSignal> signals; ///< signals facing into the block, to be updated
+	std::vector<SignalBlockSignal> exits;   ///< pre-signal exits facing out of the block
+	std::vector<uint64> keys;               ///< places the block can be entered, see #SignalBlockKey
+	std::vector<uint64> entered;            ///< places the search entered, also outside of the block, see #SignalBlockKey
+
+	/** Sort the lists of the block, so it does not depend on the order of the search. */
+	void Sort()
+	{
+		std::sort(this->tiles.begin(), this->tiles.end());
+		std::sort(this->signals.begin(), this->signals.end());
+		std::sort(this->exits.begin(), this->exits.end());
+		std::sort(this->keys.begin(), this->keys.end());
+		this->keys.erase(std::unique(this->keys.begin(), this->keys.end()), this->keys.end());
+		std::sort(this->entered.begin(), this->entered.end());
+		this->entered.erase(std::unique(this->entered.begin(), this->entered.end()), this->entered.end());
+	}
+
+	/**
+	 * Check whether the block can be entered at a given place.
+	 * @param tile tile
+	 * @param dir side of the tile
+	 * @return true iff the place belongs to this block
+	 */
+	bool HasKey(TileIndex tile, DiagDirection dir) const
+	{
+		return std::binary_search(this->keys.begin(), this->keys.end(), SignalBlockKey(tile, dir));
+	}
+
+	/**
+	 * Check whether searching the block passes a given place.
+	 * @param tile tile
+	 * @param dir side of the tile
+	 * @return true iff the place belongs to this block, or the search entered it
+	 */
+	bool HasVisited(TileIndex tile, DiagDirection dir) const
+	{
+		return this->HasKey(tile, dir) || std::binary_search(this->entered.begin(), this->entered.end(), SignalBlockKey(tile, dir));
+	}
+
+	bool operator ==(const SignalBlock &other) const
+	{
+		return this->owner == other.owner && this->pbs == other.pbs && this->tiles == other.tiles &&
+				this->signals == other.signals && this->exits == other.exits && this->keys == other.keys && this->entered == other.entered;
+	}
+};
+
+/**
+ * The signal blocks found since the track layout last changed. Trains entering
+ * and leaving blocks only need the state of the block to be determined again,
+ * so the tracks do not have to be searched every time.
+ */
+static std::vector<SignalBlock> _signal_blocks;
+/** Index of the block in _signal_blocks for each place a block can be entered, and the owner of the block. */
+static std::unordered_map<uint64, uint> _signal_block_index;
+/** The track layout is being changed, signal blocks found now must not be kept. */
+static bool _signal_layout_changing = false;
+
+/** Get the key of a place of a block of the given owner in _signal_block_index. */
+static inline uint64 SignalBlockIndexKey(uint64 key, Owner owner)
+{
+	return key << 8 | owner;
+}
+
+/**
+ * Forget all signal blocks, because the track layout (may have) changed.
+ */
+void InvalidateSignalBlocks()
+{
+	_signal_blocks.clear();
+	_signal_block_index.clear();
+}
+
+
 /**
  * Perform some operations before adding data into Todo set
- * The new and reverse direction is removed from _globset, because we are sure
- * it doesn't need to be checked again
- * Also, remove reverse direction from _tbdset
+ * Remove reverse direction from _tbdset
  * This is the 'core' part so the graph searching won't enter any tile twice
  *
  * @param t1 tile we are entering
@@ -211,9 +294,6 @@ static Vehicle *TrainOnTileEnum(Vehicle *v, void *)
  */
 static inline bool CheckAddToTodoSet(TileIndex t1, DiagDirection d1, TileIndex t2, DiagDirection d2)
 {
-	_globset.Remove(t1, d1); // it can be in Global but not in Todo
-	_globset.Remove(t2, d2); // remove in all cases
-
 	assert(!_tbdset.IsIn(t1, d1)); // it really shouldn't be there already
 
 	return !_tbdset.Remove(t2, d2);
@@ -222,22 +302,24 @@ static inline bool CheckAddToTodoSet(TileIndex t1, DiagDirection d1, TileIndex t
 
 /**
  * Perform some operations before adding data into Todo set
- * The new and reverse direction is removed from Global set, because we are sure
- * it doesn't need to be checked again
+ * The side we are leaving is added to the places of the block
  * Also, remove reverse direction from Todo set
  * This is the 'core' part so the graph searching won't enter any tile twice
  *
+ * @param block block we are searching
  * @param t1 tile we are entering
  * @param d1 direction (tile side) we are entering
  * @param t2 tile we are leaving
  * @param d2 direction (tile side) we are leaving
- * @return false iff the Todo buffer would be overrun
  */
-static inline bool MaybeAddToTodoSet(TileIndex t1, DiagDirection d1, TileIndex t2, DiagDirection d2)
+static inline void MaybeAddToTodoSet(SignalBlock &block, TileIndex t1, DiagDirection d1, TileIndex t2, DiagDirection d2)
 {
-	if (!CheckAddToTodoSet(t1, d1, t2, d2)) return true;
+	block.keys.push_back(SignalBlockKey(t2, d2));
+	block.entered.push_back(SignalBlockKey(t1, d1));
 
-	return _tbdset.Add(t1, d1);
+	if (!CheckAddToTodoSet(t1, d1, t2, d2)) return;
+
+	_tbdset.Add(t1, d1);
 }
 
 
@@ -249,7 +331,6 @@ enum SigFlags {
 	SF_EXIT2  = 1 << 2, ///< two or more exits found
 	SF_GREEN  = 1 << 3, ///< green exitsignal found
 	SF_GREEN2 = 1 << 4, ///< two or more green exits found
-	SF_FULL   = 1 << 5, ///< some of buffers was full, do not continue
 	SF_PBS    = 1 << 6, ///< pbs signal found
 };
 
@@ -257,14 +338,14 @@ DECLARE_ENUM_AS_BIT_SET(SigFlags)
 
 
 /**
- * Search signal block
+ * Search signal block, starting at the places in _tbdset
  *
  * @param owner owner whose signals we are updating
- * @return SigFlags
+ * @param[out] block the layout of the found block
  */
-static SigFlags ExploreSegment(Owner owner)
+static void ExploreSegment(Owner owner, SignalBlock &block)
 {
-	SigFlags flags = SF_NONE;
+	block.owner = owner;
 
 	TileIndex tile = INVALID_TILE; // Stop GCC from complaining about a possibly uninitialized variable (issue #8280).
 	DiagDirection enterdir = INVALID_DIAGDIR;
@@ -279,13 +360,16 @@ static SigFlags ExploreSegment(Owner owner)
 
 				if (IsRailDepot(tile)) {
 					if (enterdir == INVALID_DIAGDIR) { // from 'inside' - train just entered or left the depot
-						if (!(flags & SF_TRAIN) && HasVehicleOnPos(tile, nullptr, &TrainOnTileEnum)) flags |= SF_TRAIN;
+						block.tiles.push_back({ tile, TRACK_BIT_NONE });
+						block.keys.push_back(SignalBlockKey(tile, INVALID_DIAGDIR));
 						exitdir = GetRailDepotDirection(tile);
 						tile += TileOffsByDiagDir(exitdir);
 						enterdir = ReverseDiagDir(exitdir);
 						break;
 					} else if (enterdir == GetRailDepotDirection(tile)) { // entered a depot
-						if (!(flags & SF_TRAIN) && HasVehicleOnPos(tile, nullptr, &TrainOnTileEnum)) flags |= SF_TRAIN;
+						block.tiles.push_back({ tile, TRACK_BIT_NONE });
+						block.keys.push_back(SignalBlockKey(tile, enterdir));
+						block.keys.push_back(SignalBlockKey(tile, INVALID_DIAGDIR));
 						continue;
 					} else {
 						continue;
@@ -298,12 +382,12 @@ static SigFlags ExploreSegment(Owner owner)
 
 				if (tracks == TRACK_BIT_HORZ || tracks == TRACK_BIT_VERT) { // there is exactly one incidating track, no need to check
 					tracks = tracks_masked;
-					/* If no train detected yet, and there is not no train -> there is a train -> set the flag */
-					if (!(flags & SF_TRAIN) && EnsureNoTrainOnTrackBits(tile, tracks).Failed()) flags |= SF_TRAIN;
+					block.tiles.push_back({ tile, tracks });
 				} else {
 					if (tracks_masked == TRACK_BIT_NONE) continue; // no incidating track
-					if (!(flags & SF_TRAIN) && HasVehicleOnPos(tile, nullptr, &TrainOnTileEnum)) flags |= SF_TRAIN;
+					block.tiles.push_back({ tile, TRACK_BIT_NONE });
 				}
+				block.keys.push_back(SignalBlockKey(tile, enterdir));
 
 				if (HasSignals(tile)) { // there is exactly one track - not zero, because there is exit from this tile
 					Track track = TrackBitsToTrack(tracks_masked); // mask TRACK_BIT_X and Y too
@@ -316,22 +400,15 @@ static SigFlags ExploreSegment(Owner owner)
 						 * (if it is a presignal EXIT and it changes, it will be added to 'to-be-done' set later) */
 						if (HasSignalOnTrackdir(tile, reversedir)) {
 							if (IsPbsSignal(sig)) {
-								flags |= SF_PBS;
-							} else if (!_tbuset.Add(tile, reversedir)) {
-								return flags | SF_FULL;
-							}
-						}
-						if (HasSignalOnTrackdir(tile, trackdir) && !IsOnewaySignal(tile, track)) flags |= SF_PBS;
-
-						/* if it is a presignal EXIT in OUR direction and we haven't found 2 green exits yes, do special check */
-						if (!(flags & SF_GREEN2) && IsPresignalExit(tile, track) && HasSignalOnTrackdir(tile, trackdir)) { // found presignal exit
-							if (flags & SF_EXIT) flags |= SF_EXIT2; // found two (or more) exits
-							flags |= SF_EXIT; // found at least one exit - allow for compiler optimizations
-							if (GetSignalStateByTrackdir(tile, trackdir) == SIGNAL_STATE_GREEN) { // found green presignal exit
-								if (flags & SF_GREEN) flags |= SF_GREEN2;
-								flags |= SF_GREEN;
+								block.pbs = true;
+							} else {
+								block.signals.push_back({ tile, reversedir });
 							}
 						}
+						if (HasSignalOnTrackdir(tile, trackdir) && !IsOnewaySignal(tile, track)) block.pbs = true;
+
+						/* if it is a presignal EXIT in OUR direction, its state decides about the entries */
+						if (IsPresignalExit(tile, track) && HasSignalOnTrackdir(tile, trackdir)) block.exits.push_back({ tile, trackdir });
 
 						continue;
 					}
@@ -341,7 +418,7 @@ static SigFlags ExploreSegment(Owner owner)
 					if (dir != enterdir && (tracks & _enterdir_to_trackbits[dir])) { // any track incidating?
 						TileIndex newtile = tile + TileOffsByDiagDir(dir);  // new tile to check
 						DiagDirection newdir = ReverseDiagDir(dir); // direction we are entering from
-						if (!MaybeAddToTodoSet(newtile, newdir, tile, dir)) return flags | SF_FULL;
+						MaybeAddToTodoSet(block, newtile, newdir, tile, dir);
 					}
 				}
 
@@ -354,7 +431,8 @@ static SigFlags ExploreSegment(Owner owner)
 				if (DiagDirToAxis(enterdir) != GetRailStationAxis(tile)) continue; // different axis
 				if (IsStationTileBlocked(tile)) continue; // 'eye-candy' station tile
 
-				if (!(flags & SF_TRAIN) && HasVehicleOnPos(tile, nullptr, &TrainOnTileEnum)) flags |= SF_TRAIN;
+				block.tiles.push_back({ tile, TRACK_BIT_NONE });
+				block.keys.push_back(SignalBlockKey(tile, enterdir));
 				tile += TileOffsByDiagDir(exitdir);
 				break;
 
@@ -363,7 +441,8 @@ static SigFlags ExploreSegment(Owner owner)
 				if (GetTileOwner(tile) != owner) continue;
 				if (DiagDirToAxis(enterdir) == GetCrossingRoadAxis(tile)) continue; // different axis
 
-				if (!(flags & SF_TRAIN) && HasVehicleOnPos(tile, nullptr, &TrainOnTileEnum)) flags |= SF_TRAIN;
+				block.tiles.push_back({ tile, TRACK_BIT_NONE });
+				block.keys.push_back(SignalBlockKey(tile, enterdir));
 				tile += TileOffsByDiagDir(exitdir);
 				break;
 
@@ -373,13 +452,15 @@ static SigFlags ExploreSegment(Owner owner)
 				DiagDirection dir = GetTunnelBridgeDirection(tile);
 
 				if (enterdir == INVALID_DIAGDIR) { // incoming from the wormhole
-					if (!(flags & SF_TRAIN) && HasVehicleOnPos(tile, nullptr, &TrainOnTileEnum)) flags |= SF_TRAIN;
+					block.tiles.push_back({ tile, TRACK_BIT_NONE });
+					block.keys.push_back(SignalBlockKey(tile, enterdir));
 					enterdir = dir;
 					exitdir = ReverseDiagDir(dir);
 					tile += TileOffsByDiagDir(exitdir); // just skip to next tile
 				} else { // NOT incoming from the wormhole!
 					if (ReverseDiagDir(enterdir) != dir) continue;
-					if (!(flags & SF_TRAIN) && HasVehicleOnPos(tile, nullptr, &TrainOnTileEnum)) flags |= SF_TRAIN;
+					block.tiles.push_back({ tile, TRACK_BIT_NONE });
+					block.keys.push_back(SignalBlockKey(tile, enterdir));
 					tile = GetOtherTunnelBridgeEnd(tile); // just skip to exit tile
 					enterdir = INVALID_DIAGDIR;
 					exitdir = INVALID_DIAGDIR;
@@ -391,7 +472,41 @@ static SigFlags ExploreSegment(Owner owner)
 				continue; // continue the while() loop
 		}
 
-		if (!MaybeAddToTodoSet(tile, enterdir, oldtile, exitdir)) return flags | SF_FULL;
+		MaybeAddToTodoSet(block, tile, enterdir, oldtile, exitdir);
+	}
+
+	block.Sort();
+}
+
+
+/**
+ * Determine the state of a signal block from its layout
+ *
+ * @param block the block
+ * @return SigFlags
+ */
+static SigFlags GetSignalBlockFlags(const SignalBlock &block)
+{
+	SigFlags flags = block.pbs ? SF_PBS : SF_NONE;
+
+	for (const SignalBlockTile &t : block.tiles) {
+		bool train = (t.tracks == TRACK_BIT_NONE) ? HasVehicleOnPos(t.tile, nullptr, &TrainOnTileEnum) : EnsureNoTrainOnTrackBits(t.tile, t.tracks).Failed();
+		if (train) {
+			flags |= SF_TRAIN;
+			break;
+		}
+	}
+
+	for (const SignalBlockSignal &exit : block.exits) {
+		if (flags & SF_EXIT) flags |= SF_EXIT2; // found two (or more) exits
+		flags |= SF_EXIT; // found at least one exit - allow for compiler optimizations
+		if (GetSignalStateByTrackdir(exit.tile, exit.trackdir) == SIGNAL_STATE_GREEN) { // found green presignal exit
+			if (flags & SF_GREEN) {
+				flags |= SF_GREEN2;
+				break;
+			}
+			flags |= SF_GREEN;
+		}
 	}
 
 	return flags;
@@ -399,16 +514,53 @@ static SigFlags ExploreSegment(Owner owner)
 
 
 /**
- * Update signals around segment in _tbuset
+ * Find the signal block that contains the places in _tbdset, searching
+ * the tracks only when the block isn't known yet
  *
- * @param flags info about segment
+ * @param owner owner whose signals we are updating
+ * @param scratch block to use when the found block must not be kept
+ * @return the block
  */
-static void UpdateSignalsAroundSegment(SigFlags flags)
+static const SignalBlock &FindSignalBlock(Owner owner, SignalBlock &scratch)
 {
-	TileIndex tile = INVALID_TILE; // Stop GCC from complaining about a possibly uninitialized variable (issue #8280).
-	Trackdir trackdir = INVALID_TRACKDIR;
+	if (!_signal_layout_changing) {
+		for (uint i = 0; i < _tbdset.Items(); i++) {
+			TileIndex tile;
+			DiagDirection dir;
+			_tbdset.Peek(i, &tile, &dir);
+			auto it = _signal_block_index.find(SignalBlockIndexKey(SignalBlockKey(tile, dir), owner));
+			if (it != _signal_block_index.end()) {
+				_tbdset.Reset();
+				return _signal_blocks[it->second];
+			}
+		}
+	}
+
+	scratch = {};
+	ExploreSegment(owner, scratch);
+	if (_signal_layout_changing || scratch.keys.empty()) return scratch;
+
+	/* Keep the memory bounded on huge networks; forgotten blocks are found again when needed. */
+	if (_signal_blocks.size() >= MAX_SIGNAL_BLOCKS) InvalidateSignalBlocks();
+
+	uint index = (uint)_signal_blocks.size();
+	for (uint64 key : scratch.keys) _signal_block_index[SignalBlockIndexKey(key, owner)] = index;
+	_signal_blocks.push_back(std::move(scratch));
+	return _signal_blocks.back();
+}
+
 
-	while (_tbuset.Get(&tile, &trackdir)) {
+/**
+ * Update signals around segment
+ *
+ * @param block layout of the segment
+ * @param flags info about segment
+ */
+static void UpdateSignalsAroundSegment(const SignalBlock &block, SigFlags flags)
+{
+	for (const SignalBlockSignal &signal : block.signals) {
+		TileIndex tile = signal.tile;
+		Trackdir trackdir = signal.trackdir;
 		assert(HasSignalOnTrackdir(tile, trackdir));
 
 		SignalType sig = GetSignalType(tile, TrackdirToTrack(trackdir));
@@ -439,7 +591,7 @@ static void UpdateSignalsAroundSegment(SigFlags flags)
 			if (IsPresignalExit(tile, TrackdirToTrack(trackdir))) {
 				/* for pre-signal exits, add block to the global set */
 				DiagDirection exitdir = TrackdirToExitdir(ReverseTrackdir(trackdir));
-				_globset.Add(tile, exitdir); // do not check for full global set, first update all signals
+				_globset.Add(tile, exitdir);
 			}
 			SetSignalStateByTrackdir(tile, trackdir, newstate);
 			MarkTileDirtyByTile(tile);
@@ -449,12 +601,23 @@ static void UpdateSignalsAroundSegment(SigFlags flags)
 }
 
 
-/** Reset all sets after one set overflowed */
-static inline void ResetSets()
+/**
+ * Remove the places of a block and the places its search entered from _globset, they are up to date now
+ *
+ * @param block the block
+ */
+static void RemoveSignalBlockFromBuffer(const SignalBlock &block)
 {
-	_tbuset.Reset();
-	_tbdset.Reset();
-	_globset.Reset();
+	for (uint i = 0; i < _globset.Items();) {
+		TileIndex tile;
+		DiagDirection dir;
+		_globset.Peek(i, &tile, &dir);
+		if (block.HasVisited(tile, dir)) {
+			_globset.Remove(tile, dir);
+		} else {
+			i++;
+		}
+	}
 }
 
 
@@ -474,9 +637,9 @@ static SigSegState UpdateSignalsInBuffer(Owner owner)
 
 	TileIndex tile = INVALID_TILE; // Stop GCC from complaining about a possibly uninitialized variable (issue #8280).
 	DiagDirection dir = INVALID_DIAGDIR;
+	SignalBlock scratch;
 
 	while (_globset.Get(&tile, &dir)) {
-		assert(_tbuset.IsEmpty());
 		assert(_tbdset.IsEmpty());
 
 		/* After updating signal, data stored are always MP_RAILWAY with signals.
@@ -524,28 +687,23 @@ static SigSegState UpdateSignalsInBuffer(Owner owner)
 				continue; // continue the while() loop
 		}
 
-		assert(!_tbdset.Overflowed()); // it really shouldn't overflow by these one or two items
 		assert(!_tbdset.IsEmpty()); // it wouldn't hurt anyone, but shouldn't happen too
 
-		SigFlags flags = ExploreSegment(owner);
+		const SignalBlock &block = FindSignalBlock(owner, scratch);
+		SigFlags flags = GetSignalBlockFlags(block);
 
 		if (first) {
 			first = false;
 			/* SIGSEG_FREE is set by default */
 			if (flags & SF_PBS) {
 				state = SIGSEG_PBS;
-			} else if ((flags & SF_TRAIN) || ((flags & SF_EXIT) && !(flags & SF_GREEN)) || (flags & SF_FULL)) {
+			} else if ((flags & SF_TRAIN) || ((flags & SF_EXIT) && !(flags & SF_GREEN))) {
 				state = SIGSEG_FULL;
 			}
 		}
 
-		/* do not do anything when some buffer was full */
-		if (flags & SF_FULL) {
-			ResetSets(); // free all sets
-			break;
-		}
-
-		UpdateSignalsAroundSegment(flags);
+		RemoveSignalBlockFromBuffer(block);
+		UpdateSignalsAroundSegment(block, flags);
 	}
 
 	return state;
@@ -565,17 +723,20 @@ void UpdateSignalsInBuffer()
 		UpdateSignalsInBuffer(_last_owner);
 		_last_owner = INVALID_OWNER; // invalidate
 	}
+
+	/* The changes to the track layout are done, so blocks can be kept again. */
+	_signal_layout_changing = false;
 }
 
 
 /**
- * Add track to signal update buffer
+ * Add track to signal update buffer, without changing the track layout
  *
  * @param tile tile where we start
  * @param track track at which ends we will update signals
  * @param owner owner whose signals we will update
  */
-void AddTrackToSignalBuffer(TileIndex tile, Track track, Owner owner)
+static void AddTrackToSignalBufferInternal(TileIndex tile, Track track, Owner owner)
 {
 	static const DiagDirection _search_dir_1[] = {
 		DIAGDIR_NE, DIAGDIR_SE, DIAGDIR_NE, DIAGDIR_SE, DIAGDIR_SW, DIAGDIR_SE
@@ -600,8 +761,28 @@ void AddTrackToSignalBuffer(TileIndex tile, Track track, Owner owner)
 }
 
 
+/**
+ * Add track to signal update buffer
+ * The track layout around the track changed, so the known signal blocks are
+ * forgotten, and no blocks are kept until the buffer is updated from 'outside'.
+ *
+ * @param tile tile where we start
+ * @param track track at which ends we will update signals
+ * @param owner owner whose signals we will update
+ */
+void AddTrackToSignalBuffer(TileIndex tile, Track track, Owner owner)
+{
+	InvalidateSignalBlocks();
+	_signal_layout_changing = true;
+
+	AddTrackToSignalBufferInternal(tile, track, owner);
+}
+
+
 /**
  * Add side of tile to signal update buffer
+ * The track layout around the side changed, so the known signal blocks are
+ * forgotten, and no blocks are kept until the buffer is updated from 'outside'.
  *
  * @param tile tile where we start
  * @param side side of tile
@@ -609,6 +790,9 @@ void AddTrackToSignalBuffer(TileIndex tile, Track track, Owner owner)
  */
 void AddSideToSignalBuffer(TileIndex tile, DiagDirection side, Owner owner)
 {
+	InvalidateSignalBlocks();
+	_signal_layout_changing = true;
+
 	/* do not allow signal updates for two companies in one run */
 	assert(_globset.IsEmpty() || owner == _last_owner);
 
@@ -655,6 +839,37 @@ void SetSignalsOnBothDir(TileIndex tile, Track track, Owner owner)
 {
 	assert(_globset.IsEmpty());
 
-	AddTrackToSignalBuffer(tile, track, owner);
+	AddTrackToSignalBufferInternal(tile, track, owner);
 	UpdateSignalsInBuffer(owner);
 }
+
+
+/**
+ * Check whether the known signal blocks are the same as the blocks
+ * that are found by searching the tracks again.
+ */
+void CheckSignalBlocks()
+{
+	assert(_tbdset.IsEmpty());
+
+	for (const SignalBlock &block : _signal_blocks) {
+		if (!Company::IsValidID(block.owner)) continue;
+
+		/* Start at a side of a tile, or the inside of a depot or tunnel, like UpdateSignalsInBuffer does. */
+		TileIndex tile = (TileIndex)(uint32)(block.keys.front() >> 8);
+		DiagDirection dir = (DiagDirection)(block.keys.front() & 0xFF);
+		if (dir == INVALID_DIAGDIR) {
+			_tbdset.Add(tile, INVALID_DIAGDIR);
+			if (IsTileType(tile, MP_TUNNELBRIDGE)) _tbdset.Add(GetOtherTunnelBridgeEnd(tile), INVALID_DIAGDIR);
+		} else {
+			_tbdset.Add(tile, dir);
+			_tbdset.Add(tile + TileOffsByDiagDir(dir), ReverseDiagDir(dir));
+		}
+
+		SignalBlock fresh;
+		ExploreSegment(block.owner, fresh);
+		if (!(fresh == block)) {
+			Debug(desync, 2, "signal block mismatch: tile {}, side {}", static_cast<uint32>(tile), (int)dir);
+		}
+	}
+}
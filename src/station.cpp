@@ -35,6 +35,9 @@
 StationPool _station_pool("Station");
 INSTANTIATE_POOL_METHODS(Station)
 
+/* static */ std::set<StationID> Station::loading_stations;
+/* static */ std::unordered_map<uint32, std::vector<StationID>> Station::catchment_index;
+
 
 StationKdtree _station_kdtree(Kdtree_StationXYFunc);
 
@@ -86,6 +89,8 @@ Station::~Station()
 		for (CargoID c = 0; c < NUM_CARGO; c++) {
 			this->goods[c].cargo.OnCleanPool();
 		}
+		Station::loading_stations.clear();
+		Station::catchment_index.clear();
 		return;
 	}
 
@@ -129,6 +134,7 @@ Station::~Station()
 
 	/* Remove station from industries and towns that reference it. */
 	this->RemoveFromAllNearbyLists();
+	this->RemoveFromCatchmentIndex();
 
 	/* Clear the persistent storage. */
 	delete this->airport.psa;
@@ -159,6 +165,37 @@ Station::~Station()
 }
 
 
+/**
+ * Add a vehicle to the end of the queue of vehicles loading at this station.
+ * @param v The vehicle that starts loading.
+ */
+void Station::AddLoadingVehicle(Vehicle *v)
+{
+	this->loading_vehicles.push_back(v);
+	Station::loading_stations.insert(this->index);
+}
+
+/**
+ * Remove a vehicle from the queue of vehicles loading at this station.
+ * @param v The vehicle that stops loading.
+ */
+void Station::RemoveLoadingVehicle(Vehicle *v)
+{
+	this->loading_vehicles.remove(v);
+	if (this->loading_vehicles.empty()) Station::loading_stations.erase(this->index);
+}
+
+/**
+ * Rebuild the set of stations with loading vehicles, after loading a savegame.
+ */
+/* static */ void Station::RebuildLoadingStations()
+{
+	Station::loading_stations.clear();
+	for (const Station *st : Station::Iterate()) {
+		if (!st->loading_vehicles.empty()) Station::loading_stations.insert(st->index);
+	}
+}
+
 /**
  * Invalidating of the JoinStation window has to be done
  * after removing item from the pool.
@@ -451,6 +488,40 @@ bool Station::CatchmentCoversTown(TownID t) const
 	return false;
 }
 
+/**
+ * Add this station to the catchment index for all tiles of its catchment.
+ */
+void Station::AddToCatchmentIndex()
+{
+	if (this->catchment_tiles.tile == INVALID_TILE) return;
+
+	BitmapTileIterator it(this->catchment_tiles);
+	for (TileIndex tile = it; tile != INVALID_TILE; tile = ++it) {
+		std::vector<StationID> &stations = Station::catchment_index[static_cast<uint32>(tile)];
+		auto pos = std::lower_bound(stations.begin(), stations.end(), this->index);
+		if (pos == stations.end() || *pos != this->index) stations.insert(pos, this->index);
+	}
+}
+
+/**
+ * Remove this station from the catchment index for all tiles of its catchment.
+ */
+void Station::RemoveFromCatchmentIndex()
+{
+	if (this->catchment_tiles.tile == INVALID_TILE) return;
+
+	BitmapTileIterator it(this->catchment_tiles);
+	for (TileIndex tile = it; tile != INVALID_TILE; tile = ++it) {
+		auto found = Station::catchment_index.find(static_cast<uint32>(tile));
+		if (found == Station::catchment_index.end()) continue;
+
+		std::vector<StationID> &stations = found->second;
+		auto pos = std::lower_bound(stations.begin(), stations.end(), this->index);
+		if (pos != stations.end() && *pos == this->index) stations.erase(pos);
+		if (stations.empty()) Station::catchment_index.erase(found);
+	}
+}
+
 /**
  * Recompute tiles covered in our catchment area.
  * This will additionally recompute nearby towns and industries.
@@ -460,6 +531,7 @@ void Station::RecomputeCatchment(bool no_clear_nearby_lists)
 {
 	this->industries_near.clear();
 	if (!no_clear_nearby_lists) this->RemoveFromAllNearbyLists();
+	this->RemoveFromCatchmentIndex();
 
 	if (this->rect.IsEmpty()) {
 		this->catchment_tiles.Reset();
@@ -474,6 +546,7 @@ void Station::RecomputeCatchment(bool no_clear_nearby_lists)
 				this->catchment_tiles.SetTile(tile);
 			}
 		}
+		this->AddToCatchmentIndex();
 		/* The industry's stations_near may have been computed before its neutral station was built so clear and re-add here. */
 		for (Station *st : this->industry->stations_near) {
 			st->RemoveIndustryToDeliver(this->industry);
@@ -498,6 +571,7 @@ void Station::RecomputeCatchment(bool no_clear_nearby_lists)
 		TileArea ta2 = TileArea(tile, 1, 1).Expand(r);
 		for (TileIndex tile2 : ta2) this->catchment_tiles.SetTile(tile2);
 	}
+	this->AddToCatchmentIndex();
 
 	/* Search catchment tiles for towns and industries */
 	BitmapTileIterator it(this->catchment_tiles);
@@ -528,6 +602,7 @@ void Station::RecomputeCatchment(bool no_clear_nearby_lists)
 {
 	for (Town *t : Town::Iterate()) { t->stations_near.clear(); }
 	for (Industry *i : Industry::Iterate()) { i->stations_near.clear(); }
+	Station::catchment_index.clear();
 	for (Station *st : Station::Iterate()) { st->RecomputeCatchment(true); }
 }
 
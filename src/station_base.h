@@ -18,28 +18,31 @@
 #include "linkgraph/linkgraph_type.h"
 #include "newgrf_storage.h"
 #include "bitmap_type.h"
+#include "core/flatmap_type.hpp"
 #include <map>
 #include <set>
+#include <unordered_map>
 
 static const byte INITIAL_STATION_RATING = 175;
 
 /**
  * Flow statistics telling how much flow should be sent along a link. This is
- * done by creating "flow shares" and using std::map's upper_bound() method to
+ * done by creating "flow shares" and using the map's upper_bound() method to
  * look them up with a random number. A flow share is the difference between a
  * key in a map and the previous key. So one key in the map doesn't actually
- * mean anything by itself.
+ * mean anything by itself. The shares are looked up for every routed cargo
+ * packet, so they are kept in a sorted vector rather than a tree.
  */
 class FlowStat {
 public:
-	typedef std::map<uint32, StationID> SharesMap;
+	typedef FlatMap<uint32, StationID> SharesMap;
 
 	static const SharesMap empty_sharesmap;
 
 	/**
 	 * Invalid constructor. This can't be called as a FlowStat must not be
 	 * empty. However, the constructor must be defined and reachable for
-	 * FlowStat to be used in a std::map.
+	 * FlowStat to be used in a map.
 	 */
 	inline FlowStat() {NOT_REACHED();}
 
@@ -145,8 +148,8 @@ private:
 	uint unrestricted; ///< Limit for unrestricted shares.
 };
 
-/** Flow descriptions by origin stations. */
-class FlowStatMap : public std::map<StationID, FlowStat> {
+/** Flow descriptions by origin stations, in ascending order of the origins. */
+class FlowStatMap : public FlatMap<StationID, FlowStat> {
 public:
 	uint GetFlow() const;
 	uint GetFlowVia(StationID via) const;
@@ -217,7 +220,8 @@ struct GoodsEntry {
 		amount_fract(0),
 		link_graph(INVALID_LINK_GRAPH),
 		node(INVALID_NODE),
-		max_waiting_cargo(0)
+		max_waiting_cargo(0),
+		settled_rating()
 	{}
 
 	byte status; ///< Status of this cargo, see #GoodsEntryStatus.
@@ -256,6 +260,24 @@ struct GoodsEntry {
 	FlowStatMap flows;      ///< Planned flows through this station.
 	uint max_waiting_cargo; ///< Max cargo from this station waiting at any station.
 
+	/**
+	 * Inputs of the station rating for which the rating no longer changes.
+	 * As long as they stay the same, updating the rating only increases
+	 * #time_since_pickup. (NOSAVE)
+	 */
+	struct SettledRating {
+		uint waiting;           ///< Available cargo at the station.
+		uint num_dests;         ///< Number of next hops of the waiting cargo.
+		uint max_waiting_cargo; ///< Value of #max_waiting_cargo.
+		byte rating;            ///< The settled rating.
+		byte last_speed;        ///< Value of #last_speed.
+		byte last_age;          ///< Value of #last_age.
+		byte min_pickup;        ///< Lowest #time_since_pickup giving the same rating.
+		byte max_pickup;        ///< Highest #time_since_pickup giving the same rating, or 0 if the rating did not settle.
+		bool ship;              ///< Whether the last vehicle at the station was a ship.
+		bool statue;            ///< Whether the owner of the station has a statue in its town.
+	} settled_rating;
+
 	/**
 	 * Reports whether a vehicle has ever tried to load the cargo at this station.
 	 * This does not imply that there was cargo available for loading. Refer to GES_RATING for that.
@@ -479,18 +501,25 @@ public:
 	byte time_since_unload;
 
 	byte last_vehicle_type;
-	std::list<Vehicle *> loading_vehicles;
+	std::list<Vehicle *> loading_vehicles; ///< Vehicles loading or unloading at this station, in order of arrival. Only change it with #AddLoadingVehicle and #RemoveLoadingVehicle.
 	GoodsEntry goods[NUM_CARGO];  ///< Goods at this station
 	CargoTypes always_accepted;       ///< Bitmask of always accepted cargo types (by houses, HQs, industry tiles when industry doesn't accept cargo)
 
 	IndustryList industries_near; ///< Cached list of industries near the station that can accept cargo, @see DeliverGoodsToIndustry()
 	Industry *industry;           ///< NOSAVE: Associated industry for neutral stations. (Rebuilt on load from Industry->st)
 
+	static std::set<StationID> loading_stations; ///< NOSAVE: Stations with vehicles loading or unloading, in order of their index.
+	static std::unordered_map<uint32, std::vector<StationID>> catchment_index; ///< NOSAVE: Stations whose #catchment_tiles cover a tile, in order of their index, for each covered tile.
+
 	Station(TileIndex tile = INVALID_TILE);
 	~Station();
 
 	void AddFacility(StationFacility new_facility_bit, TileIndex facil_xy);
 
+	void AddLoadingVehicle(Vehicle *v);
+	void RemoveLoadingVehicle(Vehicle *v);
+	static void RebuildLoadingStations();
+
 	void MarkTilesDirty(bool cargo_change) const;
 
 	void UpdateVirtCoord() override;
@@ -504,12 +533,25 @@ public:
 	void RecomputeCatchment(bool no_clear_nearby_lists = false);
 	static void RecomputeCatchmentForAll();
 
+	/**
+	 * Get the stations whose catchment covers a tile.
+	 * @param tile The tile to look up.
+	 * @return The IDs of the stations in ascending order, or nullptr if no station covers the tile.
+	 */
+	static inline const std::vector<StationID> *GetCoveringStations(TileIndex tile)
+	{
+		auto it = Station::catchment_index.find(static_cast<uint32>(tile));
+		return it == Station::catchment_index.end() ? nullptr : &it->second;
+	}
+
 	uint GetCatchmentRadius() const;
 	Rect GetCatchmentRect() const;
 	bool CatchmentCoversTown(TownID t) const;
 	void AddIndustryToDeliver(Industry *ind, TileIndex tile);
 	void RemoveIndustryToDeliver(Industry *ind);
 	void RemoveFromAllNearbyLists();
+	void AddToCatchmentIndex();
+	void RemoveFromCatchmentIndex();
 
 	inline bool TileIsInCatchment(TileIndex tile) const
 	{
@@ -581,20 +623,15 @@ void ForAllStationsAroundTiles(const TileArea &ta, Func func)
 	/* There are no stations, so we will never find anything. */
 	if (Station::GetNumItems() == 0) return;
 
-	/* Not using, or don't have a nearby stations list, so we need to scan. */
+	/* Look up the stations covering any of the tiles in the catchment index. */
 	std::set<StationID> seen_stations;
-
-	/* Scan an area around the building covering the maximum possible station
-	 * to find the possible nearby stations. */
-	uint max_c = _settings_game.station.modified_catchment ? MAX_CATCHMENT : CA_UNMODIFIED;
-	TileArea ta_ext = TileArea(ta).Expand(max_c);
-	for (TileIndex tile : ta_ext) {
-		if (IsTileType(tile, MP_STATION)) seen_stations.insert(GetStationIndex(tile));
+	for (TileIndex tile : ta) {
+		const std::vector<StationID> *stations = Station::GetCoveringStations(tile);
+		if (stations != nullptr) seen_stations.insert(stations->begin(), stations->end());
 	}
 
 	for (StationID stationid : seen_stations) {
-		Station *st = Station::GetIfValid(stationid);
-		if (st == nullptr) continue; /* Waypoint */
+		Station *st = Station::Get(stationid);
 
 		/* Check if station is attached to an industry */
 		if (!_settings_game.station.serve_neutral_industries && st->industry != nullptr) continue;
@@ -24,6 +24,7 @@
 #include "newgrf_station.h"
 #include "newgrf_canal.h" /* For the buoy */
 #include "pathfinder/yapf/yapf_cache.h"
+#include "pathfinder/water_regions.h"
 #include "road_internal.h" /* For drawing catenary/checking road removal */
 #include "autoslope.h"
 #include "water.h"
@@ -2056,6 +2057,7 @@ CommandCost CmdBuildRoadStop(DoCommandFlag flags, TileIndex tile, uint8 width, u
 			}
 
 			MarkTileDirtyByTile(cur_tile);
+			YapfNotifyRoadLayoutChange(cur_tile);
 		}
 
 		if (st != nullptr) {
@@ -2160,6 +2162,7 @@ static CommandCost RemoveRoadStop(TileIndex tile, DoCommandFlag flags, int repla
 		} else {
 			DoClearSquare(tile);
 		}
+		YapfNotifyRoadLayoutChange(tile);
 
 		delete cur_stop;
 
@@ -2249,6 +2252,7 @@ CommandCost CmdRemoveRoadStop(DoCommandFlag flags, TileIndex tile, uint8 width,
 		if ((flags & DC_EXEC) && (road_type[RTT_ROAD] != INVALID_ROADTYPE || road_type[RTT_TRAM] != INVALID_ROADTYPE)) {
 			MakeRoadNormal(cur_tile, road_bits, road_type[RTT_ROAD], road_type[RTT_TRAM], ClosestTownFromTile(cur_tile, UINT_MAX)->index,
 					road_owner[RTT_ROAD], road_owner[RTT_TRAM]);
+			YapfNotifyRoadLayoutChange(cur_tile);
 
 			/* Update company infrastructure counts. */
 			int count = CountBits(road_bits);
@@ -2700,6 +2704,8 @@ CommandCost CmdBuildDock(DoCommandFlag flags, TileIndex tile, StationID station_
 
 		MakeDock(tile, st->owner, st->index, direction, wc);
 		UpdateStationDockingTiles(st);
+		InvalidateWaterRegion(tile);
+		InvalidateWaterRegion(tile + TileOffsByDiagDir(direction));
 
 		st->AfterStationTileSetChange(true, STATION_DOCK);
 	}
@@ -3609,6 +3615,50 @@ static void TruncateCargo(const CargoSpec *cs, GoodsEntry *ge, uint amount = UIN
 	}
 }
 
+/**
+ * Get the range of times since the last pickup that give the same bonus to
+ * the station rating as the given one.
+ * @param time_since_pickup Time since the last pickup.
+ * @param ship Whether the last vehicle at the station was a ship.
+ * @return Lowest and highest time since the last pickup in the range.
+ */
+static std::pair<byte, byte> GetPickupRatingRange(byte time_since_pickup, bool ship)
+{
+	static const uint limits[] = { 3, 6, 12, 21, 255 };
+	uint shift = ship ? 2 : 0;
+	uint waittime = time_since_pickup >> shift;
+	uint low = 0;
+	for (uint limit : limits) {
+		if (waittime <= limit) return { low << shift, std::min(((limit + 1) << shift) - 1, 255U) };
+		low = limit + 1;
+	}
+	NOT_REACHED();
+}
+
+/**
+ * Check whether the rating of a cargo settled and none of the inputs of the
+ * rating changed since, so the rating stays the same.
+ * @param st Station of the cargo.
+ * @param ge Goods entry of the cargo.
+ * @param cs Cargo type.
+ * @return True iff the rating does not have to be calculated.
+ */
+static bool IsStationRatingSettled(const Station *st, const GoodsEntry *ge, const CargoSpec *cs)
+{
+	const GoodsEntry::SettledRating &settled = ge->settled_rating;
+	return settled.max_pickup != 0 &&
+			ge->time_since_pickup >= settled.min_pickup && ge->time_since_pickup <= settled.max_pickup &&
+			ge->rating == settled.rating &&
+			ge->max_waiting_cargo == settled.max_waiting_cargo &&
+			ge->last_speed == settled.last_speed &&
+			ge->last_age == settled.last_age &&
+			ge->cargo.AvailableCount() == settled.waiting &&
+			ge->cargo.Packets()->MapSize() == settled.num_dests &&
+			(st->last_vehicle_type == VEH_SHIP) == settled.ship &&
+			(Company::IsValidID(st->owner) && HasBit(st->town->statues, st->owner)) == settled.statue &&
+			!HasBit(cs->callback_mask, CBM_CARGO_STATION_RATING_CALC);
+}
+
 static void UpdateStationRating(Station *st)
 {
 	bool waiting_changed = false;
@@ -3636,9 +3686,14 @@ static void UpdateStationRating(Station *st)
 				continue;
 			}
 
+			/* Nothing changes but the time since the last pickup, and that stays in the same range. */
+			if (IsStationRatingSettled(st, ge, cs)) continue;
+			ge->settled_rating.max_pickup = 0;
+
 			bool skip = false;
 			int rating = 0;
 			uint waiting = ge->cargo.AvailableCount();
+			uint max_waiting_cargo = ge->max_waiting_cargo;
 
 			/* num_dests is at least 1 if there is any cargo as
 			 * INVALID_STATION is also a destination.
@@ -3702,6 +3757,8 @@ static void UpdateStationRating(Station *st)
 			if (age < 1) rating += 13;
 
 			{
+				/* The rating settles when it reached its target and nothing but the rating is changed. */
+				bool settled = !HasBit(cs->callback_mask, CBM_CARGO_STATION_RATING_CALC) && Clamp(rating, 0, 255) == ge->rating;
 				int or_ = ge->rating; // old rating
 
 				/* only modify rating in steps of -2, -1, 0, 1 or 2 */
@@ -3710,6 +3767,7 @@ static void UpdateStationRating(Station *st)
 				/* if rating is <= 64 and more than 100 items waiting on average per destination,
 				 * remove some random amount of goods from the station */
 				if (rating <= 64 && waiting_avg >= 100) {
+					settled = false;
 					int dec = Random() & 0x1F;
 					if (waiting_avg < 200) dec &= 7;
 					waiting -= (dec + 1) * num_dests;
@@ -3718,6 +3776,7 @@ static void UpdateStationRating(Station *st)
 
 				/* if rating is <= 127 and there are any items waiting, maybe remove some goods. */
 				if (rating <= 127 && waiting != 0) {
+					settled = false;
 					uint32 r = Random();
 					if (rating <= (int)GB(r, 0, 7)) {
 						/* Need to have int, otherwise it will just overflow etc. */
@@ -3734,6 +3793,7 @@ static void UpdateStationRating(Station *st)
 				static const uint MAX_WAITING_CARGO        = 1 << 15;
 
 				if (waiting > WAITING_CARGO_THRESHOLD) {
+					settled = false;
 					uint difference = waiting - WAITING_CARGO_THRESHOLD;
 					waiting -= (difference / WAITING_CARGO_CUT_FACTOR);
 
@@ -3753,6 +3813,21 @@ static void UpdateStationRating(Station *st)
 					/* If the average number per next hop is low, be more forgiving. */
 					ge->max_waiting_cargo = waiting_avg;
 				}
+
+				/* The next updates don't change anything either, as long as
+				 * the inputs stay the same. */
+				if (settled && ge->max_waiting_cargo == max_waiting_cargo) {
+					GoodsEntry::SettledRating &s = ge->settled_rating;
+					s.waiting = waiting;
+					s.num_dests = num_dests;
+					s.max_waiting_cargo = max_waiting_cargo;
+					s.rating = ge->rating;
+					s.last_speed = ge->last_speed;
+					s.last_age = ge->last_age;
+					s.ship = st->last_vehicle_type == VEH_SHIP;
+					s.statue = Company::IsValidID(st->owner) && HasBit(st->town->statues, st->owner);
+					std::tie(s.min_pickup, s.max_pickup) = GetPickupRatingRange(ge->time_since_pickup, s.ship);
+				}
 			}
 		}
 	}
@@ -4120,13 +4195,6 @@ CommandCost CmdRenameStation(DoCommandFlag flags, StationID station_id, const st
 	return CommandCost();
 }
 
-static void AddNearbyStationsByCatchment(TileIndex tile, StationList *stations, StationList &nearby)
-{
-	for (Station *st : nearby) {
-		if (st->TileIsInCatchment(tile)) stations->insert(st);
-	}
-}
-
 /**
  * Run a tile loop to find stations around a tile, on demand. Cache the result for further requests
  * @return pointer to a StationList containing all stations found
@@ -4135,9 +4203,12 @@ const StationList *StationFinder::GetStations()
 {
 	if (this->tile != INVALID_TILE) {
 		if (IsTileType(this->tile, MP_HOUSE)) {
-			/* Town nearby stations need to be filtered per tile. */
+			/* Houses produce cargo often; look their tile up directly. */
 			assert(this->w == 1 && this->h == 1);
-			AddNearbyStationsByCatchment(this->tile, &this->stations, Town::GetByTile(this->tile)->stations_near);
+			const std::vector<StationID> *covering = Station::GetCoveringStations(this->tile);
+			if (covering != nullptr) {
+				for (StationID id : *covering) this->stations.insert(Station::Get(id));
+			}
 		} else {
 			ForAllStationsAroundTiles(*this, [this](Station *st, TileIndex tile) {
 				this->stations.insert(st);
@@ -4301,6 +4372,7 @@ void BuildOilRig(TileIndex tile)
 	st->industry->neutral_station = st;
 	DeleteAnimatedTile(tile);
 	MakeOilrig(tile, st->index, GetWaterClass(tile));
+	InvalidateWaterRegion(tile);
 
 	st->owner = OWNER_NONE;
 	st->airport.type = AT_OILRIG;
@@ -4826,7 +4898,7 @@ StationIDStack FlowStatMap::DeleteFlows(StationID via)
 		s_flows.ChangeShare(via, INT_MIN);
 		if (s_flows.GetShares()->empty()) {
 			ret.Push(f_it->first);
-			this->erase(f_it++);
+			f_it = this->erase(f_it);
 		} else {
 			++f_it;
 		}
@@ -4923,4 +4995,6 @@ extern const TileTypeProcs _tile_type_station_procs = {
 	VehicleEnter_Station,       // vehicle_enter_tile_proc
 	GetFoundation_Station,      // get_foundation_proc
 	TerraformTile_Station,      // terraform_tile_proc
+	nullptr,                    // plan_tile_loop_proc
+	nullptr,                    // commit_tile_loop_proc
 };
@@ -0,0 +1,353 @@
+/*
+ * This file is part of OpenTTD.
+ * OpenTTD is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, version 2.
+ * OpenTTD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file task_pool.cpp Implementation of the work-stealing pool of task threads. */
+
+#include "stdafx.h"
+#include "thread.h"
+#include "task_pool.h"
+#include <deque>
+#include <memory>
+#include <vector>
+
+#include "safeguards.h"
+
+static const uint MAX_TASK_THREADS = 64; ///< Maximum number of task threads in the pool.
+
+uint _task_pool_threads; ///< Number of task threads to start, or 0 to pick one less than the number of cores, but at least one.
+
+/** A function to run on the task pool, and the group it belongs to. */
+struct PoolTask {
+	std::function<void()> proc; ///< Function to run.
+	TaskGroup *group;           ///< Group to notify when the function returned.
+	bool urgent;                ///< Whether the task goes before the other tasks queued from outside the pool.
+
+	/** Run the task and mark it as finished in its group. */
+	void Execute()
+	{
+		this->proc();
+		this->group->Finish();
+	}
+};
+
+/** Queue of tasks of a single task thread; the thread takes from the back, others steal from the front. */
+struct TaskQueue {
+	std::mutex lock;             ///< Lock protecting #tasks.
+	std::deque<PoolTask> tasks;  ///< The queued tasks.
+};
+
+static std::mutex _task_lock;                                ///< Lock protecting the state of the pool and #_task_queue.
+static std::condition_variable _task_wake;                   ///< Signalled when a task is queued or the pool has to stop.
+static std::deque<PoolTask> _task_queue;                     ///< Tasks queued by threads outside the pool.
+static std::vector<std::unique_ptr<TaskQueue>> _task_queues; ///< Queue of each task thread; all exist while the pool runs, so threads can be added.
+static std::vector<std::thread> _task_threads;               ///< The task threads; only changed while holding #_task_lock.
+static std::atomic<uint> _task_thread_count = 0;             ///< Number of started task threads.
+static std::atomic<uint> _task_queued = 0;                   ///< Number of tasks in all queues together.
+static std::atomic<uint> _task_local_queued = 0;             ///< Number of tasks in the queues of the task threads.
+static std::atomic<bool> _task_started = false;              ///< Whether we already started the task threads.
+static bool _task_exit = false;                              ///< Whether the task threads have to stop.
+static thread_local int _task_thread_index = -1;             ///< Index of the current task thread, or -1 outside the pool.
+
+/** Wake a sleeping task thread, after a task was queued. */
+static void WakeTaskThread()
+{
+	/* Taking the lock makes sure a thread that is about to sleep sees the new task. */
+	std::lock_guard<std::mutex> lock(_task_lock);
+	_task_wake.notify_one();
+}
+
+/**
+ * Take a task from the queues: the own queue first, the tasks queued from
+ * outside the pool next, and finally steal the oldest task of another thread.
+ * @param index Index of the current task thread.
+ * @param outside Whether tasks queued from outside the pool may be taken.
+ * @param[out] task The task that was taken.
+ * @return True iff a task was taken.
+ */
+static bool TakeTask(uint index, bool outside, PoolTask &task)
+{
+	if (_task_queued == 0) return false;
+
+	{
+		TaskQueue &own = *_task_queues[index];
+		std::lock_guard<std::mutex> lock(own.lock);
+		if (!own.tasks.empty()) {
+			task = std::move(own.tasks.back());
+			own.tasks.pop_back();
+			_task_local_queued--;
+			_task_queued--;
+			return true;
+		}
+	}
+
+	if (outside) {
+		std::lock_guard<std::mutex> lock(_task_lock);
+		if (!_task_queue.empty()) {
+			task = std::move(_task_queue.front());
+			_task_queue.pop_front();
+			_task_queued--;
+			return true;
+		}
+	}
+
+	uint count = _task_thread_count.load(std::memory_order_acquire);
+	for (uint i = 1; i < count; i++) {
+		TaskQueue &victim = *_task_queues[(index + i) % count];
+		std::lock_guard<std::mutex> lock(victim.lock);
+		if (!victim.tasks.empty()) {
+			task = std::move(victim.tasks.front());
+			victim.tasks.pop_front();
+			_task_local_queued--;
+			_task_queued--;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/**
+ * Main loop of a task thread.
+ * @param index Index of the thread in the pool.
+ */
+static void TaskThreadLoop(uint index)
+{
+	_task_thread_index = index;
+
+	PoolTask task;
+	for (;;) {
+		if (TakeTask(index, true, task)) {
+			task.Execute();
+			task = {};
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(_task_lock);
+		_task_wake.wait(lock, []() { return _task_exit || _task_queued != 0; });
+		if (_task_exit && _task_queued == 0) return;
+	}
+}
+
+/**
+ * Add a thread to the pool, while holding #_task_lock.
+ * @return True iff the thread was started.
+ */
+static bool AddTaskThread()
+{
+	uint index = (uint)_task_threads.size();
+	if (index >= MAX_TASK_THREADS) return false;
+
+	std::thread t;
+	if (!StartNewThread(&t, "ottd:task", &TaskThreadLoop, uint(index))) return false;
+	_task_threads.push_back(std::move(t));
+	_task_thread_count.store(index + 1, std::memory_order_release);
+	return true;
+}
+
+/** Start the task threads, if the system supports it. */
+static void StartTaskThreads()
+{
+	if (_task_started.load(std::memory_order_acquire)) return;
+
+	std::lock_guard<std::mutex> lock(_task_lock);
+	if (_task_started) return;
+
+	/* Always start at least one thread, so link graph jobs don't run in the game loop on a single core. */
+	uint count = _task_pool_threads;
+	if (count == 0) count = std::max(std::thread::hardware_concurrency(), 2U) - 1;
+
+	/* The queues must exist before any thread looks at them. */
+	for (uint i = 0; i < MAX_TASK_THREADS; i++) _task_queues.push_back(std::make_unique<TaskQueue>());
+	while (_task_threads.size() < count && AddTaskThread()) {}
+	Debug(misc, 1, "Started {} task threads", _task_threads.size());
+
+	_task_started.store(true, std::memory_order_release);
+}
+
+/**
+ * Get the number of task threads in the pool.
+ * @return The number of task threads.
+ */
+uint GetTaskThreadCount()
+{
+	StartTaskThreads();
+	return _task_thread_count.load(std::memory_order_acquire);
+}
+
+/**
+ * Make sure the pool has at least the given number of threads, so as many
+ * long running jobs can run at the same time without waiting for each other.
+ * @param count The number of threads that are needed.
+ */
+void EnsureTaskThreads(uint count)
+{
+	StartTaskThreads();
+
+	std::lock_guard<std::mutex> lock(_task_lock);
+	if (_task_threads.empty()) return; // No threads on this system at all.
+
+	uint before = (uint)_task_threads.size();
+	while (_task_threads.size() < count && AddTaskThread()) {}
+	if (_task_threads.size() != before) Debug(misc, 1, "Increased the number of task threads to {}", _task_threads.size());
+}
+
+/**
+ * Stop all task threads after they finished the queued tasks.
+ * The threads are started again, with the then configured size, when needed.
+ */
+void StopTaskThreads()
+{
+	{
+		std::lock_guard<std::mutex> lock(_task_lock);
+		_task_exit = true;
+	}
+	_task_wake.notify_all();
+
+	for (std::thread &t : _task_threads) {
+		if (t.joinable()) t.join();
+	}
+	_task_threads.clear();
+	_task_thread_count = 0;
+	_task_queues.clear();
+	_task_exit = false;
+	_task_started = false;
+}
+
+/**
+ * Take an urgent task of a group from the tasks queued by threads outside
+ * the pool, if no task thread picked it up yet.
+ * @param group The group of the task.
+ * @param[out] task The task that was taken.
+ * @return True iff a task was taken.
+ */
+static bool TakeQueuedUrgentTask(const TaskGroup *group, PoolTask &task)
+{
+	std::lock_guard<std::mutex> lock(_task_lock);
+	auto it = std::find_if(_task_queue.begin(), _task_queue.end(), [group](const PoolTask &t) { return t.group == group && t.urgent; });
+	if (it == _task_queue.end()) return false;
+
+	task = std::move(*it);
+	_task_queue.erase(it);
+	_task_queued--;
+	return true;
+}
+
+/** Mark a task of the group as finished, and wake the waiting thread if it was the last one. */
+void TaskGroup::Finish()
+{
+	{
+		std::lock_guard<std::mutex> lock(this->lock);
+		if (--this->pending != 0) return;
+		this->done.notify_all();
+	}
+
+	/* A task thread waiting for the group sleeps till there is work for it, or the group is done. */
+	{
+		std::lock_guard<std::mutex> lock(_task_lock);
+	}
+	_task_wake.notify_all();
+}
+
+/**
+ * Run a function as task of this group on the task pool. Without task
+ * threads the function is run right away in the calling thread.
+ * @param proc   The function to run.
+ * @param urgent Whether the function is something the caller will wait for
+ *               shortly, so it should not wait behind long running jobs that
+ *               are still queued.
+ */
+void TaskGroup::Run(std::function<void()> proc, bool urgent)
+{
+	if (GetTaskThreadCount() == 0) {
+		proc();
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(this->lock);
+		this->pending++;
+	}
+
+	if (_task_thread_index >= 0) {
+		TaskQueue &own = *_task_queues[_task_thread_index];
+		std::lock_guard<std::mutex> lock(own.lock);
+		own.tasks.push_back({ std::move(proc), this, urgent });
+		_task_local_queued++;
+		_task_queued++;
+	} else {
+		std::lock_guard<std::mutex> lock(_task_lock);
+		/* Urgent tasks go after the other urgent tasks, but before everything else. */
+		auto pos = urgent ? std::find_if(_task_queue.begin(), _task_queue.end(), [](const PoolTask &t) { return !t.urgent; }) : _task_queue.end();
+		_task_queue.insert(pos, { std::move(proc), this, urgent });
+		_task_queued++;
+	}
+	WakeTaskThread();
+}
+
+/**
+ * Wait till all tasks of this group finished. A task thread runs other
+ * tasks while waiting, but none that were queued from outside the pool,
+ * as those are long running jobs of their own. Any other thread runs the
+ * urgent tasks of the group that have not been started yet itself, so it
+ * never waits for the pool to get through the work queued before them.
+ * Long running jobs are never run by the waiting thread; see #EnsureTaskThreads.
+ */
+void TaskGroup::Wait()
+{
+	PoolTask task;
+	if (_task_thread_index >= 0) {
+		while (!this->IsDone()) {
+			if (TakeTask(_task_thread_index, false, task)) {
+				task.Execute();
+				task = {};
+				continue;
+			}
+			std::unique_lock<std::mutex> lock(_task_lock);
+			_task_wake.wait(lock, [this]() { return this->IsDone() || _task_local_queued != 0; });
+		}
+	} else {
+		while (!this->IsDone() && TakeQueuedUrgentTask(this, task)) {
+			task.Execute();
+			task = {};
+		}
+	}
+
+	/* Synchronise with the thread that finished the last task, before the group may be destroyed. */
+	std::unique_lock<std::mutex> lock(this->lock);
+	this->done.wait(lock, [this]() { return this->pending == 0; });
+}
+
+/**
+ * Process \a count work items as tasks on the task pool and wait for them.
+ * It may be called from the main thread as well as from within tasks, so jobs
+ * running on the pool can split their own work. The ranges are queued ahead of
+ * background jobs, as the caller blocks until they are done. They are processed
+ * in no particular order; merging the results in a deterministic order is up to
+ * the caller.
+ * @param count      Number of work items.
+ * @param batch_size Number of items per task.
+ * @param proc       Function to call for each range of items.
+ */
+void RunTasks(size_t count, size_t batch_size, const ParallelRangeProc &proc)
+{
+	assert(batch_size > 0);
+	if (count == 0) return;
+
+	if (count <= batch_size || GetTaskThreadCount() == 0) {
+		proc(0, count);
+		return;
+	}
+
+	TaskGroup group;
+	for (size_t first = batch_size; first < count; first += batch_size) {
+		size_t last = std::min(first + batch_size, count);
+		group.Run([&proc, first, last]() { proc(first, last); }, true);
+	}
+	/* The first range is processed while the other ranges are picked up. */
+	proc(0, batch_size);
+	group.Wait();
+}
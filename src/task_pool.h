@@ -0,0 +1,62 @@
+/*
+ * This file is part of OpenTTD.
+ * OpenTTD is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, version 2.
+ * OpenTTD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file task_pool.h Work-stealing pool of threads for long running background tasks, like link graph jobs. */
+
+#ifndef TASK_POOL_H
+#define TASK_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+
+extern uint _task_pool_threads;
+
+/**
+ * Function processing a range of work items of a parallel job.
+ * It may only write to state that belongs to the items in its range.
+ * @param first First item of the range.
+ * @param last  One past the last item of the range.
+ */
+typedef std::function<void(size_t first, size_t last)> ParallelRangeProc;
+
+/**
+ * Set of tasks running on the task pool that can be waited for.
+ * Tasks may start tasks of their own and wait for them; a pool thread
+ * waiting for a group runs the queued tasks in the meantime, so nested
+ * tasks never deadlock the pool.
+ */
+class TaskGroup {
+	std::mutex lock;                ///< Lock protecting #pending, for waking the waiting thread.
+	std::condition_variable done;   ///< Signalled when the last pending task finished.
+	std::atomic<uint> pending = 0;  ///< Number of tasks that have not finished yet; only changed while holding #lock.
+
+	void Finish();
+
+	friend struct PoolTask;
+
+public:
+	~TaskGroup() { this->Wait(); }
+
+	void Run(std::function<void()> proc, bool urgent = false);
+	void Wait();
+
+	/**
+	 * Check whether all tasks of the group finished.
+	 * This is allowed to spuriously return an outdated value.
+	 * @return True iff no task is pending.
+	 */
+	inline bool IsDone() const { return this->pending.load(std::memory_order_acquire) == 0; }
+};
+
+void RunTasks(size_t count, size_t batch_size, const ParallelRangeProc &proc);
+uint GetTaskThreadCount();
+void EnsureTaskThreads(uint count);
+void StopTaskThreads();
+
+#endif /* TASK_POOL_H */
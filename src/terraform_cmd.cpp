@@ -11,6 +11,8 @@
 #include "command_func.h"
 #include "tunnel_map.h"
 #include "bridge_map.h"
+#include "tunnelbridge_map.h"
+#include "station_map.h"
 #include "viewport_func.h"
 #include "genworld.h"
 #include "object_base.h"
@@ -19,6 +21,8 @@
 #include "core/backup_type.hpp"
 #include "terraform_cmd.h"
 #include "landscape_cmd.h"
+#include "pathfinder/water_regions.h"
+#include "pathfinder/yapf/yapf_cache.h"
 
 #include "table/strings.h"
 
@@ -315,6 +319,22 @@ std::tuple<CommandCost, Money, TileIndex> CmdTerraformLand(DoCommandFlag flags,
 			int height = it->second;
 
 			SetTileHeight(t, (uint)height);
+
+			/* The slopes of the tiles sharing this corner changed, so ships might sail differently
+			 * along the coast and trains and road vehicles might find different hills on their way. */
+			for (int dx = -1; dx <= 0; dx++) {
+				for (int dy = -1; dy <= 0; dy++) {
+					TileIndex slope_tile = TileAddWrap(t, dx, dy);
+					if (slope_tile == INVALID_TILE) continue;
+					InvalidateWaterRegion(slope_tile);
+					if (IsTileType(slope_tile, MP_RAILWAY) || HasStationTileRail(slope_tile) ||
+							(IsTileType(slope_tile, MP_TUNNELBRIDGE) && GetTunnelBridgeTransportType(slope_tile) == TRANSPORT_RAIL)) {
+						YapfNotifyTrackLayoutChange(slope_tile, INVALID_TRACK);
+					} else {
+						YapfNotifyRoadLayoutChange(slope_tile);
+					}
+				}
+			}
 		}
 
 		if (c != nullptr) c->terraform_limit -= (uint32)ts.tile_to_new_height.size() << 16;
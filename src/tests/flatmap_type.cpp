@@ -0,0 +1,111 @@
+/*
+ * This file is part of OpenTTD.
+ * OpenTTD is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, version 2.
+ * OpenTTD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file flatmap_type.cpp Test functionality from core/flatmap_type. */
+
+#include "../stdafx.h"
+
+#include "../3rdparty/catch2/catch.hpp"
+
+#include "../core/flatmap_type.hpp"
+
+#include <map>
+#include <random>
+#include <vector>
+
+/**
+ * Check that a FlatMap holds the same items in the same order as a std::map.
+ * @param flat The FlatMap.
+ * @param tree The std::map.
+ */
+template <typename Tflat, typename Ttree>
+static void CheckSameItems(const Tflat &flat, const Ttree &tree)
+{
+	REQUIRE(flat.size() == tree.size());
+	auto it = tree.begin();
+	for (const auto &item : flat) {
+		REQUIRE(item.first == it->first);
+		REQUIRE(item.second == it->second);
+		++it;
+	}
+}
+
+TEST_CASE("FlatMap - Same items and order as std::map")
+{
+	std::mt19937 random(42);
+	std::uniform_int_distribution<uint> keys(0, 199);
+
+	FlatMap<uint, uint> flat;
+	std::map<uint, uint> tree;
+	for (uint i = 0; i < 5000; i++) {
+		uint key = keys(random);
+		switch (random() % 4) {
+			case 0:
+				REQUIRE(flat.insert({key, i}).second == tree.insert({key, i}).second);
+				break;
+
+			case 1:
+				flat[key] += i;
+				tree[key] += i;
+				break;
+
+			case 2:
+				REQUIRE(flat.erase(key) == tree.erase(key));
+				break;
+
+			case 3: {
+				auto flat_it = flat.upper_bound(key);
+				auto tree_it = tree.upper_bound(key);
+				REQUIRE((flat_it == flat.end()) == (tree_it == tree.end()));
+				if (flat_it != flat.end()) REQUIRE(flat_it->first == tree_it->first);
+				REQUIRE((flat.find(key) == flat.end()) == (tree.find(key) == tree.end()));
+				break;
+			}
+		}
+	}
+	CheckSameItems(flat, tree);
+
+	/* Erasing while iterating, like FlowStatMap::DeleteFlows does. */
+	for (auto it = flat.begin(); it != flat.end();) {
+		if (it->second % 2 == 0) {
+			tree.erase(it->first);
+			it = flat.erase(it);
+		} else {
+			++it;
+		}
+	}
+	CheckSameItems(flat, tree);
+}
+
+TEST_CASE("FlatMap - Merge")
+{
+	FlatMap<uint, uint> old_flows;
+	for (uint key : { 1, 3, 5, 7, 9 }) old_flows[key] = key * 10;
+	FlatMap<uint, uint> new_flows;
+	for (uint key : { 0, 3, 4, 7, 10 }) new_flows[key] = key * 100;
+
+	/* Like the flows of a finished link graph job: items in both get the new value, items
+	 * only in the old map are dropped or kept depending on their key, and new items are added. */
+	std::vector<uint> merged_keys;
+	old_flows.Merge(std::move(new_flows),
+		[&](uint key, uint &old_value, uint &new_value) {
+			merged_keys.push_back(key);
+			old_value = new_value + 1;
+			return key != 7;
+		},
+		[](uint key, uint &old_value) {
+			old_value += 1;
+			return key != 5;
+		});
+
+	CHECK(merged_keys == std::vector<uint>({ 3, 7 }));
+	CHECK(new_flows.empty());
+
+	const std::vector<std::pair<uint, uint>> expected = { { 0, 0 }, { 1, 11 }, { 3, 301 }, { 4, 400 }, { 9, 91 }, { 10, 1000 } };
+	REQUIRE(old_flows.size() == expected.size());
+	CHECK(std::equal(old_flows.begin(), old_flows.end(), expected.begin()));
+}
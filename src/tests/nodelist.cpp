@@ -0,0 +1,219 @@
+/*
+ * This file is part of OpenTTD.
+ * OpenTTD is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, version 2.
+ * OpenTTD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file nodelist.cpp Test the node lists from pathfinder/yapf/nodelist. */
+
+#include "../stdafx.h"
+
+#define CATCH_CONFIG_ENABLE_BENCHMARKING
+#include "../3rdparty/catch2/catch.hpp"
+
+#include "../pathfinder/yapf/nodelist.hpp"
+
+#include <random>
+
+/** Key of a node on a grid. */
+struct GridKey {
+	uint32 position; ///< Position of the node on the grid.
+
+	inline int CalcHash() const { return this->position; }
+	inline bool operator==(const GridKey &other) const { return this->position == other.position; }
+};
+
+/** Node of a search on a grid, with the members a node list needs. */
+struct GridNode {
+	typedef GridKey Key;
+
+	GridKey key;         ///< Position of the node.
+	GridNode *hash_next; ///< Next node in the chain of a CHashTableT.
+	GridNode *parent;    ///< Node the search came from.
+	int cost;            ///< Cost from the origin.
+	int estimate;        ///< Cost from the origin plus estimated cost to the destination.
+
+	inline const Key &GetKey() const { return this->key; }
+	inline GridNode *GetHashNext() { return this->hash_next; }
+	inline void SetHashNext(GridNode *next) { this->hash_next = next; }
+	inline int GetCostEstimate() const { return this->estimate; }
+	inline bool operator<(const GridNode &other) const { return this->estimate < other.estimate; }
+};
+
+/** Grid with random costs of entering each position. */
+struct Grid {
+	uint size;                ///< Number of positions along each edge.
+	std::vector<uint8> costs; ///< Cost of entering each position.
+
+	Grid(uint size, uint seed) : size(size), costs(size * size)
+	{
+		std::mt19937 random(seed);
+		for (uint8 &cost : this->costs) cost = 1 + random() % 9;
+	}
+};
+
+/**
+ * Search the cheapest path between two corners of a grid, using the node
+ * list the same way as CYapfBaseT does.
+ * @param grid The grid to search on.
+ * @param[out] closed Number of closed nodes at the end of the search.
+ * @return Cost of the cheapest path.
+ */
+template <class TNodeList>
+static int SearchGrid(const Grid &grid, int *closed = nullptr)
+{
+	TNodeList nodes;
+	uint32 target = grid.size * grid.size - 1;
+	auto estimate = [&](uint32 pos) { return (int)((grid.size - 1 - pos % grid.size) + (grid.size - 1 - pos / grid.size)); };
+
+	GridNode &origin = *nodes.CreateNewNode();
+	origin = { { 0 }, nullptr, nullptr, 0, estimate(0) };
+	nodes.InsertOpenNode(origin);
+
+	GridNode *best = nullptr;
+	for (;;) {
+		GridNode *n = nodes.GetBestOpenNode();
+		if (n == nullptr || (best != nullptr && best->cost < n->estimate)) break;
+
+		uint32 pos = n->key.position;
+		uint x = pos % grid.size;
+		uint y = pos / grid.size;
+		uint32 neighbours[4];
+		uint count = 0;
+		if (x > 0) neighbours[count++] = pos - 1;
+		if (x + 1 < grid.size) neighbours[count++] = pos + 1;
+		if (y > 0) neighbours[count++] = pos - grid.size;
+		if (y + 1 < grid.size) neighbours[count++] = pos + grid.size;
+
+		for (uint i = 0; i < count; i++) {
+			GridNode &child = *nodes.CreateNewNode();
+			int cost = n->cost + grid.costs[neighbours[i]];
+			child = { { neighbours[i] }, nullptr, n, cost, cost + estimate(neighbours[i]) };
+
+			if (child.key.position == target) {
+				if (best == nullptr || child.cost < best->cost) best = &child;
+				nodes.FoundBestNode(child);
+				continue;
+			}
+
+			GridNode *open = nodes.FindOpenNode(child.key);
+			if (open != nullptr) {
+				if (child.estimate < open->estimate) {
+					nodes.PopOpenNode(child.key);
+					*open = child;
+					nodes.InsertOpenNode(*open);
+				}
+				continue;
+			}
+			if (nodes.FindClosedNode(child.key) != nullptr) continue;
+			nodes.InsertOpenNode(child);
+		}
+
+		nodes.PopOpenNode(n->key);
+		nodes.InsertClosedNode(*n);
+	}
+
+	if (closed != nullptr) *closed = nodes.ClosedCount();
+	return best != nullptr ? best->cost : -1;
+}
+
+typedef CNodeList_HashTableT<GridNode, 8, 10> GridNodeListHashTable;
+typedef CNodeList_DaryHeapT<GridNode, 4> GridNodeListDaryHeap;
+
+TEST_CASE("CNodeList_DaryHeapT - Open and closed nodes")
+{
+	GridNodeListDaryHeap nodes;
+	CHECK(nodes.GetBestOpenNode() == nullptr);
+
+	const int estimates[] = { 5, 3, 8, 3, 1 };
+	for (uint i = 0; i < lengthof(estimates); i++) {
+		GridNode &n = *nodes.CreateNewNode();
+		n = { { i }, nullptr, nullptr, 0, estimates[i] };
+		nodes.InsertOpenNode(n);
+	}
+	CHECK(nodes.OpenCount() == 5);
+	REQUIRE(nodes.FindOpenNode({ 2 }) != nullptr);
+	CHECK(nodes.FindClosedNode({ 2 }) == nullptr);
+	CHECK(nodes.FindOpenNode({ 7 }) == nullptr);
+
+	/* Lower the estimate of a node, like CYapfBaseT does when it finds a better path. */
+	GridNode &update = nodes.PopOpenNode({ 2 });
+	update.estimate = 0;
+	nodes.InsertOpenNode(update);
+
+	GridNode *best = nodes.PopBestOpenNode();
+	REQUIRE(best != nullptr);
+	CHECK(best->key.position == 2);
+	nodes.InsertClosedNode(*best);
+	CHECK(nodes.FindOpenNode({ 2 }) == nullptr);
+	CHECK(nodes.FindClosedNode({ 2 }) == best);
+	CHECK(nodes.ClosedCount() == 1);
+
+	/* Equal estimates are popped in the order the nodes were inserted. */
+	const uint order[] = { 4, 1, 3, 0 };
+	for (uint expected : order) {
+		GridNode *n = nodes.PopBestOpenNode();
+		REQUIRE(n != nullptr);
+		CHECK(n->key.position == expected);
+	}
+	CHECK(nodes.OpenCount() == 0);
+}
+
+TEST_CASE("CNodeList_DaryHeapT - Equal estimates in insertion order")
+{
+	GridNodeListDaryHeap nodes;
+
+	/* Enough nodes to fill several levels of the heap. */
+	for (uint i = 0; i < 100; i++) {
+		GridNode &n = *nodes.CreateNewNode();
+		n = { { i }, nullptr, nullptr, 0, (int)(i % 3) };
+		nodes.InsertOpenNode(n);
+	}
+
+	/* Reinserting a node after updating its cost puts it behind the open nodes with the same estimate. */
+	GridNode &update = nodes.PopOpenNode({ 4 });
+	update.estimate = 0;
+	nodes.InsertOpenNode(update);
+
+	std::vector<uint> expected;
+	for (uint estimate = 0; estimate < 3; estimate++) {
+		for (uint i = estimate; i < 100; i += 3) {
+			if (i != 4) expected.push_back(i);
+		}
+		if (estimate == 0) expected.push_back(4);
+	}
+
+	std::vector<uint> popped;
+	while (GridNode *n = nodes.PopBestOpenNode()) {
+		nodes.InsertClosedNode(*n);
+		popped.push_back(n->key.position);
+	}
+	CHECK(popped == expected);
+}
+
+TEST_CASE("CNodeList_DaryHeapT - Same path costs as CNodeList_HashTableT")
+{
+	for (uint seed = 0; seed < 8; seed++) {
+		Grid grid(32 + seed * 8, seed);
+		int closed_hash, closed_heap;
+		CHECK(SearchGrid<GridNodeListDaryHeap>(grid, &closed_heap) == SearchGrid<GridNodeListHashTable>(grid, &closed_hash));
+		CHECK(closed_heap > 0);
+	}
+}
+
+TEST_CASE("CNodeList_DaryHeapT - Search cost compared to CNodeList_HashTableT", "[.][benchmark]")
+{
+	Grid grid(256, 1234);
+	REQUIRE(SearchGrid<GridNodeListDaryHeap>(grid) == SearchGrid<GridNodeListHashTable>(grid));
+
+	BENCHMARK("binary heap of pointers and chained hash tables")
+	{
+		return SearchGrid<GridNodeListHashTable>(grid);
+	};
+
+	BENCHMARK("4-ary heap of indices and open addressing hash table")
+	{
+		return SearchGrid<GridNodeListDaryHeap>(grid);
+	};
+}
@@ -0,0 +1,127 @@
+/*
+ * This file is part of OpenTTD.
+ * OpenTTD is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, version 2.
+ * OpenTTD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file spatial_hash_type.cpp Test functionality from core/spatial_hash_type. */
+
+#include "../stdafx.h"
+
+#define CATCH_CONFIG_ENABLE_BENCHMARKING
+#include "../3rdparty/catch2/catch.hpp"
+
+#include "../core/spatial_hash_type.hpp"
+
+#include <random>
+
+/** Item with a position, like a vehicle on a tile. */
+struct HashItem {
+	uint x;              ///< X coordinate of the item.
+	uint y;              ///< Y coordinate of the item.
+	HashItem *hash_next; ///< Next item in the chain of the fixed hash.
+};
+
+/** Fixed size hash of 128 x 128 buckets with intrusive chains, like the old vehicle tile hash. */
+struct FixedChainHash {
+	static const uint BITS = 7;                     ///< Number of bits of each coordinate used for the hash.
+	static const uint MASK = (1U << BITS) - 1;      ///< Mask of the used bits of each coordinate.
+	HashItem *buckets[1U << (2 * BITS)] = {};       ///< First item of each chain.
+
+	void Insert(HashItem *item)
+	{
+		HashItem **bucket = &this->buckets[(item->x & MASK) | (item->y & MASK) << BITS];
+		item->hash_next = *bucket;
+		*bucket = item;
+	}
+
+	uint Count(uint x, uint y) const
+	{
+		uint count = 0;
+		for (const HashItem *item = this->buckets[(x & MASK) | (y & MASK) << BITS]; item != nullptr; item = item->hash_next) {
+			if (item->x == x && item->y == y) count++;
+		}
+		return count;
+	}
+};
+
+static uint CountInSpatialHash(const SpatialHash<HashItem> &hash, uint x, uint y)
+{
+	uint count = 0;
+	for (const HashItem *item : hash.GetItems(hash.GetBucket(x, y))) {
+		if (item->x == x && item->y == y) count++;
+	}
+	return count;
+}
+
+TEST_CASE("SpatialHash - Buckets")
+{
+	SpatialHash<HashItem> hash;
+	hash.Reset(2);
+	CHECK(hash.GetMask() == 3);
+	CHECK(hash.GetBucket(1, 2) == hash.GetBucket(5, 6));
+	CHECK(hash.GetBucket(1, 2) != hash.GetBucket(2, 1));
+
+	HashItem a{1, 2, nullptr}, b{5, 6, nullptr}, c{1, 2, nullptr};
+	uint bucket = hash.GetBucket(1, 2);
+	hash.Insert(bucket, &a);
+	hash.Insert(bucket, &b);
+	hash.Insert(bucket, &c);
+	CHECK(CountInSpatialHash(hash, 1, 2) == 2);
+	CHECK(CountInSpatialHash(hash, 5, 6) == 1);
+
+	hash.Remove(bucket, &b);
+	REQUIRE(hash.GetItems(bucket).size() == 2);
+	CHECK(hash.GetItems(bucket)[0] == &a);
+	CHECK(hash.GetItems(bucket)[1] == &c);
+	CHECK(CountInSpatialHash(hash, 5, 6) == 0);
+}
+
+TEST_CASE("SpatialHash - Lookup cost compared to fixed chained hash", "[.][benchmark]")
+{
+	/* 20000 items on a 4096 x 4096 map, clustered like vehicles around stations. */
+	const uint MAP_SIZE = 4096;
+	const uint ITEMS = 20000;
+	const uint LOOKUPS = 10000;
+
+	std::mt19937 random(1234);
+	std::vector<HashItem> items(ITEMS);
+	for (uint i = 0; i < ITEMS; i++) {
+		uint cluster = random() % 500;
+		items[i].x = (cluster * 7919 + random() % 64) % MAP_SIZE;
+		items[i].y = (cluster * 104729 + random() % 64) % MAP_SIZE;
+	}
+	std::vector<std::pair<uint, uint>> lookups(LOOKUPS);
+	for (auto &lookup : lookups) {
+		const HashItem &item = items[random() % ITEMS];
+		lookup = { item.x, item.y };
+	}
+
+	FixedChainHash fixed;
+	for (HashItem &item : items) fixed.Insert(&item);
+
+	SpatialHash<HashItem> spatial;
+	spatial.Reset(9);
+	for (HashItem &item : items) spatial.Insert(spatial.GetBucket(item.x, item.y), &item);
+
+	uint expected = 0;
+	for (const auto &lookup : lookups) expected += fixed.Count(lookup.first, lookup.second);
+	uint found = 0;
+	for (const auto &lookup : lookups) found += CountInSpatialHash(spatial, lookup.first, lookup.second);
+	REQUIRE(found == expected);
+
+	BENCHMARK("fixed 128 x 128 chained hash")
+	{
+		uint count = 0;
+		for (const auto &lookup : lookups) count += fixed.Count(lookup.first, lookup.second);
+		return count;
+	};
+
+	BENCHMARK("spatial hash with 512 x 512 buckets")
+	{
+		uint count = 0;
+		for (const auto &lookup : lookups) count += CountInSpatialHash(spatial, lookup.first, lookup.second);
+		return count;
+	};
+}
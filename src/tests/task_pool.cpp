@@ -0,0 +1,139 @@
+/*
+ * This file is part of OpenTTD.
+ * OpenTTD is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, version 2.
+ * OpenTTD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file task_pool.cpp Test functionality from task_pool. */
+
+#include "../stdafx.h"
+
+#include "../3rdparty/catch2/catch.hpp"
+
+#include "../task_pool.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+TEST_CASE("TaskGroup - Nested tasks")
+{
+	_task_pool_threads = 3;
+
+	/* Every job splits its work into tasks of its own, like the link graph jobs do. */
+	const uint JOBS = 8;
+	const uint ITEMS = 1000;
+	std::vector<std::vector<uint>> results(JOBS, std::vector<uint>(ITEMS));
+	{
+		TaskGroup jobs;
+		for (uint job = 0; job < JOBS; job++) {
+			jobs.Run([&results, job]() {
+				std::vector<uint> &result = results[job];
+				RunTasks(ITEMS, 16, [&result, job](size_t first, size_t last) {
+					for (size_t i = first; i < last; i++) result[i] = job * ITEMS + (uint)i;
+				});
+			});
+		}
+		jobs.Wait();
+		CHECK(jobs.IsDone());
+	}
+
+	for (uint job = 0; job < JOBS; job++) {
+		for (uint i = 0; i < ITEMS; i++) REQUIRE(results[job][i] == job * ITEMS + i);
+	}
+
+	StopTaskThreads();
+	_task_pool_threads = 0;
+}
+
+TEST_CASE("TaskGroup - Wait runs queued urgent tasks itself")
+{
+	_task_pool_threads = 1;
+	REQUIRE(GetTaskThreadCount() == 1);
+
+	/* Keep the only task thread busy, like a long running link graph job. */
+	std::atomic<bool> started = false;
+	std::atomic<bool> release = false;
+	TaskGroup busy;
+	busy.Run([&started, &release]() {
+		started = true;
+		while (!release) std::this_thread::yield();
+	});
+	while (!started) std::this_thread::yield();
+
+	/* Waiting for an urgent task queued behind it must not wait for the busy thread. */
+	std::thread::id runner;
+	{
+		TaskGroup group;
+		group.Run([&runner]() { runner = std::this_thread::get_id(); }, true);
+		group.Wait();
+	}
+	CHECK(runner == std::this_thread::get_id());
+
+	release = true;
+	busy.Wait();
+
+	StopTaskThreads();
+	_task_pool_threads = 0;
+}
+
+TEST_CASE("TaskGroup - Urgent tasks go first")
+{
+	_task_pool_threads = 1;
+	REQUIRE(GetTaskThreadCount() == 1);
+
+	std::atomic<bool> started = false;
+	std::atomic<bool> release = false;
+	std::vector<int> order;
+	{
+		TaskGroup group;
+		group.Run([&started, &release]() {
+			started = true;
+			while (!release) std::this_thread::yield();
+		});
+		while (!started) std::this_thread::yield();
+
+		/* Both are queued while the only task thread is busy. */
+		group.Run([&order]() { order.push_back(1); });
+		group.Run([&order]() { order.push_back(2); }, true);
+		release = true;
+		/* Don't wait with Wait(), that would run the queued tasks in this thread. */
+		while (!group.IsDone()) std::this_thread::yield();
+	}
+	CHECK(order == std::vector<int>{ 2, 1 });
+
+	StopTaskThreads();
+	_task_pool_threads = 0;
+}
+
+TEST_CASE("TaskGroup - Every job gets a thread")
+{
+	_task_pool_threads = 1;
+	REQUIRE(GetTaskThreadCount() == 1);
+
+	/* Jobs that only finish when all of them run at the same time, like link graph jobs that are all due. */
+	const uint JOBS = 3;
+	EnsureTaskThreads(JOBS);
+	CHECK(GetTaskThreadCount() == JOBS);
+
+	std::atomic<uint> started = 0;
+	std::thread::id main = std::this_thread::get_id();
+	std::atomic<bool> on_main = false;
+	{
+		TaskGroup jobs;
+		for (uint job = 0; job < JOBS; job++) {
+			jobs.Run([&started, &on_main, main]() {
+				if (std::this_thread::get_id() == main) on_main = true;
+				started++;
+				while (started < JOBS) std::this_thread::yield();
+			});
+		}
+		jobs.Wait();
+	}
+	CHECK(started == JOBS);
+	CHECK_FALSE(on_main);
+
+	StopTaskThreads();
+	_task_pool_threads = 0;
+}
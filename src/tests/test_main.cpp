@@ -10,5 +10,6 @@
 #include "../stdafx.h"
 
 #define CATCH_CONFIG_MAIN
+#define CATCH_CONFIG_ENABLE_BENCHMARKING
 #define DO_NOT_USE_WMAIN
 #include "../3rdparty/catch2/catch.hpp"
@@ -0,0 +1,86 @@
+/*
+ * This file is part of OpenTTD.
+ * OpenTTD is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, version 2.
+ * OpenTTD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file train_curve_speed.cpp Test the curve speed limits planned ahead of the vehicle tick. */
+
+#include "../stdafx.h"
+
+#include "../3rdparty/catch2/catch.hpp"
+
+#include "../rail.h"
+#include "../rail_map.h"
+#include "../settings_type.h"
+#include "../train.h"
+#include "../vehicle_func.h"
+
+/**
+ * Build a train of two vehicles in a 90 degree curve, with its front on a rail tile.
+ * @param tile Tile of the front.
+ * @return The front of the train.
+ */
+static Train *BuildCurvedTrain(TileIndex tile)
+{
+	MakeRailNormal(tile, COMPANY_FIRST, TRACK_BIT_X, RAILTYPE_RAIL);
+
+	REQUIRE(Train::CanAllocateItem(2));
+	Train *front = new Train();
+	Train *back = new Train();
+	front->tile = tile;
+	front->direction = DIR_NE;
+	back->tile = tile;
+	back->direction = DIR_NW;
+	front->SetNext(back);
+	return front;
+}
+
+TEST_CASE("Train - Planned curve speed limit")
+{
+	Map::Allocate(64, 64);
+	ResetRailTypes();
+	_settings_game.vehicle.train_acceleration_model = AM_REALISTIC;
+	_parallel_vehicle_ticks = true;
+
+	TileIndex tile = TileXY(10, 10);
+	Train *v = BuildCurvedTrain(tile);
+	int rail_limit = v->GetCurveSpeedLimit();
+
+	SECTION("Plan pass") {
+		v->OutdateCurveSpeedLimit();
+		CHECK(v->curve_speed_outdated);
+
+		/* The front moves onto monorail before the plan pass; the limit stays the one of the curve on normal rail. */
+		SetRailType(tile, RAILTYPE_MONO);
+		REQUIRE(v->GetCurveSpeedLimit() != rail_limit);
+
+		PlanTrainCurveSpeedLimits();
+		CHECK(!v->curve_speed_outdated);
+		CHECK(v->tcache.cached_max_curve_speed == rail_limit);
+	}
+
+	SECTION("Used before the plan pass") {
+		v->OutdateCurveSpeedLimit();
+		SetRailType(tile, RAILTYPE_MONO);
+
+		CHECK(v->GetMaxCurveSpeed() == rail_limit);
+		CHECK(!v->curve_speed_outdated);
+
+		/* Nothing is left for the plan pass. */
+		v->tcache.cached_max_curve_speed = 0;
+		PlanTrainCurveSpeedLimits();
+		CHECK(v->tcache.cached_max_curve_speed == 0);
+	}
+
+	SECTION("Serial tick") {
+		_parallel_vehicle_ticks = false;
+		v->OutdateCurveSpeedLimit();
+		CHECK(!v->curve_speed_outdated);
+		CHECK(v->tcache.cached_max_curve_speed == rail_limit);
+	}
+
+	_parallel_vehicle_ticks = false;
+	_vehicle_pool.CleanPool();
+}
@@ -0,0 +1,45 @@
+/*
+ * This file is part of OpenTTD.
+ * OpenTTD is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, version 2.
+ * OpenTTD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file yapf_benchmark.cpp Test the recorded pathfinder queries from pathfinder/yapf/yapf_benchmark. */
+
+#include "../stdafx.h"
+
+#include "../3rdparty/catch2/catch.hpp"
+
+#include "../pathfinder/yapf/yapf_benchmark.h"
+
+TEST_CASE("YapfQuery - Format and parse")
+{
+	const YapfQuery queries[] = {
+		{ YQT_TRAIN, 0, 0, DIAGDIR_NE, 0 },
+		{ YQT_ROAD, 1234, 65535, DIAGDIR_SE, 0x3F3F },
+		{ YQT_SHIP, INVALID_VEHICLE - 1, 0x3FFFFFFF, DIAGDIR_NW, 0x3F },
+	};
+
+	for (const YapfQuery &query : queries) {
+		YapfQuery parsed;
+		REQUIRE(ParseYapfQuery(FormatYapfQuery(query), &parsed));
+		CHECK(parsed.type == query.type);
+		CHECK(parsed.vehicle == query.vehicle);
+		CHECK(parsed.tile == query.tile);
+		CHECK(parsed.enterdir == query.enterdir);
+		CHECK(parsed.tracks == query.tracks);
+	}
+}
+
+TEST_CASE("YapfQuery - Reject invalid lines")
+{
+	YapfQuery parsed;
+	CHECK(ParseYapfQuery("train 1 2 3 4\n", &parsed));
+	CHECK_FALSE(ParseYapfQuery("", &parsed));
+	CHECK_FALSE(ParseYapfQuery("aircraft 1 2 3 4", &parsed));
+	CHECK_FALSE(ParseYapfQuery("train 1 2 3", &parsed));
+	CHECK_FALSE(ParseYapfQuery("train 1 2 4 4", &parsed));
+	CHECK_FALSE(ParseYapfQuery("ship 1 2 3 65536", &parsed));
+	CHECK_FALSE(ParseYapfQuery("road " + std::to_string(INVALID_VEHICLE) + " 2 3 4", &parsed));
+}
@@ -0,0 +1,186 @@
+/*
+ * This file is part of OpenTTD.
+ * OpenTTD is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, version 2.
+ * OpenTTD is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details. You should have received a copy of the GNU General Public License along with OpenTTD. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file yapf_costcache.cpp Test the invalidation of the YAPF segment cost caches. */
+
+#include "../stdafx.h"
+
+#include "../3rdparty/catch2/catch.hpp"
+
+#include "../pathfinder/yapf/yapf.h"
+#include "../pathfinder/yapf/yapf.hpp"
+#include "../pathfinder/yapf/yapf_cache.h"
+#include "../pathfinder/yapf/yapf_node_rail.hpp"
+#include "../rail.h"
+#include "../rail_map.h"
+#include "../station_map.h"
+#include "../train.h"
+
+static const int RESERVED_PLATFORM_PENALTY = 1000; ///< Cost of a reserved platform tile.
+
+/**
+ * Calculate the cost of running over a platform, like the rail pathfinder does:
+ * it arrives at the far end of the platform and skips all other platform tiles.
+ * @param tile    Far end of the platform.
+ * @param td      Trackdir at the far end.
+ * @param skipped Number of skipped platform tiles.
+ * @return Cost of the platform.
+ */
+static int PlatformCost(TileIndex tile, Trackdir td, int skipped)
+{
+	int cost = YAPF_TILE_LENGTH * (skipped + 1);
+	IterateFollowedTiles(tile, TrackdirToExitdir(td), skipped, [&cost](TileIndex t) {
+		if (HasStationReservation(t)) cost += RESERVED_PLATFORM_PENALTY;
+	});
+	return cost;
+}
+
+/**
+ * Get the cost of a platform from the cache, calculating it when needed.
+ * @param cache      The segment cost cache.
+ * @param origin     Tile the segment starts at.
+ * @param tile       Far end of the platform.
+ * @param td         Trackdir at the far end.
+ * @param skipped    Number of skipped platform tiles.
+ * @param[out] found Whether the cost was found in the cache.
+ * @return Cost of the platform.
+ */
+static int CachedPlatformCost(CSegmentCostCacheT<CYapfRailSegment> &cache, TileIndex origin, TileIndex tile, Trackdir td, int skipped, bool *found)
+{
+	CYapfNodeKeyTrackDir node_key;
+	node_key.Set(origin, td);
+	CYapfRailSegmentKey key(node_key);
+
+	CYapfRailSegment &segment = cache.Get(key, found);
+	if (!*found) {
+		segment.m_cost = PlatformCost(tile, td, skipped);
+		IterateFollowedTiles(tile, TrackdirToExitdir(td), skipped, [&cache, &segment](TileIndex t) { cache.AddTile(segment, t); });
+	}
+	return segment.m_cost;
+}
+
+TEST_CASE("CSegmentCostCacheT - Changing a middle platform tile")
+{
+	Map::Allocate(64, 64);
+
+	/* A platform of five tiles, entered from (9, 10) and left at (14, 10). */
+	for (uint x = 10; x <= 14; x++) MakeRailStation(TileXY(x, 10), OWNER_NONE, 0, AXIS_X, 0, RAILTYPE_RAIL);
+	const TileIndex origin = TileXY(9, 10);
+	const TileIndex end = TileXY(14, 10);
+	const TileIndex middle = TileXY(12, 10);
+	const Trackdir td = TRACKDIR_X_SW;
+	const int skipped = 4;
+
+	CSegmentCostCacheT<CYapfRailSegment> cache;
+	bool found;
+
+	int free_cost = CachedPlatformCost(cache, origin, end, td, skipped, &found);
+	CHECK_FALSE(found);
+	CHECK(free_cost == PlatformCost(end, td, skipped));
+	CHECK(CachedPlatformCost(cache, origin, end, td, skipped, &found) == free_cost);
+	CHECK(found);
+
+	/* Reserving a tile in the middle of the platform has to drop the cached cost. */
+	SetRailStationReservation(middle, true);
+	CSegmentCostCacheBase::NotifyTrackReservationChange(middle);
+	CHECK(PlatformCost(end, td, skipped) != free_cost);
+	CHECK(CachedPlatformCost(cache, origin, end, td, skipped, &found) == PlatformCost(end, td, skipped));
+	CHECK_FALSE(found);
+
+	/* And so does releasing it again. */
+	SetRailStationReservation(middle, false);
+	CSegmentCostCacheBase::NotifyTrackReservationChange(middle);
+	CHECK(CachedPlatformCost(cache, origin, end, td, skipped, &found) == free_cost);
+	CHECK_FALSE(found);
+
+	/* Changing the layout of a middle tile drops the cost as well. */
+	CSegmentCostCacheBase::NotifyTrackLayoutChange(middle, TRACK_X);
+	CHECK(CachedPlatformCost(cache, origin, end, td, skipped, &found) == free_cost);
+	CHECK_FALSE(found);
+}
+
+/**
+ * Let the rail pathfinder find the cost to the nearest depot, with the global segment cost cache.
+ * @param v The train.
+ * @return Cost of the path to the depot.
+ */
+static uint DepotCost(const Train *v)
+{
+	FindDepotData depot = YapfTrainFindNearestDepot(v, 0);
+	REQUIRE(depot.tile != INVALID_TILE);
+	return depot.best_length;
+}
+
+/**
+ * Let the rail pathfinder find the cost to the nearest depot, after emptying the global segment
+ * cost cache. That is the cost a client that just joined calculates.
+ * @param v The train.
+ * @return Cost of the path to the depot.
+ */
+static uint FreshDepotCost(const Train *v)
+{
+	YapfNotifyTrackLayoutChange(INVALID_TILE, INVALID_TRACK);
+	return DepotCost(v);
+}
+
+/**
+ * Change the height of the north corner of a tile and notify YAPF about the
+ * rail tiles whose slope changed, like terraforming does.
+ * @param corner The tile.
+ * @param height The new height.
+ */
+static void SetCornerHeight(TileIndex corner, uint height)
+{
+	SetTileHeight(corner, height);
+	for (int dx = -1; dx <= 0; dx++) {
+		for (int dy = -1; dy <= 0; dy++) {
+			TileIndex slope_tile = TileAddWrap(corner, dx, dy);
+			if (IsTileType(slope_tile, MP_RAILWAY)) YapfNotifyTrackLayoutChange(slope_tile, INVALID_TRACK);
+		}
+	}
+}
+
+TEST_CASE("CSegmentCostCacheT - Terraforming under a rail segment")
+{
+	Map::Allocate(64, 64);
+	ResetRailTypes();
+	_settings_game.pf.forbid_90_deg = false;
+	_settings_game.pf.yapf.max_search_nodes = 10000;
+	_settings_game.pf.yapf.rail_slope_penalty = 2 * YAPF_TILE_LENGTH;
+
+	/* A train at (20, 10) heading for a depot at (5, 10). */
+	MakeRailDepot(TileXY(5, 10), COMPANY_FIRST, 0, DIAGDIR_SW, RAILTYPE_RAIL);
+	for (uint x = 6; x <= 25; x++) MakeRailNormal(TileXY(x, 10), COMPANY_FIRST, TRACK_BIT_X, RAILTYPE_RAIL);
+
+	REQUIRE(Train::CanAllocateItem());
+	Train *v = new Train();
+	v->owner = COMPANY_FIRST;
+	v->tile = TileXY(20, 10);
+	v->track = TRACK_BIT_X;
+	v->direction = DIR_NE;
+	v->railtype = RAILTYPE_RAIL;
+	v->compatible_railtypes = RAILTYPES_RAIL;
+	v->gcache.cached_total_length = TILE_SIZE;
+
+	uint flat_cost = FreshDepotCost(v);
+	CHECK(DepotCost(v) == flat_cost);
+
+	/* Raise the north east edge of (12, 10) like terraforming does, so the train has to go uphill. */
+	for (TileIndex corner : { TileXY(12, 10), TileXY(12, 11) }) SetCornerHeight(corner, 1);
+	REQUIRE(GetTileSlope(TileXY(12, 10)) == SLOPE_NE);
+
+	uint hill_cost = DepotCost(v);
+	CHECK(hill_cost != flat_cost);
+	CHECK(hill_cost == FreshDepotCost(v));
+
+	/* Lowering it again gives the original cost. */
+	for (TileIndex corner : { TileXY(12, 10), TileXY(12, 11) }) SetCornerHeight(corner, 0);
+	CHECK(DepotCost(v) == flat_cost);
+	CHECK(FreshDepotCost(v) == flat_cost);
+
+	_vehicle_pool.CleanPool();
+}
@@ -151,6 +151,40 @@ typedef Foundation GetFoundationProc(TileIndex tile, Slope tileh);
  */
 typedef CommandCost TerraformTileProc(TileIndex tile, DoCommandFlag flags, int z_new, Slope tileh_new);
 
+/**
+ * Outcome of the periodic tile loop of a tile, evaluated ahead of time.
+ * @see PlanTileLoopProc
+ */
+struct TileLoopPlan {
+	TileType type; ///< Type of the tile at the time of planning.
+	uint32 state;  ///< Tile type specific state the outcome depends on, to check whether the plan is still current.
+	uint8 action;  ///< Tile type specific action to perform.
+};
+
+/**
+ * Tile callback function signature for evaluating the tile loop of a tile ahead of time.
+ *
+ * The function is called on a task thread while the game state is frozen, so it may only
+ * read the map and must not draw random numbers. All side effects have to be left to the
+ * #CommitTileLoopProc. The plan's state has to capture everything the outcome depends on
+ * that earlier tiles of the same pass may change.
+ *
+ * @param tile The tile to plan for.
+ * @param[out] plan The planned outcome.
+ * @return True iff the outcome could be planned.
+ */
+typedef bool PlanTileLoopProc(TileIndex tile, TileLoopPlan *plan);
+
+/**
+ * Tile callback function signature for performing a planned tile loop, including its side
+ * effects like sounds and redrawing the tile. Called in the order of the normal tile loop.
+ *
+ * @param tile The tile to perform the tile loop for.
+ * @param plan The plan made for the tile.
+ * @return False if the tile changed since the plan was made; the normal tile loop has to run instead.
+ */
+typedef bool CommitTileLoopProc(TileIndex tile, const TileLoopPlan &plan);
+
 /**
  * Set of callback functions for performing tile operations of a given tile type.
  * @see TileType
@@ -170,6 +204,8 @@ struct TileTypeProcs {
 	VehicleEnterTileProc *vehicle_enter_tile_proc; ///< Called when a vehicle enters a tile
 	GetFoundationProc *get_foundation_proc;
 	TerraformTileProc *terraform_tile_proc;        ///< Called when a terraforming operation is about to take place
+	PlanTileLoopProc *plan_tile_loop_proc;         ///< Called to evaluate the tile loop ahead of time, if that is possible for this tile type
+	CommitTileLoopProc *commit_tile_loop_proc;     ///< Called to perform a tile loop evaluated by plan_tile_loop_proc
 };
 
 extern const TileTypeProcs * const _tile_type_procs[16];
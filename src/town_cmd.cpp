@@ -3827,6 +3827,8 @@ extern const TileTypeProcs _tile_type_town_procs = {
 	nullptr,                    // vehicle_enter_tile_proc
 	GetFoundation_Town,      // get_foundation_proc
 	TerraformTile_Town,      // terraform_tile_proc
+	nullptr,                 // plan_tile_loop_proc
+	nullptr,                 // commit_tile_loop_proc
 };
 
 
@@ -66,6 +66,7 @@ int GetTrainStopLocation(StationID station_id, TileIndex tile, const Train *v, i
 void GetTrainSpriteSize(EngineID engine, uint &width, uint &height, int &xoffs, int &yoffs, EngineImageType image_type);
 
 bool TrainOnCrossing(TileIndex tile);
+void PlanTrainCurveSpeedLimits();
 
 /** Variables that are cached to improve performance and such */
 struct TrainCache {
@@ -102,6 +103,9 @@ struct Train FINAL : public GroundVehicle<Train, VEH_TRAIN> {
 	/** Ticks waiting in front of a signal, ticks being stuck or a counter for forced proceeding through signals. */
 	uint16 wait_counter;
 
+	bool curve_speed_outdated;     ///< NOSAVE: The curve speed limit in #tcache still has to be worked out, see #OutdateCurveSpeedLimit.
+	RailType curve_speed_railtype; ///< NOSAVE: Rail type under the front when the curve speed limit became outdated.
+
 	/** We don't want GCC to zero our struct! It already is zeroed and has an index! */
 	Train() : GroundVehicleBase() {}
 	/** We want to 'destruct' the right class. */
@@ -131,6 +135,19 @@ struct Train FINAL : public GroundVehicle<Train, VEH_TRAIN> {
 	void ReserveTrackUnderConsist() const;
 
 	int GetCurveSpeedLimit() const;
+	int GetCurveSpeedLimit(RailType railtype) const;
+	void OutdateCurveSpeedLimit();
+	void CommitCurveSpeedLimit(int max_speed);
+
+	/**
+	 * Get the curve speed limit of the consist, working it out first if the plan pass did not.
+	 * @return The curve speed limit.
+	 */
+	inline int GetMaxCurveSpeed() const
+	{
+		if (this->curve_speed_outdated) const_cast<Train *>(this)->CommitCurveSpeedLimit(this->GetCurveSpeedLimit(this->curve_speed_railtype));
+		return this->tcache.cached_max_curve_speed;
+	}
 
 	void ConsistChanged(ConsistChangeFlags allowed_changes);
 
@@ -38,6 +38,7 @@
 #include "train_cmd.h"
 #include "misc_cmd.h"
 #include "timer/timer_game_calendar.h"
+#include "task_pool.h"
 
 #include "table/strings.h"
 #include "table/train_sprites.h"
@@ -237,6 +238,7 @@ void Train::ConsistChanged(ConsistChangeFlags allowed_changes)
 	this->tcache.cached_tilt = train_can_tilt;
 	this->tcache.cached_curve_speed_mod = min_curve_speed_mod;
 	this->tcache.cached_max_curve_speed = this->GetCurveSpeedLimit();
+	this->curve_speed_outdated = false;
 
 	/* recalculate cached weights and power too (we do this *after* the rest, so it is known which wagons are powered and need extra weight added) */
 	this->CargoChanged();
@@ -305,6 +307,17 @@ int GetTrainStopLocation(StationID station_id, TileIndex tile, const Train *v, i
  * @return imposed speed limit
  */
 int Train::GetCurveSpeedLimit() const
+{
+	return this->GetCurveSpeedLimit(GetRailType(this->tile));
+}
+
+/**
+ * Computes train speed limit caused by curves, with the curve speed advantage of the given rail type.
+ * This only reads the consist, so it may be called for different trains at the same time.
+ * @param railtype Rail type under the front of the train.
+ * @return imposed speed limit
+ */
+int Train::GetCurveSpeedLimit(RailType railtype) const
 {
 	assert(this->First() == this);
 
@@ -357,7 +370,7 @@ int Train::GetCurveSpeedLimit() const
 
 	if (max_speed != absolute_max_speed) {
 		/* Apply the current railtype's curve speed advantage */
-		const RailtypeInfo *rti = GetRailTypeInfo(GetRailType(this->tile));
+		const RailtypeInfo *rti = GetRailTypeInfo(railtype);
 		max_speed += (max_speed / 2) * rti->curve_speed;
 
 		if (this->tcache.cached_tilt) {
@@ -374,6 +387,73 @@ int Train::GetCurveSpeedLimit() const
 	return max_speed;
 }
 
+/** Trains whose curve speed limit is left to the plan pass of the next vehicle tick. */
+static std::vector<VehicleID> _outdated_curve_speed_trains;
+
+/**
+ * Update the curve speed limit after the consist changed direction.
+ * With the two-phase vehicle tick the limit is only worked out by the plan pass of
+ * the next tick, using the rail type the front is on now, so it ends up the same.
+ */
+void Train::OutdateCurveSpeedLimit()
+{
+	if (!_parallel_vehicle_ticks) {
+		this->tcache.cached_max_curve_speed = this->GetCurveSpeedLimit();
+		return;
+	}
+
+	if (!this->curve_speed_outdated) _outdated_curve_speed_trains.push_back(this->index);
+	this->curve_speed_outdated = true;
+	this->curve_speed_railtype = GetRailType(this->tile);
+
+	/* Keep the value of the serial path, to compare the planned value with. */
+	if (_debug_desync_level > 1) this->tcache.cached_max_curve_speed = this->GetCurveSpeedLimit();
+}
+
+/**
+ * Store the curve speed limit that was worked out for an outdated consist.
+ * @param max_speed The curve speed limit.
+ */
+void Train::CommitCurveSpeedLimit(int max_speed)
+{
+	assert(this->curve_speed_outdated);
+
+	if (_debug_desync_level > 1 && max_speed != this->tcache.cached_max_curve_speed) {
+		Debug(desync, 2, "planned curve speed limit mismatch: train {}, planned {}, serial {}", this->index, max_speed, this->tcache.cached_max_curve_speed);
+	}
+
+	this->tcache.cached_max_curve_speed = max_speed;
+	this->curve_speed_outdated = false;
+}
+
+/**
+ * Plan pass for the curve speed limits: work out the limits of all trains that
+ * changed direction in the previous tick on the task threads, then store them
+ * in pool index order.
+ */
+void PlanTrainCurveSpeedLimits()
+{
+	static std::vector<Train *> trains;
+	static std::vector<int> max_speeds;
+
+	std::sort(_outdated_curve_speed_trains.begin(), _outdated_curve_speed_trains.end());
+	trains.clear();
+	for (VehicleID index : _outdated_curve_speed_trains) {
+		/* The train may have been deleted, or its limit worked out already. */
+		Vehicle *v = Vehicle::GetIfValid(index);
+		if (v == nullptr || v->type != VEH_TRAIN || !Train::From(v)->curve_speed_outdated) continue;
+		trains.push_back(Train::From(v));
+	}
+	_outdated_curve_speed_trains.clear();
+	max_speeds.resize(trains.size());
+
+	RunTasks(trains.size(), 64, [](size_t first, size_t last) {
+		for (size_t i = first; i < last; i++) max_speeds[i] = trains[i]->GetCurveSpeedLimit(trains[i]->curve_speed_railtype);
+	});
+
+	for (size_t i = 0; i < trains.size(); i++) trains[i]->CommitCurveSpeedLimit(max_speeds[i]);
+}
+
 /**
  * Calculates the maximum speed of the vehicle under its current conditions.
  * @return Maximum speed of the vehicle.
@@ -382,7 +462,7 @@ int Train::GetCurrentMaxSpeed() const
 {
 	int max_speed = _settings_game.vehicle.train_acceleration_model == AM_ORIGINAL ?
 			this->gcache.cached_max_track_speed :
-			this->tcache.cached_max_curve_speed;
+			this->GetMaxCurveSpeed();
 
 	if (_settings_game.vehicle.train_acceleration_model == AM_REALISTIC && IsRailStationTile(this->tile)) {
 		StationID sid = GetStationIndex(this->tile);
@@ -3508,7 +3588,7 @@ bool TrainController(Train *v, Vehicle *nomove, bool reverse)
 		if (v->IsFrontEngine() && v->tick_counter % _settings_game.pf.path_backoff_interval == 0) CheckNextTrainTile(v);
 	}
 
-	if (direction_changed) first->tcache.cached_max_curve_speed = first->GetCurveSpeedLimit();
+	if (direction_changed) first->OutdateCurveSpeedLimit();
 
 	return true;
 
@@ -25,6 +25,7 @@
 #include "timer/timer_game_tick.h"
 #include "tree_cmd.h"
 #include "landscape_cmd.h"
+#include "pathfinder/water_regions.h"
 
 #include "table/strings.h"
 #include "table/tree_land.h"
@@ -694,6 +695,20 @@ static bool CanPlantExtraTrees(TileIndex tile)
 		_settings_game.construction.extra_tree_placement == ETP_SPREAD_ALL);
 }
 
+/**
+ * Get the position of a tree tile in its update cycle.
+ * @param tile The tile.
+ * @return The cycle; grass grows when the lower 3 bits are set, trees when the lower 4 bits are set.
+ */
+static uint32 GetTreeTileLoopCycle(TileIndex tile)
+{
+	/* TimerGameTick::counter is incremented by 256 between each call, so ignore lower 8 bits.
+	 * Also, we use a simple hash to spread the updates evenly over the map.
+	 * 11 and 9 are just some co-prime numbers for better spread.
+	 */
+	return 11 * TileX(tile) + 9 * TileY(tile) + (TimerGameTick::counter >> 8);
+}
+
 static void TileLoop_Trees(TileIndex tile)
 {
 	if (GetTreeGround(tile) == TREE_GROUND_SHORE) {
@@ -707,11 +722,7 @@ static void TileLoop_Trees(TileIndex tile)
 
 	AmbientSoundEffect(tile);
 
-	/* TimerGameTick::counter is incremented by 256 between each call, so ignore lower 8 bits.
-	 * Also, we use a simple hash to spread the updates evenly over the map.
-	 * 11 and 9 are just some co-prime numbers for better spread.
-	 */
-	uint32 cycle = 11 * TileX(tile) + 9 * TileY(tile) + (TimerGameTick::counter >> 8);
+	uint32 cycle = GetTreeTileLoopCycle(tile);
 
 	/* Handle growth of grass (under trees/on MP_TREES tiles) at every 8th processings, like it's done for grass on MP_CLEAR tiles. */
 	if ((cycle & 7) == 7 && GetTreeGround(tile) == TREE_GROUND_GRASS) {
@@ -781,7 +792,7 @@ static void TileLoop_Trees(TileIndex tile)
 			} else {
 				/* just one tree, change type into MP_CLEAR */
 				switch (GetTreeGround(tile)) {
-					case TREE_GROUND_SHORE: MakeShore(tile); break;
+					case TREE_GROUND_SHORE: MakeShore(tile); InvalidateWaterRegion(tile); break;
 					case TREE_GROUND_GRASS: MakeClear(tile, CLEAR_GRASS, GetTreeDensity(tile)); break;
 					case TREE_GROUND_ROUGH: MakeClear(tile, CLEAR_ROUGH, 3); break;
 					case TREE_GROUND_ROUGH_SNOW: {
@@ -811,6 +822,49 @@ static void TileLoop_Trees(TileIndex tile)
 	MarkTileDirtyByTile(tile);
 }
 
+/** Actions of a planned tile loop of a tree tile. */
+enum TreeTileLoopAction {
+	TTLA_NONE,       ///< Nothing changes.
+	TTLA_GROW_GRASS, ///< Let the grass under the trees grow.
+};
+
+/**
+ * Get the state of a tree tile the outcome of its tile loop depends on.
+ * @param tile The tile.
+ * @return The ground type and density.
+ */
+static uint32 GetTreeTileLoopState(TileIndex tile)
+{
+	return GetTreeGround(tile) << 4 | GetTreeDensity(tile);
+}
+
+static bool PlanTileLoop_Trees(TileIndex tile, TileLoopPlan *plan)
+{
+	/* Shores flood, snow and desert depend on the climate zones and growing trees draw random numbers. */
+	if (GetTreeGround(tile) == TREE_GROUND_SHORE) return false;
+	if (_settings_game.game_creation.landscape == LT_ARCTIC || _settings_game.game_creation.landscape == LT_TROPIC) return false;
+
+	uint32 cycle = GetTreeTileLoopCycle(tile);
+	if (_settings_game.construction.extra_tree_placement != ETP_NO_GROWTH_NO_SPREAD && (cycle & 15) == 15) return false;
+
+	plan->state = GetTreeTileLoopState(tile);
+	plan->action = ((cycle & 7) == 7 && GetTreeGround(tile) == TREE_GROUND_GRASS && GetTreeDensity(tile) < 3) ? TTLA_GROW_GRASS : TTLA_NONE;
+	return true;
+}
+
+static bool CommitTileLoop_Trees(TileIndex tile, const TileLoopPlan &plan)
+{
+	if (GetTreeTileLoopState(tile) != plan.state) return false;
+
+	AmbientSoundEffect(tile);
+
+	if (plan.action == TTLA_GROW_GRASS) {
+		SetTreeGroundDensity(tile, TREE_GROUND_GRASS, GetTreeDensity(tile) + 1);
+		MarkTileDirtyByTile(tile);
+	}
+	return true;
+}
+
 /**
  * Decrement the tree tick counter.
  * The interval is scaled by map size to allow for the same density regardless of size.
@@ -900,4 +954,6 @@ extern const TileTypeProcs _tile_type_trees_procs = {
 	nullptr,                     // vehicle_enter_tile_proc
 	GetFoundation_Trees,      // get_foundation_proc
 	TerraformTile_Trees,      // terraform_tile_proc
+	PlanTileLoop_Trees,       // plan_tile_loop_proc
+	CommitTileLoop_Trees,     // commit_tile_loop_proc
 };
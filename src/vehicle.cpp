@@ -39,6 +39,7 @@
 #include "roadstop_base.h"
 #include "core/random_func.hpp"
 #include "core/backup_type.hpp"
+#include "core/spatial_hash_type.hpp"
 #include "order_backup.h"
 #include "sound_func.h"
 #include "effectvehicle_func.h"
@@ -59,6 +60,7 @@
 #include "timer/timer.h"
 #include "timer/timer_game_calendar.h"
 #include "timer/timer_game_tick.h"
+#include "pathfinder/yapf/yapf.h"
 
 #include "table/strings.h"
 
@@ -358,6 +360,7 @@ Vehicle::Vehicle(VehicleType type)
 	this->cargo_age_counter  = 1;
 	this->last_station_visited = INVALID_STATION;
 	this->last_loading_station = INVALID_STATION;
+	this->hash_tile_bucket   = SpatialHash<Vehicle>::INVALID_BUCKET;
 }
 
 /**
@@ -369,29 +372,60 @@ byte VehicleRandomBits()
 	return GB(Random(), 0, 8);
 }
 
-/* Size of the hash, 6 = 64 x 64, 7 = 128 x 128. Larger sizes will (in theory) reduce hash
- * lookup times at the expense of memory usage. */
-const int HASH_BITS = 7;
-const int HASH_SIZE = 1 << HASH_BITS;
-const int HASH_MASK = HASH_SIZE - 1;
-const int TOTAL_HASH_SIZE = 1 << (HASH_BITS * 2);
-const int TOTAL_HASH_MASK = TOTAL_HASH_SIZE - 1;
+/* Size of the tile hash; from 7 = 128 x 128 up to 9 = 512 x 512, depending on the map size.
+ * Larger sizes reduce hash lookup times at the expense of memory usage. */
+static const uint MIN_VEHICLE_TILE_HASH_BITS = 7;
+static const uint MAX_VEHICLE_TILE_HASH_BITS = 9;
 
-/* Resolution of the hash, 0 = 1*1 tile, 1 = 2*2 tiles, 2 = 4*4 tiles, etc.
- * Profiling results show that 0 is fastest. */
-const int HASH_RES = 0;
+static SpatialHash<Vehicle> _vehicle_tile_hash;
 
-static Vehicle *_vehicle_tile_hash[TOTAL_HASH_SIZE];
+/**
+ * Get the size of the tile hash for the current map.
+ * The order in which vehicles are found depends on the size, so it must only
+ * depend on state that is the same for the server and all clients. The number
+ * of vehicles is not: a joining client would size the hash for the vehicles at
+ * the time it loaded the game, while the server sized it at another time.
+ * @return Number of bits of each tile coordinate to use for the hash.
+ */
+static uint GetVehicleTileHashBits()
+{
+	/* There is no point in having more buckets along an axis than there are tiles. */
+	return Clamp<uint>(std::max(Map::LogX(), Map::LogY()), MIN_VEHICLE_TILE_HASH_BITS, MAX_VEHICLE_TILE_HASH_BITS);
+}
 
-static Vehicle *VehicleFromTileHash(int xl, int yl, int xu, int yu, void *data, VehicleFromPosProc *proc, bool find_first)
+/**
+ * Call \a proc for the vehicles in a bucket of the tile hash.
+ * @param bucket The bucket.
+ * @param tile Only call \a proc for vehicles on this tile, or INVALID_TILE for all vehicles.
+ * @param data Arbitrary data passed to \a proc.
+ * @param proc The proc that determines whether a vehicle will be "found".
+ * @param find_first Whether to return on the first found or iterate over all vehicles.
+ * @return the best matching or first vehicle (depending on find_first).
+ */
+static Vehicle *VehicleFromTileHashBucket(uint bucket, TileIndex tile, void *data, VehicleFromPosProc *proc, bool find_first)
 {
-	for (int y = yl; ; y = (y + (1 << HASH_BITS)) & (HASH_MASK << HASH_BITS)) {
-		for (int x = xl; ; x = (x + 1) & HASH_MASK) {
-			Vehicle *v = _vehicle_tile_hash[(x + y) & TOTAL_HASH_MASK];
-			for (; v != nullptr; v = v->hash_tile_next) {
-				Vehicle *a = proc(v, data);
-				if (find_first && a != nullptr) return a;
-			}
+	const SpatialHash<Vehicle>::Bucket &vehicles = _vehicle_tile_hash.GetItems(bucket);
+	for (size_t i = 0; i < vehicles.size();) {
+		Vehicle *v = vehicles[i];
+		if (tile == INVALID_TILE || v->tile == tile) {
+			Vehicle *a = proc(v, data);
+			if (find_first && a != nullptr) return a;
+		}
+
+		/* Do not skip the next vehicle when the proc removed this one from the bucket. */
+		if (i < vehicles.size() && vehicles[i] == v) i++;
+	}
+
+	return nullptr;
+}
+
+static Vehicle *VehicleFromTileHash(uint xl, uint yl, uint xu, uint yu, void *data, VehicleFromPosProc *proc, bool find_first)
+{
+	const uint mask = _vehicle_tile_hash.GetMask();
+	for (uint y = yl; ; y = (y + 1) & mask) {
+		for (uint x = xl; ; x = (x + 1) & mask) {
+			Vehicle *a = VehicleFromTileHashBucket(_vehicle_tile_hash.GetBucket(x, y), INVALID_TILE, data, proc, find_first);
+			if (a != nullptr) return a;
 			if (x == xu) break;
 		}
 		if (y == yu) break;
@@ -417,10 +451,11 @@ static Vehicle *VehicleFromPosXY(int x, int y, void *data, VehicleFromPosProc *p
 	const int COLL_DIST = 6;
 
 	/* Hash area to scan is from xl,yl to xu,yu */
-	int xl = GB((x - COLL_DIST) / TILE_SIZE, HASH_RES, HASH_BITS);
-	int xu = GB((x + COLL_DIST) / TILE_SIZE, HASH_RES, HASH_BITS);
-	int yl = GB((y - COLL_DIST) / TILE_SIZE, HASH_RES, HASH_BITS) << HASH_BITS;
-	int yu = GB((y + COLL_DIST) / TILE_SIZE, HASH_RES, HASH_BITS) << HASH_BITS;
+	const uint mask = _vehicle_tile_hash.GetMask();
+	uint xl = ((x - COLL_DIST) / TILE_SIZE) & mask;
+	uint xu = ((x + COLL_DIST) / TILE_SIZE) & mask;
+	uint yl = ((y - COLL_DIST) / TILE_SIZE) & mask;
+	uint yu = ((y + COLL_DIST) / TILE_SIZE) & mask;
 
 	return VehicleFromTileHash(xl, yl, xu, yu, data, proc, find_first);
 }
@@ -472,18 +507,7 @@ bool HasVehicleOnPosXY(int x, int y, void *data, VehicleFromPosProc *proc)
  */
 static Vehicle *VehicleFromPos(TileIndex tile, void *data, VehicleFromPosProc *proc, bool find_first)
 {
-	int x = GB(TileX(tile), HASH_RES, HASH_BITS);
-	int y = GB(TileY(tile), HASH_RES, HASH_BITS) << HASH_BITS;
-
-	Vehicle *v = _vehicle_tile_hash[(x + y) & TOTAL_HASH_MASK];
-	for (; v != nullptr; v = v->hash_tile_next) {
-		if (v->tile != tile) continue;
-
-		Vehicle *a = proc(v, data);
-		if (find_first && a != nullptr) return a;
-	}
-
-	return nullptr;
+	return VehicleFromTileHashBucket(_vehicle_tile_hash.GetBucket(TileX(tile), TileY(tile)), tile, data, proc, find_first);
 }
 
 /**
@@ -615,35 +639,16 @@ CommandCost EnsureNoTrainOnTrackBits(TileIndex tile, TrackBits track_bits)
 
 static void UpdateVehicleTileHash(Vehicle *v, bool remove)
 {
-	Vehicle **old_hash = v->hash_tile_current;
-	Vehicle **new_hash;
-
-	if (remove) {
-		new_hash = nullptr;
-	} else {
-		int x = GB(TileX(v->tile), HASH_RES, HASH_BITS);
-		int y = GB(TileY(v->tile), HASH_RES, HASH_BITS) << HASH_BITS;
-		new_hash = &_vehicle_tile_hash[(x + y) & TOTAL_HASH_MASK];
-	}
+	uint old_bucket = v->hash_tile_bucket;
+	uint new_bucket = remove ? SpatialHash<Vehicle>::INVALID_BUCKET : _vehicle_tile_hash.GetBucket(TileX(v->tile), TileY(v->tile));
 
-	if (old_hash == new_hash) return;
+	if (old_bucket == new_bucket) return;
 
-	/* Remove from the old position in the hash table */
-	if (old_hash != nullptr) {
-		if (v->hash_tile_next != nullptr) v->hash_tile_next->hash_tile_prev = v->hash_tile_prev;
-		*v->hash_tile_prev = v->hash_tile_next;
-	}
-
-	/* Insert vehicle at beginning of the new position in the hash table */
-	if (new_hash != nullptr) {
-		v->hash_tile_next = *new_hash;
-		if (v->hash_tile_next != nullptr) v->hash_tile_next->hash_tile_prev = &v->hash_tile_next;
-		v->hash_tile_prev = new_hash;
-		*new_hash = v;
-	}
+	if (old_bucket != SpatialHash<Vehicle>::INVALID_BUCKET) _vehicle_tile_hash.Remove(old_bucket, v);
+	if (new_bucket != SpatialHash<Vehicle>::INVALID_BUCKET) _vehicle_tile_hash.Insert(new_bucket, v);
 
 	/* Remember current hash position */
-	v->hash_tile_current = new_hash;
+	v->hash_tile_bucket = new_bucket;
 }
 
 static Vehicle *_vehicle_viewport_hash[1 << (GEN_HASHX_BITS + GEN_HASHY_BITS)];
@@ -674,9 +679,9 @@ static void UpdateVehicleViewportHash(Vehicle *v, int x, int y, int old_x, int o
 
 void ResetVehicleHash()
 {
-	for (Vehicle *v : Vehicle::Iterate()) { v->hash_tile_current = nullptr; }
+	for (Vehicle *v : Vehicle::Iterate()) { v->hash_tile_bucket = SpatialHash<Vehicle>::INVALID_BUCKET; }
 	memset(_vehicle_viewport_hash, 0, sizeof(_vehicle_viewport_hash));
-	memset(_vehicle_tile_hash, 0, sizeof(_vehicle_tile_hash));
+	_vehicle_tile_hash.Reset(GetVehicleTileHashBits());
 }
 
 void ResetVehicleColourMap()
@@ -691,10 +696,14 @@ void ResetVehicleColourMap()
 typedef SmallMap<Vehicle *, bool> AutoreplaceMap;
 static AutoreplaceMap _vehicles_to_autoreplace;
 
+bool _parallel_vehicle_ticks; ///< Run the read-only work of the vehicle tick ahead of it on the task threads.
+bool _parallel_train_pathfinding; ///< Search the paths of trains approaching a junction ahead of time on the task threads.
+
 void InitializeVehicles()
 {
 	_vehicles_to_autoreplace.clear();
 	_vehicles_to_autoreplace.shrink_to_fit();
+	YapfTrainDropPlannedPaths();
 	ResetVehicleHash();
 }
 
@@ -821,7 +830,7 @@ void Vehicle::PreDestructor()
 
 	if (Station::IsValidID(this->last_station_visited)) {
 		Station *st = Station::Get(this->last_station_visited);
-		st->loading_vehicles.remove(this);
+		st->RemoveLoadingVehicle(this);
 
 		HideFillingPercent(&this->fill_percent_te_id);
 		this->CancelReservation(INVALID_STATION, st);
@@ -962,13 +971,28 @@ void CallVehicleTicks()
 
 	{
 		PerformanceMeasurer framerate(PFE_GL_ECONOMY);
-		for (Station *st : Station::Iterate()) LoadUnloadStation(st);
+		/* Only stations with loading vehicles have anything to do. A station
+		 * leaves the set only when its last vehicle leaves, which doesn't
+		 * happen while loading, but advance the iterator first to be safe. */
+		for (auto it = Station::loading_stations.begin(); it != Station::loading_stations.end();) {
+			LoadUnloadStation(Station::Get(*it++));
+		}
 	}
 	PerformanceAccumulator::Reset(PFE_GL_TRAINS);
 	PerformanceAccumulator::Reset(PFE_GL_ROADVEHS);
 	PerformanceAccumulator::Reset(PFE_GL_SHIPS);
 	PerformanceAccumulator::Reset(PFE_GL_AIRCRAFT);
 
+	/* Plan pass: work that only reads the game state is done on the task threads
+	 * and its results are used by the vehicle ticks as long as they are valid. */
+	if (_parallel_vehicle_ticks) PlanTrainCurveSpeedLimits();
+
+	if ((_parallel_vehicle_ticks || _parallel_train_pathfinding) && _settings_game.pf.pathfinder_for_trains == VPF_YAPF) {
+		YapfTrainPlanPaths();
+	} else {
+		YapfTrainDropPlannedPaths();
+	}
+
 	for (Vehicle *v : Vehicle::Iterate()) {
 		[[maybe_unused]] size_t vehicle_index = v->index;
 
@@ -2293,7 +2317,7 @@ void Vehicle::LeaveStation()
 	this->current_order.MakeLeaveStation();
 	Station *st = Station::Get(this->last_station_visited);
 	this->CancelReservation(INVALID_STATION, st);
-	st->loading_vehicles.remove(this);
+	st->RemoveLoadingVehicle(this);
 
 	HideFillingPercent(&this->fill_percent_te_id);
 	trip_occupancy = CalcPercentVehicleFilled(this, nullptr);
@@ -116,6 +116,9 @@ const struct Livery *GetEngineLivery(EngineID engine_type, CompanyID company, En
 SpriteID GetEnginePalette(EngineID engine_type, CompanyID company);
 SpriteID GetVehiclePalette(const Vehicle *v);
 
+extern bool _parallel_vehicle_ticks;
+extern bool _parallel_train_pathfinding;
+
 extern const StringID _veh_build_msg_table[];
 extern const StringID _veh_sell_msg_table[];
 extern const StringID _veh_refit_msg_table[];
@@ -88,4 +88,6 @@ extern const TileTypeProcs _tile_type_void_procs = {
 	nullptr,                     // vehicle_enter_tile_proc
 	GetFoundation_Void,       // get_foundation_proc
 	TerraformTile_Void,       // terraform_tile_proc
+	nullptr,                  // plan_tile_loop_proc
+	nullptr,                  // commit_tile_loop_proc
 };
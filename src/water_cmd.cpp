@@ -39,6 +39,7 @@
 #include "industry.h"
 #include "water_cmd.h"
 #include "landscape_cmd.h"
+#include "pathfinder/water_regions.h"
 
 #include "table/strings.h"
 
@@ -150,6 +151,8 @@ CommandCost CmdBuildShipDepot(DoCommandFlag flags, TileIndex tile, Axis axis)
 		MakeShipDepot(tile2, _current_company, depot->index, DEPOT_PART_SOUTH, axis, wc2);
 		CheckForDockingTile(tile);
 		CheckForDockingTile(tile2);
+		InvalidateWaterRegion(tile);
+		InvalidateWaterRegion(tile2);
 		MarkTileDirtyByTile(tile);
 		MarkTileDirtyByTile(tile2);
 		MakeDefaultName(depot);
@@ -207,6 +210,7 @@ void CheckForDockingTile(TileIndex t)
 void MakeWaterKeepingClass(TileIndex tile, Owner o)
 {
 	WaterClass wc = GetWaterClass(tile);
+	InvalidateWaterRegion(tile);
 
 	/* Autoslope might turn an originally canal or river tile into land */
 	int z;
@@ -354,6 +358,9 @@ static CommandCost DoBuildLock(TileIndex tile, DiagDirection dir, DoCommandFlag
 		MakeLock(tile, _current_company, dir, wc_lower, wc_upper, wc_middle);
 		CheckForDockingTile(tile - delta);
 		CheckForDockingTile(tile + delta);
+		InvalidateWaterRegion(tile);
+		InvalidateWaterRegion(tile - delta);
+		InvalidateWaterRegion(tile + delta);
 		MarkTileDirtyByTile(tile);
 		MarkTileDirtyByTile(tile - delta);
 		MarkTileDirtyByTile(tile + delta);
@@ -396,6 +403,7 @@ static CommandCost RemoveLock(TileIndex tile, DoCommandFlag flags)
 
 		if (GetWaterClass(tile) == WATER_CLASS_RIVER) {
 			MakeRiver(tile, Random());
+			InvalidateWaterRegion(tile);
 		} else {
 			DoClearSquare(tile);
 		}
@@ -516,6 +524,7 @@ CommandCost CmdBuildCanal(DoCommandFlag flags, TileIndex tile, TileIndex start_t
 			MarkTileDirtyByTile(current_tile);
 			MarkCanalsAndRiversAroundDirty(current_tile);
 			CheckForDockingTile(current_tile);
+			InvalidateWaterRegion(current_tile);
 		}
 
 		cost.AddCost(_price[PR_BUILD_CANAL]);
@@ -1167,11 +1176,14 @@ void DoFloodTile(TileIndex target)
 		UpdateSignalsInBuffer();
 
 		if (IsPossibleDockingTile(target)) CheckForDockingTile(target);
+		InvalidateWaterRegion(target);
 	}
 
 	cur_company.Restore();
 }
 
+static uint32 _water_dried_up_count = 0; ///< Number of water tiles that turned into land, to invalidate planned tile loops of their neighbours.
+
 /**
  * Drys a tile up.
  */
@@ -1207,6 +1219,7 @@ static void DoDryUp(TileIndex tile)
 			if (Command<CMD_LANDSCAPE_CLEAR>::Do(DC_EXEC, tile).Succeeded()) {
 				MakeClear(tile, CLEAR_GRASS, 3);
 				MarkTileDirtyByTile(tile);
+				_water_dried_up_count++;
 			}
 			break;
 
@@ -1264,6 +1277,40 @@ void TileLoop_Water(TileIndex tile)
 	}
 }
 
+static bool PlanTileLoop_Water(TileIndex tile, TileLoopPlan *plan)
+{
+	switch (GetFloodingBehaviour(tile)) {
+		case FLOOD_NONE:
+			break;
+
+		case FLOOD_ACTIVE:
+			/* Open water only floods nothing while all its neighbours are water. Drying up coasts is
+			 * the only way water turns into land during the tile loop, so counting those is enough
+			 * to know whether that still holds. Other neighbours have to be checked in sequence. */
+			for (Direction dir = DIR_BEGIN; dir < DIR_END; dir++) {
+				TileIndex dest = tile + TileOffsByDir(dir);
+				if (IsValidTile(dest) && !IsTileType(dest, MP_WATER)) return false;
+			}
+			break;
+
+		default:
+			/* Drying up depends on the flooding behaviour of the neighbours. */
+			return false;
+	}
+
+	plan->state = _water_dried_up_count;
+	plan->action = 0;
+	return true;
+}
+
+static bool CommitTileLoop_Water(TileIndex tile, const TileLoopPlan &plan)
+{
+	if (_water_dried_up_count != plan.state) return false;
+
+	AmbientSoundEffect(tile);
+	return true;
+}
+
 void ConvertGroundTilesIntoWaterTiles()
 {
 	int z;
@@ -1402,4 +1449,6 @@ extern const TileTypeProcs _tile_type_water_procs = {
 	VehicleEnter_Water,       // vehicle_enter_tile_proc
 	GetFoundation_Water,      // get_foundation_proc
 	TerraformTile_Water,      // terraform_tile_proc
+	PlanTileLoop_Water,       // plan_tile_loop_proc
+	CommitTileLoop_Water,     // commit_tile_loop_proc
 };